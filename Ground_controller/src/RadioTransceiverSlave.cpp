@@ -46,9 +46,15 @@ unsigned long lastSignalLostPrinted = 0;
 enum DataType {
   FLIGHT_DATA = 1,
   STATE_DATA = 2,
-  ERROR_MSG = 3
+  ERROR_MSG = 3,
+  LOOP_STATS = 4
 };
 
+// Loop statistics packets from the rocket (see transmitLoopStats() in the rocket code)
+#define LOOP_STATS_BUCKETS 16
+#define LOOP_STATS_BUCKETS_PER_PACKET 7
+#define LOOP_STATS_SUMMARY 0xFF
+
 // Create a Packet structure to hold the data that will be received from the other node
 struct Packet {
   byte type;
@@ -259,6 +265,39 @@ void receiveFlightData(PacketData& receiverData, Packet& packet)
   }
 }
 
+// Print the loop latency histograms sent by the rocket at the end of the flight
+void receiveLoopStats(Packet& packet)
+{
+  static const char* const stageNames[] = {
+    "imu", "madgwick", "lidar", "lqr", "actuators", "sd", "radio", "loopPeriod", "controlJitter"
+  };
+  uint32_t values[LOOP_STATS_BUCKETS_PER_PACKET];
+  memcpy(values, &packet.data[2], sizeof(values));
+
+  if (packet.data[0] == LOOP_STATS_SUMMARY) {
+    Serial.print("Loop stats: iterations ");
+    Serial.print(values[0]);
+    Serial.print(", overruns ");
+    Serial.print(values[1]);
+    Serial.print(", control steps ");
+    Serial.println(values[2]);
+    return;
+  }
+
+  byte stage = packet.data[0];
+  byte first = packet.data[1];
+  Serial.print("Loop stats ");
+  Serial.print(stage < sizeof(stageNames) / sizeof(stageNames[0]) ? stageNames[stage] : "?");
+  Serial.print(" buckets ");
+  Serial.print(first);
+  Serial.print(": ");
+  for (int i = 0; i < LOOP_STATS_BUCKETS_PER_PACKET && first + i < LOOP_STATS_BUCKETS; i++) {
+    Serial.print(values[i]);
+    Serial.print(" ");
+  }
+  Serial.println();
+}
+
 void receiveState(Packet& packet)
 {
   switch (*reinterpret_cast<int*>(packet.data)) { //May need to use packet.data[0] instead of packet.data for byte access
@@ -304,6 +343,9 @@ bool receivePacket(PacketData& receiverData, ControlData& controllerData)
         receiveState(packet);
         newData = true;
         break;
+      case LOOP_STATS:
+        receiveLoopStats(packet);
+        break;
       case ERROR_MSG:
         // this is an error message
         Serial.print("Error message received: ");
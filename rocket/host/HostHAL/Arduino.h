@@ -0,0 +1,129 @@
+// ================================
+// Host HAL - Arduino core (Linux)
+// ================================
+
+/*
+* Minimal replacement of the Teensy Arduino core used when the flight code is built for the host (env:native)
+* Only the parts of the core that the rocket firmware and its libraries actually use are provided
+* Pins, servos, I2C devices, the SD card and the radio are emulated in memory / on the host file system
+*/
+
+#pragma once
+
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <cmath>
+#include <type_traits>
+#include <algorithm>
+
+#include "WString.h"
+#include "HostSerial.h"
+
+// =============================================================================================
+//  Types and constants
+// =============================================================================================
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 1
+#define LOW  0
+
+#define INPUT        0
+#define OUTPUT       1
+#define INPUT_PULLUP 2
+
+#define CHANGE  4
+#define FALLING 2
+#define RISING  3
+
+#define LED_BUILTIN 13
+
+// Default I2C pins of the Teensy 4.1 (used by the TFMini bus recovery)
+#define PIN_WIRE_SDA 18
+#define PIN_WIRE_SCL 19
+
+// Number of emulated digital pins (Teensy 4.1 has 55)
+#define HOST_NUM_PINS 64
+
+// Teensy 4 RAM2 placement, the host has one kind of RAM
+#define DMAMEM
+
+using std::isnan;
+using std::isinf;
+
+
+// =============================================================================================
+//  Math helpers (same semantics as the Teensy 4 core)
+// =============================================================================================
+
+// Integer map with the rounding fix used by the Teensy core
+template <class T, class A, class B, class C, class D>
+long map(T _x, A _in_min, B _in_max, C _out_min, D _out_max, typename std::enable_if<std::is_integral<T>::value>::type* = 0) {
+  long x = _x, in_min = _in_min, in_max = _in_max, out_min = _out_min, out_max = _out_max;
+  if ((in_max - in_min) > (out_max - out_min)) {
+    return (x - in_min) * (out_max - out_min + 1) / (in_max - in_min + 1) + out_min;
+  } else {
+    return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
+  }
+}
+
+// Floating point map
+template <class T, class A, class B, class C, class D>
+T map(T x, A in_min, B in_max, C out_min, D out_max, typename std::enable_if<std::is_floating_point<T>::value>::type* = 0) {
+  return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
+}
+
+template <class A, class B, class C>
+A constrain(A amt, B low, C high) {
+  return (amt < low) ? A(low) : ((amt > high) ? A(high) : amt);
+}
+
+using std::min;
+using std::max;
+
+
+// =============================================================================================
+//  Time
+// =============================================================================================
+unsigned long micros();
+unsigned long millis();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+
+
+// =============================================================================================
+//  Digital IO
+// =============================================================================================
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+uint8_t digitalRead(uint8_t pin);
+
+// Pin interrupts, the handler runs when the pin level changes (hostSetPin) with a matching edge
+// Every pin has its own interrupt, as on the Teensy
+#define digitalPinToInterrupt(pin) (pin)
+void attachInterrupt(uint8_t pin, void (*isr)(), int mode);
+void detachInterrupt(uint8_t pin);
+
+// Handlers run between firmware statements on the host (from clock reads and waits), there is nothing to mask
+inline void noInterrupts() {}
+inline void interrupts() {}
+
+
+// =============================================================================================
+//  Host control
+// =============================================================================================
+// Ends the host process (the host equivalent of waiting for a reset)
+void hostExit(int code);
+
+// Arduino entry points implemented by the firmware
+void setup();
+void loop();
+
+#endif
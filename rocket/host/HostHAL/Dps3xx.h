@@ -0,0 +1,39 @@
+// ==========================================
+// Host HAL - XENSIV DPS3xx pressure sensor
+// ==========================================
+
+/*
+* Pressure sensor replacement returning a constant ground level pressure
+*/
+
+#pragma once
+
+#ifndef HOST_DPS3XX_H
+#define HOST_DPS3XX_H
+
+#include <Arduino.h>
+#include <Wire.h>
+
+class Dps3xx {
+public:
+  void begin(TwoWire& bus) { (void)bus; }
+  void begin(TwoWire& bus, uint8_t slaveAddress) { (void)bus; (void)slaveAddress; }
+
+  int16_t startMeasureTempCont(uint8_t tempMr, uint8_t tempOsr) { (void)tempMr; (void)tempOsr; return 0; }
+  int16_t startMeasurePressureCont(uint8_t prsMr, uint8_t prsOsr) { (void)prsMr; (void)prsOsr; return 0; }
+  int16_t startMeasureBothCont(uint8_t tempMr, uint8_t tempOsr, uint8_t prsMr, uint8_t prsOsr) {
+    (void)tempMr; (void)tempOsr; (void)prsMr; (void)prsOsr;
+    return 0;
+  }
+
+  int16_t getContResults(float* tempBuffer, uint8_t& tempCount, float* prsBuffer, uint8_t& prsCount) {
+    if (tempCount > 0) { tempBuffer[0] = 20.0f; tempCount = 1; }
+    if (prsCount > 0) { prsBuffer[0] = pressure; prsCount = 1; }
+    return 0;
+  }
+
+  // Host only: pressure [Pa] returned by the next reads
+  float pressure = 101325.0f;
+};
+
+#endif
@@ -0,0 +1,210 @@
+// ==========================================
+// Host HAL - Time source and event scheduler
+// ==========================================
+
+// =============================================================================================
+//  Preprocessor Definitions
+// =============================================================================================
+#include "HostClock.h"
+#include <Arduino.h>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+
+
+// =============================================================================================
+//  Variables/Objects
+// =============================================================================================
+struct PendingEvent {
+  uint64_t t;
+  uint64_t seq;   // Keeps events scheduled for the same time in FIFO order
+  uint32_t id;
+
+  bool operator>(const PendingEvent& other) const {
+    return t != other.t ? t > other.t : seq > other.seq;
+  }
+};
+
+struct EventEntry {
+  HostEvent fn;
+  uint64_t period;
+};
+
+static HostClockMode clockMode = HostClockMode::Wall;
+static uint64_t virtualNow = 0;
+static uint64_t readCost = 50;
+
+static const std::chrono::steady_clock::time_point tStart = std::chrono::steady_clock::now();
+
+static std::vector<PendingEvent> queue;   // Min-heap on (t, seq)
+static std::unordered_map<uint32_t, EventEntry> events;
+static uint32_t nextId = 1;
+static uint64_t nextSeq = 0;
+static bool dispatching = false;
+
+
+// =============================================================================================
+//  Event scheduler
+// =============================================================================================
+static void push(uint64_t t, uint32_t id) {
+  queue.push_back({t, nextSeq++, id});
+  std::push_heap(queue.begin(), queue.end(), std::greater<PendingEvent>());
+}
+
+// Skip cancelled entries at the top of the heap
+static void prune() {
+  while (!queue.empty() && events.find(queue.front().id) == events.end()) {
+    std::pop_heap(queue.begin(), queue.end(), std::greater<PendingEvent>());
+    queue.pop_back();
+  }
+}
+
+uint64_t hostNextEvent() {
+  prune();
+  return queue.empty() ? UINT64_MAX : queue.front().t;
+}
+
+uint32_t hostSchedule(uint64_t t, HostEvent fn) {
+  uint32_t id = nextId++;
+  events[id] = {fn, 0};
+  push(t, id);
+  return id;
+}
+
+uint32_t hostSchedulePeriodic(uint64_t tFirst, uint64_t period, HostEvent fn) {
+  uint32_t id = nextId++;
+  events[id] = {fn, period};
+  push(tFirst, id);
+  return id;
+}
+
+void hostCancel(uint32_t id) {
+  events.erase(id);
+}
+
+// Run the first event if it is due at time t
+static bool dispatchOne(uint64_t t) {
+  if (hostNextEvent() > t) {
+    return false;
+  }
+  PendingEvent ev = queue.front();
+  std::pop_heap(queue.begin(), queue.end(), std::greater<PendingEvent>());
+  queue.pop_back();
+
+  auto it = events.find(ev.id);
+  HostEvent fn = it->second.fn;
+  if (it->second.period > 0) {
+    push(ev.t + it->second.period, ev.id);
+  }
+  else {
+    events.erase(it);
+  }
+
+  if (clockMode == HostClockMode::Virtual && ev.t > virtualNow) {
+    virtualNow = ev.t;
+  }
+  fn();
+  return true;
+}
+
+// Events may read the clock themselves, they are never dispatched recursively
+static void dispatchDue(uint64_t t) {
+  if (dispatching) {
+    return;
+  }
+  dispatching = true;
+  while (dispatchOne(t)) {}
+  dispatching = false;
+}
+
+
+// =============================================================================================
+//  Time source
+// =============================================================================================
+void hostSetClockMode(HostClockMode mode) {
+  if (mode == HostClockMode::Virtual && clockMode == HostClockMode::Wall) {
+    virtualNow = hostNanos();
+  }
+  clockMode = mode;
+}
+
+HostClockMode hostClockMode() {
+  return clockMode;
+}
+
+void hostSetClockReadCost(uint64_t ns) {
+  readCost = ns;
+}
+
+static uint64_t wallNanos() {
+  return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - tStart).count();
+}
+
+uint64_t hostNanos() {
+  if (clockMode == HostClockMode::Virtual) {
+    virtualNow += readCost;
+    dispatchDue(virtualNow);
+    return virtualNow;
+  }
+  uint64_t now = wallNanos();
+  dispatchDue(now);
+  return now;
+}
+
+void hostAdvanceTo(uint64_t t) {
+  if (clockMode == HostClockMode::Virtual) {
+    // Jump from event to event until the target time is reached
+    if (!dispatching) {
+      dispatching = true;
+      while (dispatchOne(t)) {}
+      dispatching = false;
+    }
+    if (t > virtualNow) {
+      virtualNow = t;
+    }
+    return;
+  }
+
+  // Wall clock: sleep until the next event or the target, whatever comes first
+  uint64_t now = wallNanos();
+  while (now < t) {
+    uint64_t wake = std::min(t, hostNextEvent());
+    if (wake > now + 200000) {
+      std::this_thread::sleep_for(std::chrono::nanoseconds(wake - now - 100000));
+    }
+    now = wallNanos();
+    dispatchDue(now);
+  }
+}
+
+void hostChargeTime(uint64_t ns) {
+  if (clockMode == HostClockMode::Virtual) {
+    hostAdvanceTo(virtualNow + ns);
+  }
+}
+
+void waitUntilMicros(unsigned long tWake) {
+  hostAdvanceTo((uint64_t)tWake * 1000);
+}
+
+
+// =============================================================================================
+//  Arduino time functions
+// =============================================================================================
+unsigned long micros() {
+  return (unsigned long)(hostNanos() / 1000);
+}
+
+unsigned long millis() {
+  return (unsigned long)(hostNanos() / 1000000);
+}
+
+void delay(unsigned long ms) {
+  hostAdvanceTo(hostNanos() + (uint64_t)ms * 1000000);
+}
+
+void delayMicroseconds(unsigned int us) {
+  hostAdvanceTo(hostNanos() + (uint64_t)us * 1000);
+}
@@ -0,0 +1,62 @@
+// ==========================================
+// Host HAL - Time source and event scheduler
+// ==========================================
+
+/*
+* The host build can run on two time sources:
+*   - Wall:    micros() follows the real (monotonic) clock, delays sleep
+*   - Virtual: time only moves when the firmware waits (delay, waitUntilMicros) or polls the clock,
+*              a wait jumps straight to its wake-up time. A 10 s flight simulates in milliseconds.
+*
+* The discrete-event scheduler runs host side tasks (plant model, simulated sensors, operator inputs)
+* at their due time. In virtual mode a wait never skips over an event, the clock stops at each event,
+* runs it and continues to the next one.
+*/
+
+#pragma once
+
+#ifndef HOST_CLOCK_H
+#define HOST_CLOCK_H
+
+#include <stdint.h>
+#include <functional>
+
+enum class HostClockMode {
+  Wall,
+  Virtual
+};
+
+typedef std::function<void()> HostEvent;
+
+// ============ Time source ==============
+void hostSetClockMode(HostClockMode mode);
+HostClockMode hostClockMode();
+
+// Current time [ns] since program start
+uint64_t hostNanos();
+
+// Time charged for every clock read in virtual mode (keeps polling loops moving, default 50 ns)
+void hostSetClockReadCost(uint64_t ns);
+
+// Let time pass until t [ns] (virtual: jump, wall: sleep), running all events that are due on the way
+void hostAdvanceTo(uint64_t t);
+
+// Account for time spent in emulated hardware (e.g. I2C transfers), only moves the virtual clock
+void hostChargeTime(uint64_t ns);
+
+// Firmware side waiting primitive used by the rate gates (see include/Clock.h)
+void waitUntilMicros(unsigned long tWake);
+
+// ============ Event scheduler ==============
+// Run fn once at time t [ns]. Returns an id that can be used to cancel the event
+uint32_t hostSchedule(uint64_t t, HostEvent fn);
+
+// Run fn every period [ns], first at time tFirst [ns]
+uint32_t hostSchedulePeriodic(uint64_t tFirst, uint64_t period, HostEvent fn);
+
+void hostCancel(uint32_t id);
+
+// Time [ns] of the next pending event (UINT64_MAX if there is none)
+uint64_t hostNextEvent();
+
+#endif
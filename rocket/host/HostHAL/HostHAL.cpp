@@ -0,0 +1,456 @@
+// =================================
+// Host HAL - Core implementation
+// =================================
+
+/*
+* Implementation of the emulated Teensy core: time, digital pins, serial, I2C, servos, SD card and radio
+*/
+
+// =============================================================================================
+//  Preprocessor Definitions
+// =============================================================================================
+#include "HostHAL.h"
+#include <SPI.h>
+#include <vector>
+#include <deque>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+// =============================================================================================
+//  Variables/Objects
+// =============================================================================================
+HostSerial Serial;
+TwoWire Wire;
+SDClass SD;
+SPIClass SPI;
+
+SimBMI088 hostImu;
+SimTFMini hostLidar;
+
+// Digital pins
+static uint8_t pinModes[HOST_NUM_PINS] = {};
+static uint8_t pinLevels[HOST_NUM_PINS] = {};
+static void (*pinIsrs[HOST_NUM_PINS])() = {};
+static int pinIsrModes[HOST_NUM_PINS] = {};
+
+// Pulse width per pin written by Servo objects
+static int servoPulse[HOST_NUM_PINS] = {};
+
+// Radio traffic
+static std::vector<std::vector<uint8_t>> radioLog;
+static std::deque<std::vector<uint8_t>> radioAcks;
+static std::vector<uint8_t> radioRx;
+
+// SD card root directory
+static std::string sdRoot = "sd";
+static bool sdInserted = true;
+
+// Exit handlers
+static std::vector<void (*)(int)> exitHandlers;
+
+
+// =============================================================================================
+//  Time
+// =============================================================================================
+// micros(), millis() and the delays are implemented by the time source in HostClock.cpp
+
+void yield() {}
+
+
+// =============================================================================================
+//  Digital IO
+// =============================================================================================
+void pinMode(uint8_t pin, uint8_t mode) {
+  if (pin >= HOST_NUM_PINS) {
+    return;
+  }
+  pinModes[pin] = mode;
+  if (mode == INPUT_PULLUP) {
+    pinLevels[pin] = HIGH;
+  }
+}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+  if (pin >= HOST_NUM_PINS) {
+    return;
+  }
+  uint8_t prev = pinLevels[pin];
+  pinLevels[pin] = val ? HIGH : LOW;
+
+  // Edge triggered pin interrupt
+  void (*isr)() = pinIsrs[pin];
+  if (isr && prev != pinLevels[pin]) {
+    int mode = pinIsrModes[pin];
+    if (mode == CHANGE || (mode == RISING && pinLevels[pin] == HIGH) || (mode == FALLING && pinLevels[pin] == LOW)) {
+      isr();
+    }
+  }
+}
+
+uint8_t digitalRead(uint8_t pin) {
+  return pin < HOST_NUM_PINS ? pinLevels[pin] : LOW;
+}
+
+void hostSetPin(uint8_t pin, uint8_t level) {
+  digitalWrite(pin, level);
+}
+
+void attachInterrupt(uint8_t pin, void (*isr)(), int mode) {
+  if (pin < HOST_NUM_PINS) {
+    pinIsrs[pin] = isr;
+    pinIsrModes[pin] = mode;
+  }
+}
+
+void detachInterrupt(uint8_t pin) {
+  if (pin < HOST_NUM_PINS) {
+    pinIsrs[pin] = nullptr;
+  }
+}
+
+uint8_t hostPinMode(uint8_t pin) {
+  return pin < HOST_NUM_PINS ? pinModes[pin] : INPUT;
+}
+
+
+// =============================================================================================
+//  I2C
+// =============================================================================================
+// Bus time of a transfer: start + address byte + data bytes (9 clocks per byte incl. ACK) + stop
+static uint64_t busNanos(uint32_t clock, size_t bytes) {
+  return (uint64_t)(2 + 9 * (1 + bytes)) * 1000000000ULL / clock;
+}
+
+void TwoWire::beginTransmission(uint8_t address) {
+  txAddress = address & 0x7F;
+  txLength = 0;
+}
+
+size_t TwoWire::write(uint8_t data) {
+  if (txLength >= HOST_WIRE_BUFFER_SIZE) {
+    return 0;
+  }
+  txBuffer[txLength++] = data;
+  return 1;
+}
+
+size_t TwoWire::write(const uint8_t* data, size_t len) {
+  size_t n = 0;
+  while (n < len && write(data[n])) {
+    n++;
+  }
+  return n;
+}
+
+// Returns 0 on success and 2 (address NACK) if no device is attached, like the Teensy core
+uint8_t TwoWire::endTransmission(uint8_t sendStop) {
+  (void)sendStop;
+  transactions++;
+  hostChargeTime(busNanos(clock, txLength));
+  HostI2CDevice* device = devices[txAddress];
+  if (!device) {
+    return 2;
+  }
+  device->receive(txBuffer, txLength);
+  txLength = 0;
+  return 0;
+}
+
+uint8_t TwoWire::requestFrom(uint8_t address, uint8_t quantity, uint8_t sendStop) {
+  (void)sendStop;
+  transactions++;
+  rxIndex = 0;
+  rxLength = 0;
+  HostI2CDevice* device = devices[address & 0x7F];
+  if (!device) {
+    return 0;
+  }
+  if (quantity > HOST_WIRE_BUFFER_SIZE) {
+    quantity = HOST_WIRE_BUFFER_SIZE;
+  }
+  rxLength = (uint8_t)device->request(rxBuffer, quantity);
+  hostChargeTime(busNanos(clock, rxLength));
+  return rxLength;
+}
+
+bool TwoWire::hostTransfer(uint8_t address, const uint8_t* tx, size_t txLen, bool stopBeforeRead, uint8_t* rx, size_t rxLen) {
+  (void)stopBeforeRead;
+  HostI2CDevice* device = devices[address & 0x7F];
+  if (!device) {
+    return false;
+  }
+  if (txLen > 0) {
+    transactions++;
+    device->receive(tx, txLen);
+  }
+  if (rxLen > 0) {
+    transactions++;
+    memset(rx, 0, rxLen);
+    device->request(rx, rxLen);
+  }
+  return true;
+}
+
+uint64_t TwoWire::transferNanos(size_t bytes) const {
+  return busNanos(clock, bytes);
+}
+
+
+// =============================================================================================
+//  Servo
+// =============================================================================================
+uint8_t Servo::attach(int pin, int min, int max) {
+  if (pin < 0 || pin >= HOST_NUM_PINS) {
+    return 0;
+  }
+  this->pin = pin;
+  minUs = min;
+  maxUs = max;
+  return 1;
+}
+
+void Servo::detach() {
+  pin = -1;
+}
+
+void Servo::write(int value) {
+  if (value < MIN_PULSE_WIDTH) {
+    value = constrain(value, 0, 180);
+    value = map(value, 0, 180, minUs, maxUs);
+  }
+  writeMicroseconds(value);
+}
+
+void Servo::writeMicroseconds(int value) {
+  us = constrain(value, minUs, maxUs);
+  if (pin >= 0) {
+    servoPulse[pin] = us;
+  }
+}
+
+int hostServoMicros(uint8_t pin) {
+  return pin < HOST_NUM_PINS ? servoPulse[pin] : 0;
+}
+
+
+// =============================================================================================
+//  SD card
+// =============================================================================================
+void hostSetSdRoot(const char* dir) {
+  sdInserted = dir != nullptr;
+  if (sdInserted) {
+    sdRoot = dir;
+  }
+}
+
+std::string SDClass::path(const char* filepath) const {
+  std::string p = sdRoot;
+  if (filepath[0] != '/') {
+    p += '/';
+  }
+  return p + filepath;
+}
+
+bool SDClass::begin(uint8_t csPin) {
+  (void)csPin;
+  if (!sdInserted) {
+    return false;
+  }
+  ::mkdir(sdRoot.c_str(), 0755);
+  struct stat st;
+  return stat(sdRoot.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+bool SDClass::exists(const char* filepath) {
+  if (!sdInserted) {
+    return false;
+  }
+  struct stat st;
+  return stat(path(filepath).c_str(), &st) == 0;
+}
+
+File SDClass::open(const char* filepath, uint8_t mode) {
+  if (!sdInserted) {
+    return File();
+  }
+  std::string p = path(filepath);
+  FILE* fp = nullptr;
+  if (mode == FILE_READ) {
+    fp = fopen(p.c_str(), "rb");
+  }
+  else if (mode == FILE_WRITE) {
+    fp = fopen(p.c_str(), "ab+");
+  }
+  else {
+    fp = fopen(p.c_str(), "rb+");
+    if (!fp) {
+      fp = fopen(p.c_str(), "wb+");
+    }
+  }
+  return fp ? File(fp, filepath) : File();
+}
+
+bool SDClass::remove(const char* filepath) {
+  return sdInserted && ::remove(path(filepath).c_str()) == 0;
+}
+
+bool SDClass::mkdir(const char* filepath) {
+  return sdInserted && ::mkdir(path(filepath).c_str(), 0755) == 0;
+}
+
+int File::available() {
+  if (!fp) {
+    return 0;
+  }
+  uint64_t s = size();
+  uint64_t p = position();
+  return p < s ? (int)(s - p) : 0;
+}
+
+int File::peek() {
+  if (!fp) {
+    return -1;
+  }
+  int c = fgetc(fp.get());
+  if (c != EOF) {
+    ungetc(c, fp.get());
+  }
+  return c;
+}
+
+uint64_t File::size() const {
+  if (!fp) {
+    return 0;
+  }
+  struct stat st;
+  fflush(fp.get());
+  return fstat(fileno(fp.get()), &st) == 0 ? (uint64_t)st.st_size : 0;
+}
+
+FsFile SdFs::open(const char* filepath, int oflag) {
+  if (!sdInserted) {
+    return FsFile();
+  }
+  std::string p = SD.path(filepath);
+  FILE* fp = nullptr;
+  if ((oflag & O_ACCMODE) == O_RDONLY) {
+    fp = fopen(p.c_str(), "rb");
+  }
+  else if (oflag & O_TRUNC) {
+    fp = fopen(p.c_str(), "wb+");
+  }
+  else {
+    fp = fopen(p.c_str(), "rb+");
+    if (!fp && (oflag & O_CREAT)) {
+      fp = fopen(p.c_str(), "wb+");
+    }
+  }
+  return fp ? FsFile(fp, filepath) : FsFile();
+}
+
+bool FsFile::preAllocate(uint64_t length) {
+  return fp && fflush(fp.get()) == 0 && ftruncate(fileno(fp.get()), (off_t)length) == 0;
+}
+
+bool FsFile::truncate() {
+  return fp && fflush(fp.get()) == 0 && ftruncate(fileno(fp.get()), (off_t)ftell(fp.get())) == 0;
+}
+
+bool FsFile::contiguousRange(uint32_t* bgnSector, uint32_t* endSector) {
+  uint64_t sectors = size() / 512;
+  if (sectors == 0) {
+    return false;
+  }
+  *bgnSector = 0;
+  *endSector = (uint32_t)(sectors - 1);
+  return true;
+}
+
+
+// =============================================================================================
+//  Radio
+// =============================================================================================
+bool RF24::write(const void* buf, uint8_t len) {
+  const uint8_t* p = (const uint8_t*)buf;
+  radioLog.emplace_back(p, p + len);
+  if (!radioAcks.empty()) {
+    radioRx = radioAcks.front();
+    radioAcks.pop_front();
+  }
+  return true;
+}
+
+void RF24::startWrite(const void* buf, uint8_t len, const bool multicast) {
+  (void)multicast;
+  txDone = write(buf, len);
+}
+
+void RF24::whatHappened(bool& tx_ok, bool& tx_fail, bool& rx_ready) {
+  tx_ok = txDone;
+  tx_fail = false;
+  rx_ready = !radioRx.empty();
+  txDone = false;
+}
+
+bool RF24::available() {
+  return !radioRx.empty();
+}
+
+void RF24::read(void* buf, uint8_t len) {
+  memset(buf, 0, len);
+  memcpy(buf, radioRx.data(), radioRx.size() < len ? radioRx.size() : len);
+  radioRx.clear();
+}
+
+const std::vector<std::vector<uint8_t>>& hostRadioLog() {
+  return radioLog;
+}
+
+void hostRadioQueueAck(const void* buf, uint8_t len) {
+  const uint8_t* p = (const uint8_t*)buf;
+  radioAcks.emplace_back(p, p + len);
+}
+
+
+// =============================================================================================
+//  Host control
+// =============================================================================================
+void hostOnExit(void (*handler)(int code)) {
+  exitHandlers.push_back(handler);
+}
+
+void hostExit(int code) {
+  for (auto handler : exitHandlers) {
+    handler(code);
+  }
+  Serial.flush();
+  exit(code);
+}
+
+void hostInit(int argc, char** argv) {
+  // Simulate faster than real time unless --realtime is given
+  hostSetClockMode(HostClockMode::Virtual);
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--sd" && i + 1 < argc) {
+      hostSetSdRoot(argv[++i]);
+    }
+    else if (arg == "--quiet") {
+      Serial.setOutput(nullptr);
+    }
+    else if (arg == "--realtime") {
+      hostSetClockMode(HostClockMode::Wall);
+    }
+    else {
+      fprintf(stderr, "Unknown argument: %s\n", arg.c_str());
+      fprintf(stderr, "Usage: %s [--sd DIR] [--quiet] [--realtime]\n", argv[0]);
+      exit(2);
+    }
+  }
+
+  // Connect the simulated sensors to the I2C bus
+  hostImu.attach(Wire);
+  hostLidar.attach(Wire);
+}
@@ -0,0 +1,38 @@
+// ==================================
+// Host HAL - Host side control API
+// ==================================
+
+/*
+* Functions and objects that only exist in the host build
+* They are used by the host main and the simulation to drive the emulated hardware
+*/
+
+#pragma once
+
+#ifndef HOST_HAL_H
+#define HOST_HAL_H
+
+#include <Arduino.h>
+#include <Wire.h>
+#include <Servo.h>
+#include <SD.h>
+#include <RF24.h>
+#include "SimBMI088.h"
+#include "SimTFMini.h"
+#include "HostClock.h"
+
+// Simulated sensors attached to Wire by hostInit()
+extern SimBMI088 hostImu;
+extern SimTFMini hostLidar;
+
+// Parse the command line and attach the simulated devices
+void hostInit(int argc, char** argv);
+
+// Drive an input pin from the outside (buttons, interrupt lines)
+void hostSetPin(uint8_t pin, uint8_t level);
+uint8_t hostPinMode(uint8_t pin);
+
+// Register a function that is called when the firmware ends the host process
+void hostOnExit(void (*handler)(int code));
+
+#endif
@@ -0,0 +1,71 @@
+// ==========================
+// Host HAL - Serial monitor
+// ==========================
+
+/*
+* Serial port replacement that writes to stdout (or nowhere when muted)
+* Supports the print overloads used by the firmware, including the HEX/DEC base argument
+*/
+
+#pragma once
+
+#ifndef HOST_SERIAL_H
+#define HOST_SERIAL_H
+
+#include <stdio.h>
+#include <string.h>
+#include "WString.h"
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+class HostSerial {
+public:
+  void begin(unsigned long baud) { (void)baud; }
+  void end() {}
+  explicit operator bool() const { return true; }
+
+  int available() { return 0; }
+  int read() { return -1; }
+  int peek() { return -1; }
+  void flush() { if (out) fflush(out); }
+
+  // Redirect the serial output (nullptr mutes it, e.g. for batch simulations)
+  void setOutput(FILE* stream) { out = stream; }
+
+  size_t print(const char* str) { return put(str); }
+  size_t print(const String& str) { return put(str.c_str()); }
+  size_t print(char c) { char buf[2] = {c, 0}; return put(buf); }
+  size_t print(unsigned char value, int base = DEC) { return put(String((unsigned long)value, base).c_str()); }
+  size_t print(int value, int base = DEC) { return put(String((long)value, base).c_str()); }
+  size_t print(unsigned int value, int base = DEC) { return put(String((unsigned long)value, base).c_str()); }
+  size_t print(long value, int base = DEC) { return put(String(value, base).c_str()); }
+  size_t print(unsigned long value, int base = DEC) { return put(String(value, base).c_str()); }
+  size_t print(double value, int digits = 2) { return put(String(value, digits).c_str()); }
+
+  size_t println() { return put("\r\n"); }
+  template <class T>
+  size_t println(const T& value) { size_t n = print(value); return n + println(); }
+  template <class T>
+  size_t println(const T& value, int format) { size_t n = print(value, format); return n + println(); }
+
+  template <class... Args>
+  int printf(const char* format, Args... args) {
+    if (!out) return 0;
+    return fprintf(out, format, args...);
+  }
+
+private:
+  FILE* out = stdout;
+
+  size_t put(const char* str) {
+    if (!out) return 0;
+    return fputs(str, out) < 0 ? 0 : strlen(str);
+  }
+};
+
+extern HostSerial Serial;
+
+#endif
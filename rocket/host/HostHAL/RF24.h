@@ -0,0 +1,62 @@
+// ========================
+// Host HAL - RF24 library
+// ========================
+
+/*
+* nRF24L01 radio replacement. Every payload written by the firmware is kept in a host side log
+* (hostRadioLog) so that telemetry can be inspected by the simulation. Acknowledge payloads from
+* the ground controller can be queued with hostRadioQueueAck.
+*/
+
+#pragma once
+
+#ifndef HOST_RF24_H
+#define HOST_RF24_H
+
+#include <Arduino.h>
+#include <vector>
+
+typedef enum { RF24_PA_MIN = 0, RF24_PA_LOW, RF24_PA_HIGH, RF24_PA_MAX, RF24_PA_ERROR } rf24_pa_dbm_e;
+typedef enum { RF24_1MBPS = 0, RF24_2MBPS, RF24_250KBPS } rf24_datarate_e;
+
+class RF24 {
+public:
+  RF24(uint16_t cePin, uint16_t csnPin) : cePin(cePin), csnPin(csnPin) {}
+
+  bool begin() { return true; }
+  bool isChipConnected() { return true; }
+  void setPALevel(uint8_t level, bool lnaEnable = true) { (void)level; (void)lnaEnable; }
+  bool setDataRate(rf24_datarate_e speed) { (void)speed; return true; }
+  void setRetries(uint8_t delay, uint8_t count) { (void)delay; (void)count; }
+  void setChannel(uint8_t ch) { channel = ch; }
+  void enableAckPayload() {}
+  void enableDynamicPayloads() {}
+  void openWritingPipe(const uint8_t* address) { (void)address; }
+  void openReadingPipe(uint8_t number, const uint8_t* address) { (void)number; (void)address; }
+  void startListening() {}
+  void stopListening() {}
+  void printPrettyDetails() { Serial.println("RF24 (host simulation)"); }
+
+  bool write(const void* buf, uint8_t len);
+  bool available();
+  void read(void* buf, uint8_t len);
+
+  // Non-blocking write: the payload is acknowledged at once, whatHappened() reports it (and clears it)
+  void startWrite(const void* buf, uint8_t len, const bool multicast);
+  void whatHappened(bool& tx_ok, bool& tx_fail, bool& rx_ready);
+  uint8_t flush_tx() { return 0; }
+
+private:
+  uint16_t cePin;
+  uint16_t csnPin;
+  uint8_t channel = 76;
+  bool txDone = false;
+};
+
+// All payloads transmitted so far (one entry per RF24::write / startWrite)
+const std::vector<std::vector<uint8_t>>& hostRadioLog();
+
+// Queue an acknowledge payload that is returned by the next successful write
+void hostRadioQueueAck(const void* buf, uint8_t len);
+
+#endif
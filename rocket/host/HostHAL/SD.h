@@ -0,0 +1,105 @@
+// ======================
+// Host HAL - SD library
+// ======================
+
+/*
+* SD card replacement that maps the card to a directory on the host file system
+* (set with hostSetSdRoot, "sd" in the working directory by default)
+* SD.sdfs is the part of the SdFat layer used for preallocated files (FsFile), the card erase is a no-op
+*/
+
+#pragma once
+
+#ifndef HOST_SD_H
+#define HOST_SD_H
+
+#include <Arduino.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <memory>
+#include <string>
+
+#define BUILTIN_SDCARD 254
+
+#define FILE_READ        0
+#define FILE_WRITE       1   // Read/write, created if missing, writes are appended
+#define FILE_WRITE_BEGIN 2   // Read/write, created if missing, positioned at the start (not truncated)
+
+class File {
+public:
+  File() {}
+  File(FILE* fp, const char* name) : fp(fp, fclose), fileName(name) {}
+
+  explicit operator bool() const { return (bool)fp; }
+  const char* name() const { return fileName.c_str(); }
+
+  size_t write(uint8_t b) { return write(&b, 1); }
+  size_t write(const uint8_t* buf, size_t size) { return fp ? fwrite(buf, 1, size, fp.get()) : 0; }
+  size_t write(const char* buf, size_t size) { return write((const uint8_t*)buf, size); }
+  size_t print(const String& str) { return write(str.c_str(), str.length()); }
+  size_t print(const char* str) { return write(str, strlen(str)); }
+  size_t println(const String& str) { return print(str) + print("\r\n"); }
+
+  int read() { return fp ? fgetc(fp.get()) : -1; }
+  int read(void* buf, size_t nbyte) { return fp ? (int)fread(buf, 1, nbyte, fp.get()) : -1; }
+  int available();
+  int peek();
+
+  bool seek(uint64_t pos) { return fp && fseek(fp.get(), (long)pos, SEEK_SET) == 0; }
+  uint64_t position() const { return fp ? (uint64_t)ftell(fp.get()) : 0; }
+  uint64_t size() const;
+
+  void flush() { if (fp) fflush(fp.get()); }
+  void close() { fp.reset(); }
+
+protected:
+  std::shared_ptr<FILE> fp;
+  std::string fileName;
+};
+
+// ====== SdFat layer ======
+class FsFile : public File {
+public:
+  using File::File;
+
+  bool preAllocate(uint64_t length);          // Size the file to length bytes, the position stays
+  bool truncate();                             // Cut the file at the current position
+  bool contiguousRange(uint32_t* bgnSector, uint32_t* endSector);
+  bool isBusy() { return false; }
+};
+
+class SdCard {
+public:
+  bool erase(uint32_t firstSector, uint32_t lastSector) { (void)firstSector; (void)lastSector; return true; }
+};
+
+class SdFs {
+public:
+  FsFile open(const char* filepath, int oflag = O_RDONLY);
+  SdCard* card() { return &sdCard; }
+
+private:
+  SdCard sdCard;
+};
+
+class SDClass {
+public:
+  bool begin(uint8_t csPin = BUILTIN_SDCARD);
+  bool exists(const char* filepath);
+  File open(const char* filepath, uint8_t mode = FILE_READ);
+  bool remove(const char* filepath);
+  bool mkdir(const char* filepath);
+
+  SdFs sdfs;
+
+private:
+  friend class SdFs;
+  std::string path(const char* filepath) const;
+};
+
+extern SDClass SD;
+
+// Directory on the host used as the root of the simulated SD card (nullptr: no card inserted)
+void hostSetSdRoot(const char* dir);
+
+#endif
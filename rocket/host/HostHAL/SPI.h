@@ -0,0 +1,20 @@
+// ===================
+// Host HAL - SPI bus
+// ===================
+
+#pragma once
+
+#ifndef HOST_SPI_H
+#define HOST_SPI_H
+
+#include <Arduino.h>
+
+class SPIClass {
+public:
+  void begin() {}
+  void end() {}
+};
+
+extern SPIClass SPI;
+
+#endif
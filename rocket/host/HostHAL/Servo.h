@@ -0,0 +1,45 @@
+// =========================
+// Host HAL - Servo library
+// =========================
+
+/*
+* Servo/ESC output replacement. The commanded pulse width of every attached pin is stored so that
+* the simulation can read the actuator commands back (hostServoMicros)
+*/
+
+#pragma once
+
+#ifndef HOST_SERVO_H
+#define HOST_SERVO_H
+
+#include <Arduino.h>
+
+#define MIN_PULSE_WIDTH       544
+#define MAX_PULSE_WIDTH      2400
+#define DEFAULT_PULSE_WIDTH  1500
+
+class Servo {
+public:
+  uint8_t attach(int pin) { return attach(pin, MIN_PULSE_WIDTH, MAX_PULSE_WIDTH); }
+  uint8_t attach(int pin, int min, int max);
+  void detach();
+
+  // Values below MIN_PULSE_WIDTH are treated as an angle [degrees], larger values as a pulse width [us]
+  void write(int value);
+  void writeMicroseconds(int value);
+
+  int read() const { return map(us, minUs, maxUs, 0, 180); }
+  int readMicroseconds() const { return us; }
+  bool attached() const { return pin >= 0; }
+
+private:
+  int pin = -1;
+  int minUs = MIN_PULSE_WIDTH;
+  int maxUs = MAX_PULSE_WIDTH;
+  int us = DEFAULT_PULSE_WIDTH;
+};
+
+// Last pulse width [us] written to the given pin (0 if nothing is attached to it)
+int hostServoMicros(uint8_t pin);
+
+#endif
@@ -0,0 +1,315 @@
+// ====================================
+// Host HAL - Simulated BMI088 (I2C)
+// ====================================
+
+#include "SimBMI088.h"
+#include "HostHAL.h"
+
+// =============================================================================================
+//  Definitions
+// =============================================================================================
+#define ACC_CHIP_ID_VALUE   0x1E
+#define GYRO_CHIP_ID_VALUE  0x0F
+
+#define ACC_REG_X_LSB       0x12
+#define ACC_REG_TEMP_MSB    0x22
+#define ACC_REG_FIFO_LENGTH 0x24
+#define ACC_REG_FIFO_DATA   0x26
+#define ACC_REG_CONF        0x40
+#define ACC_REG_RANGE       0x41
+#define ACC_REG_FIFO_WTM    0x46
+#define ACC_REG_FIFO_CONFIG 0x49
+#define ACC_REG_INT1_IO     0x53
+#define ACC_REG_INT_MAP     0x58
+#define ACC_REG_SOFT_RESET  0x7E
+#define GYRO_REG_X_LSB      0x02
+#define GYRO_REG_FIFO_STATUS 0x0E
+#define GYRO_REG_RANGE      0x0F
+#define GYRO_REG_BANDWIDTH  0x10
+#define GYRO_REG_INT_CTRL   0x15
+#define GYRO_REG_INT_MAP    0x18
+#define GYRO_REG_FIFO_WM_EN 0x1E
+#define GYRO_REG_FIFO_WM    0x3D
+#define GYRO_REG_FIFO_MODE  0x3E
+#define GYRO_REG_FIFO_DATA  0x3F
+
+#define ACC_FIFO_BYTES      1024
+#define GYRO_FIFO_FRAMES    100
+
+// Convert a physical value to a raw 16 bit two's complement register value
+static int16_t toRaw(float value, float range) {
+  float raw = value / range * 32768.0f;
+  if (raw > 32767.0f) {
+    raw = 32767.0f;
+  }
+  else if (raw < -32768.0f) {
+    raw = -32768.0f;
+  }
+  return (int16_t)lroundf(raw);
+}
+
+static void putLe16(uint8_t* regs, uint8_t reg, int16_t value) {
+  regs[reg] = (uint8_t)(value & 0xFF);
+  regs[reg + 1] = (uint8_t)((uint16_t)value >> 8);
+}
+
+
+// =============================================================================================
+//  Functions
+// =============================================================================================
+SimBMI088::SimBMI088() {
+  acc.owner = this;
+  gyro.owner = this;
+  gyro.isGyro = true;
+
+  acc.regs[0x00] = ACC_CHIP_ID_VALUE;
+  acc.regs[ACC_REG_RANGE] = 0x01;     // 6 g after power on
+  acc.regs[0x40] = 0xA8;              // ACC_CONF reset value
+  acc.regs[ACC_REG_FIFO_CONFIG] = 0x10;
+  gyro.regs[0x00] = GYRO_CHIP_ID_VALUE;
+  gyro.regs[GYRO_REG_RANGE] = 0x00;   // 2000 dps after power on
+
+  encodeAcc();
+  encodeGyro();
+}
+
+void SimBMI088::attach(TwoWire& bus, uint8_t accAddress, uint8_t gyroAddress) {
+  bus.attachDevice(accAddress, &acc);
+  bus.attachDevice(gyroAddress, &gyro);
+}
+
+void SimBMI088::setAcceleration(float x, float y, float z) {
+  accMg[0] = x;
+  accMg[1] = y;
+  accMg[2] = z;
+  encodeAcc();
+}
+
+void SimBMI088::setGyroscope(float x, float y, float z) {
+  gyroDps[0] = x;
+  gyroDps[1] = y;
+  gyroDps[2] = z;
+  encodeGyro();
+}
+
+void SimBMI088::setTemperature(float celsius) {
+  temperature = celsius;
+  encodeAcc();
+}
+
+void SimBMI088::setBias(const float accMg[3], const float gyroDps[3]) {
+  for (int i = 0; i < 3; i++) {
+    accBias[i] = accMg[i];
+    gyroBias[i] = gyroDps[i];
+  }
+  encodeAcc();
+  encodeGyro();
+}
+
+// ====== Data-ready interrupts ======
+void SimBMI088::connectInterrupts(uint8_t int1Pin, uint8_t int3Pin) {
+  accIntPin = int1Pin;
+  gyroIntPin = int3Pin;
+  scheduleAccReady(hostNanos());
+  scheduleGyroReady(hostNanos());
+}
+
+float SimBMI088::accOutputDataRate() const {
+  // 12.5 Hz * 2^(odr - 5), odr 0x05 - 0x0C
+  int odr = std::max(0x05, std::min(0x0C, acc.regs[ACC_REG_CONF] & 0x0F));
+  return 12.5f * float(1 << (odr - 0x05));
+}
+
+float SimBMI088::gyroOutputDataRate() const {
+  static const float rates[] = {2000.0f, 2000.0f, 1000.0f, 400.0f, 200.0f, 100.0f, 200.0f, 100.0f};
+  return rates[gyro.regs[GYRO_REG_BANDWIDTH] & 0x07];
+}
+
+void SimBMI088::pulse(uint8_t pin) {
+  hostSetPin(pin, HIGH);
+  hostSetPin(pin, LOW);
+}
+
+// Each line pulses once per output data period (the data is ready at the end of the period)
+void SimBMI088::scheduleAccReady(uint64_t t) {
+  uint64_t tNext = t + (uint64_t)(1e9 / accOutputDataRate());
+  hostSchedule(tNext, [this, tNext]() {
+    pushAccFrame();
+    if ((acc.regs[ACC_REG_INT1_IO] & 0x08) && (acc.regs[ACC_REG_INT_MAP] & 0x04)) {
+      pulse(accIntPin);
+    }
+    scheduleAccReady(tNext);
+  });
+}
+
+void SimBMI088::scheduleGyroReady(uint64_t t) {
+  uint64_t tNext = t + (uint64_t)(1e9 / gyroOutputDataRate());
+  hostSchedule(tNext, [this, tNext]() {
+    pushGyroFrame();
+    if ((gyro.regs[GYRO_REG_INT_CTRL] & 0x80) && (gyro.regs[GYRO_REG_INT_MAP] & 0x01)) {
+      pulse(gyroIntPin);
+    }
+    scheduleGyroReady(tNext);
+  });
+}
+
+// ====== FIFOs ======
+// Accelerometer: header 0x84 + data registers, a skip frame at the front counts the frames lost when full
+void SimBMI088::pushAccFrame() {
+  if (!(acc.regs[ACC_REG_FIFO_CONFIG] & 0x40)) {
+    return;
+  }
+  encodeAcc();
+  FifoFrame frame = {7, {0x84}};
+  memcpy(&frame.data[1], &acc.regs[ACC_REG_X_LSB], 6);
+  acc.fifo.push_back(frame);
+  acc.fifoBytes += frame.len;
+
+  while (acc.fifoBytes > ACC_FIFO_BYTES) {
+    FifoFrame& front = acc.fifo.front();
+    if (front.data[0] == 0x40) {
+      // Drop the frame behind the skip frame and count it
+      acc.fifo.erase(acc.fifo.begin() + 1);
+      acc.fifoBytes -= 7;
+      front.data[1] = (uint8_t)std::min(255, front.data[1] + 1);
+    }
+    else {
+      acc.fifoBytes -= front.len;
+      acc.fifo.pop_front();
+      acc.fifo.push_front({2, {0x40, 1}});
+      acc.fifoBytes += 2;
+    }
+  }
+
+  uint16_t watermark = acc.regs[ACC_REG_FIFO_WTM] | ((acc.regs[ACC_REG_FIFO_WTM + 1] & 0x1F) << 8);
+  bool crossed = acc.fifoBytes >= watermark && acc.fifoBytes - frame.len < watermark;
+  if (crossed && (acc.regs[ACC_REG_INT1_IO] & 0x08) && (acc.regs[ACC_REG_INT_MAP] & 0x01)) {
+    pulse(accIntPin);
+  }
+}
+
+// Gyroscope: 6 data bytes per frame, overrun flag when full
+void SimBMI088::pushGyroFrame() {
+  if (!(gyro.regs[GYRO_REG_FIFO_MODE] & 0xC0)) {
+    return;
+  }
+  encodeGyro();
+  FifoFrame frame = {6, {}};
+  memcpy(frame.data, &gyro.regs[GYRO_REG_X_LSB], 6);
+  gyro.fifo.push_back(frame);
+  if (gyro.fifo.size() > GYRO_FIFO_FRAMES) {
+    gyro.fifo.pop_front();
+    gyro.overrun = true;
+  }
+  gyro.fifoBytes = gyro.fifo.size() * 6;
+
+  size_t watermark = gyro.regs[GYRO_REG_FIFO_WM] & 0x7F;
+  bool enabled = (gyro.regs[GYRO_REG_FIFO_WM_EN] & 0x80) && (gyro.regs[GYRO_REG_INT_CTRL] & 0x40) &&
+                 (gyro.regs[GYRO_REG_INT_MAP] & 0x04);
+  if (enabled && gyro.fifo.size() == watermark) {
+    pulse(gyroIntPin);
+  }
+}
+
+void SimBMI088::Slave::clearFifo() {
+  fifo.clear();
+  fifoBytes = 0;
+  overrun = false;
+}
+
+void SimBMI088::encodeAcc() {
+  float range = 3000.0f * float(1 << (acc.regs[ACC_REG_RANGE] & 0x03));
+  for (int i = 0; i < 3; i++) {
+    putLe16(acc.regs, ACC_REG_X_LSB + 2 * i, toRaw(accMg[i] + accBias[i] + accNoise * normal(rng), range));
+  }
+
+  // 11 bit temperature, 0.125 degC/LSB with 23 degC offset (MSB first)
+  int16_t t = (int16_t)lroundf((temperature - 23.0f) * 8.0f);
+  uint16_t raw11 = (uint16_t)t & 0x07FF;
+  acc.regs[ACC_REG_TEMP_MSB] = (uint8_t)(raw11 >> 3);
+  acc.regs[ACC_REG_TEMP_MSB + 1] = (uint8_t)((raw11 & 0x07) << 5);
+}
+
+void SimBMI088::encodeGyro() {
+  static const float ranges[] = {2000.0f, 1000.0f, 500.0f, 250.0f, 125.0f};
+  uint8_t code = gyro.regs[GYRO_REG_RANGE];
+  float range = ranges[code <= 4 ? code : 0];
+  for (int i = 0; i < 3; i++) {
+    putLe16(gyro.regs, GYRO_REG_X_LSB + 2 * i, toRaw(gyroDps[i] + gyroBias[i] + gyroNoise * normal(rng), range));
+  }
+}
+
+// Register write: first byte selects the register, the following bytes are written with auto increment
+void SimBMI088::Slave::receive(const uint8_t* data, size_t len) {
+  if (len == 0) {
+    return;
+  }
+  pointer = data[0] & 0x7F;
+  for (size_t i = 1; i < len; i++) {
+    regs[pointer] = data[i];
+
+    // FIFO flush command / gyroscope FIFO mode change
+    if ((!isGyro && pointer == ACC_REG_SOFT_RESET && data[i] == 0xB0) || (isGyro && pointer == GYRO_REG_FIFO_MODE)) {
+      clearFifo();
+    }
+    pointer = (pointer + 1) & 0x7F;
+  }
+
+  // Range changes affect how the stored physical values are encoded
+  if (isGyro) {
+    owner->encodeGyro();
+  }
+  else {
+    owner->encodeAcc();
+  }
+}
+
+// Register read with auto increment from the last selected register
+size_t SimBMI088::Slave::request(uint8_t* buf, size_t len) {
+  // Every read of the data registers returns a new noisy sample
+  if (isGyro && pointer >= GYRO_REG_X_LSB && pointer < GYRO_REG_X_LSB + 6) {
+    owner->encodeGyro();
+  }
+  else if (!isGyro && pointer >= ACC_REG_X_LSB && pointer < ACC_REG_X_LSB + 6) {
+    owner->encodeAcc();
+  }
+
+  // FIFO data: the address does not increment, whole frames are removed once they are read completely
+  uint8_t fifoData = isGyro ? GYRO_REG_FIFO_DATA : ACC_REG_FIFO_DATA;
+  if (pointer == fifoData) {
+    size_t offset = 0;
+    for (size_t i = 0; i < len; i++) {
+      if (fifo.empty()) {
+        buf[i] = isGyro || offset > 0 ? 0x00 : 0x80;
+        offset++;
+        continue;
+      }
+      const FifoFrame& frame = fifo.front();
+      buf[i] = frame.data[offset++];
+      if (offset == frame.len) {
+        fifoBytes -= frame.len;
+        fifo.pop_front();
+        offset = 0;
+      }
+    }
+    return len;
+  }
+
+  // Fill levels
+  if (isGyro) {
+    regs[GYRO_REG_FIFO_STATUS] = (uint8_t)(fifo.size() | (overrun ? 0x80 : 0x00));
+    if (pointer == GYRO_REG_FIFO_STATUS) {
+      overrun = false;
+    }
+  }
+  else {
+    regs[ACC_REG_FIFO_LENGTH] = (uint8_t)(fifoBytes & 0xFF);
+    regs[ACC_REG_FIFO_LENGTH + 1] = (uint8_t)(fifoBytes >> 8);
+  }
+
+  for (size_t i = 0; i < len; i++) {
+    buf[i] = regs[pointer];
+    pointer = (pointer + 1) & 0x7F;
+  }
+  return len;
+}
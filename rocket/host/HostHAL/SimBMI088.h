@@ -0,0 +1,112 @@
+// ====================================
+// Host HAL - Simulated BMI088 (I2C)
+// ====================================
+
+/*
+* Register level model of the BMI088 accelerometer (0x19) and gyroscope (0x69) I2C slaves
+* The simulation sets the physical values (sensor frame, [mg] and [dps]) and the model encodes them
+* into the data registers according to the range currently configured by the driver
+* Once the interrupt pins are connected, the data-ready lines (INT1 accelerometer, INT3 gyroscope) pulse at
+* the configured output data rate while the driver has the interrupt enabled and mapped
+*
+* Both FIFOs are modelled in stream mode: a frame is stored per output data period while the FIFO is
+* enabled, the oldest frames are dropped when it is full (skip frame / overrun flag), the fill level and
+* FIFO data registers are read like on the chip (a partially read frame is sent again) and the watermark
+* interrupts pulse the same pins when the fill level reaches the watermark
+*/
+
+#pragma once
+
+#ifndef SIM_BMI088_H
+#define SIM_BMI088_H
+
+#include <Arduino.h>
+#include <Wire.h>
+#include <random>
+#include <deque>
+
+class SimBMI088 {
+public:
+  SimBMI088();
+
+  // Register both slaves on the bus
+  void attach(TwoWire& bus, uint8_t accAddress = 0x19, uint8_t gyroAddress = 0x69);
+
+  // Physical values seen by the sensor (sensor frame)
+  void setAcceleration(float x, float y, float z);   // [mg]
+  void setGyroscope(float x, float y, float z);      // [dps]
+  void setTemperature(float celsius);
+
+  // White measurement noise added to every read (standard deviation, defaults from the datasheet noise densities)
+  void setNoise(float accMgStd, float gyroDpsStd) { accNoise = accMgStd; gyroNoise = gyroDpsStd; }
+  float accNoiseStd() const { return accNoise; }
+  float gyroNoiseStd() const { return gyroNoise; }
+  void seed(uint32_t value) { rng.seed(value); }
+
+  // Constant sensor bias (sensor frame) added to every read [mg], [dps]
+  void setBias(const float accMg[3], const float gyroDps[3]);
+
+  // Pulse the data-ready interrupt lines at the output data rate (host pins)
+  void connectInterrupts(uint8_t int1Pin, uint8_t int3Pin);
+
+  // Output data rates currently configured by the driver [Hz]
+  float accOutputDataRate() const;
+  float gyroOutputDataRate() const;
+
+  // Register access for the simulation
+  uint8_t accRegister(uint8_t reg) const { return acc.regs[reg & 0x7F]; }
+  uint8_t gyroRegister(uint8_t reg) const { return gyro.regs[reg & 0x7F]; }
+
+  // FIFO fill levels (frames) for the simulation
+  size_t accFifoFrames() const { return acc.fifo.size(); }
+  size_t gyroFifoFrames() const { return gyro.fifo.size(); }
+
+private:
+  struct FifoFrame {
+    uint8_t len;
+    uint8_t data[7];
+  };
+
+  struct Slave : public HostI2CDevice {
+    SimBMI088* owner = nullptr;
+    bool isGyro = false;
+    uint8_t regs[128] = {};
+    uint8_t pointer = 0;
+
+    std::deque<FifoFrame> fifo;
+    size_t fifoBytes = 0;
+    bool overrun = false;
+
+    void receive(const uint8_t* data, size_t len) override;
+    size_t request(uint8_t* buf, size_t len) override;
+    void clearFifo();
+  };
+
+  Slave acc;
+  Slave gyro;
+
+  float accMg[3] = {0.0f, 0.0f, 1000.0f};
+  float gyroDps[3] = {0.0f, 0.0f, 0.0f};
+  float temperature = 25.0f;
+
+  float accBias[3] = {0.0f, 0.0f, 0.0f};
+  float gyroBias[3] = {0.0f, 0.0f, 0.0f};
+
+  float accNoise = 2.0f;
+  float gyroNoise = 0.1f;
+  std::mt19937 rng;
+  std::normal_distribution<float> normal;
+
+  uint8_t accIntPin = 0xFF;
+  uint8_t gyroIntPin = 0xFF;
+
+  void encodeAcc();
+  void encodeGyro();
+  void scheduleAccReady(uint64_t t);
+  void scheduleGyroReady(uint64_t t);
+  void pushAccFrame();
+  void pushGyroFrame();
+  void pulse(uint8_t pin);
+};
+
+#endif
@@ -0,0 +1,72 @@
+// =========================================
+// Host HAL - Simulated TFMini-Plus (I2C)
+// =========================================
+
+#include "SimTFMini.h"
+
+// =============================================================================================
+//  Functions
+// =============================================================================================
+
+// Command frame: 0x5A, length, command id, payload..., checksum
+void SimTFMini::receive(const uint8_t* data, size_t len) {
+  replyLen = 0;
+  if (len < 3 || data[0] != 0x5A) {
+    return;
+  }
+
+  uint8_t id = data[2];
+
+  // 0x06 (frame format) and 0x00 (trigger) do not reply, all other commands get a generic PASS reply
+  if (id == 0x00 || id == 0x06) {
+    return;
+  }
+  replyLen = (id == 0x01) ? 7 : 5;  // 0x01 = firmware version
+  memset(reply, 0, sizeof(reply));
+  reply[0] = 0x5A;
+  reply[1] = replyLen;
+  reply[2] = id;
+  if (id == 0x01) {
+    reply[3] = 3;  // v2.0.3
+    reply[4] = 0;
+    reply[5] = 2;
+  }
+  uint16_t sum = 0;
+  for (uint8_t i = 0; i < replyLen - 1; i++) {
+    sum += reply[i];
+  }
+  reply[replyLen - 1] = (uint8_t)sum;
+}
+
+size_t SimTFMini::request(uint8_t* buf, size_t len) {
+  // Pending command reply
+  if (replyLen > 0) {
+    size_t n = len < replyLen ? len : replyLen;
+    memcpy(buf, reply, n);
+    replyLen = 0;
+    return n;
+  }
+
+  bool lost = dropout || (dropoutRate > 0.0f && uniform(rng) < dropoutRate);
+  int16_t dist = lost ? 0 : distance;
+  int16_t strength = lost ? 0 : flux;
+  int16_t temp = (int16_t)((lroundf(temperature) + 256) << 3);
+
+  uint8_t frame[9] = {
+    0x59, 0x59,
+    (uint8_t)(dist & 0xFF), (uint8_t)((uint16_t)dist >> 8),
+    (uint8_t)(strength & 0xFF), (uint8_t)((uint16_t)strength >> 8),
+    (uint8_t)(temp & 0xFF), (uint8_t)((uint16_t)temp >> 8),
+    0
+  };
+  uint16_t sum = 0;
+  for (int i = 0; i < 8; i++) {
+    sum += frame[i];
+  }
+  frame[8] = (uint8_t)sum;
+
+  size_t n = len < sizeof(frame) ? len : sizeof(frame);
+  memcpy(buf, frame, n);
+  frames++;
+  return n;
+}
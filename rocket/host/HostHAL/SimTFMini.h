@@ -0,0 +1,55 @@
+// =========================================
+// Host HAL - Simulated TFMini-Plus (I2C)
+// =========================================
+
+/*
+* Model of the TFMini-Plus lidar I2C slave (0x10)
+* Commands written by the driver are accepted (and acknowledged when the command expects a reply),
+* every read returns a 9 byte data frame with the distance set by the simulation
+*/
+
+#pragma once
+
+#ifndef SIM_TFMINI_H
+#define SIM_TFMINI_H
+
+#include <Arduino.h>
+#include <Wire.h>
+#include <random>
+
+class SimTFMini : public HostI2CDevice {
+public:
+  void attach(TwoWire& bus, uint8_t address = 0x10) { bus.attachDevice(address, this); }
+
+  // Measured distance [cm] and signal strength reported in the next frames
+  void setDistance(int16_t cm) { distance = cm; }
+  void setSignal(int16_t strength) { flux = strength; }
+  void setTemperature(float celsius) { temperature = celsius; }
+
+  // A dropped out measurement is reported the way the sensor does it (distance 0, no signal)
+  void setDropout(bool enabled) { dropout = enabled; }
+
+  // Probability that a frame is a dropout (independent per frame)
+  void setDropoutRate(float probability) { dropoutRate = probability; }
+  void seed(uint32_t value) { rng.seed(value); }
+
+  unsigned long frameCount() const { return frames; }
+
+  void receive(const uint8_t* data, size_t len) override;
+  size_t request(uint8_t* buf, size_t len) override;
+
+private:
+  int16_t distance = 10;
+  int16_t flux = 1000;
+  float temperature = 25.0f;
+  bool dropout = false;
+  float dropoutRate = 0.0f;
+  unsigned long frames = 0;
+  std::mt19937 rng;
+  std::uniform_real_distribution<float> uniform;
+
+  uint8_t reply[8] = {};
+  uint8_t replyLen = 0;
+};
+
+#endif
@@ -0,0 +1,86 @@
+// ==========================
+// Host HAL - Arduino String
+// ==========================
+
+/*
+* std::string backed replacement of the Arduino String class
+* Number formatting follows the Arduino core (floats are printed with 2 decimals unless told otherwise)
+*/
+
+#pragma once
+
+#ifndef HOST_WSTRING_H
+#define HOST_WSTRING_H
+
+#include <string>
+#include <stdio.h>
+#include <type_traits>
+
+class String {
+public:
+  String() {}
+  String(const char* cstr) : s(cstr ? cstr : "") {}
+  String(const std::string& str) : s(str) {}
+  explicit String(char c) : s(1, c) {}
+  explicit String(unsigned char value, unsigned char base = 10) : s(fromInt(value, base)) {}
+  explicit String(int value, unsigned char base = 10) : s(fromInt(value, base)) {}
+  explicit String(unsigned int value, unsigned char base = 10) : s(fromInt(value, base)) {}
+  explicit String(long value, unsigned char base = 10) : s(fromInt(value, base)) {}
+  explicit String(unsigned long value, unsigned char base = 10) : s(fromInt(value, base)) {}
+  explicit String(float value, unsigned char decimalPlaces = 2) : s(fromFloat(value, decimalPlaces)) {}
+  explicit String(double value, unsigned char decimalPlaces = 2) : s(fromFloat(value, decimalPlaces)) {}
+
+  unsigned int length() const { return (unsigned int)s.length(); }
+  const char* c_str() const { return s.c_str(); }
+  char charAt(unsigned int index) const { return index < s.length() ? s[index] : 0; }
+  char operator[](unsigned int index) const { return charAt(index); }
+
+  String& operator+=(const String& rhs) { s += rhs.s; return *this; }
+  String& operator+=(const char* rhs) { s += rhs; return *this; }
+  String& operator+=(char c) { s += c; return *this; }
+
+  bool operator==(const String& rhs) const { return s == rhs.s; }
+  bool operator!=(const String& rhs) const { return s != rhs.s; }
+
+  void reserve(unsigned int size) { s.reserve(size); }
+
+  const std::string& str() const { return s; }
+
+private:
+  std::string s;
+
+  template <class T>
+  static std::string fromInt(T value, unsigned char base) {
+    char buf[8 * sizeof(T) + 2];
+    if (base == 16) {
+      snprintf(buf, sizeof(buf), "%llX", (unsigned long long)value);
+    }
+    else if (base == 2) {
+      unsigned long long v = (unsigned long long)value;
+      int n = 0;
+      char tmp[8 * sizeof(T) + 1];
+      do { tmp[n++] = char('0' + (v & 1)); v >>= 1; } while (v);
+      for (int i = 0; i < n; i++) buf[i] = tmp[n - 1 - i];
+      buf[n] = 0;
+    }
+    else if (std::is_signed<T>::value) {
+      snprintf(buf, sizeof(buf), "%lld", (long long)value);
+    }
+    else {
+      snprintf(buf, sizeof(buf), "%llu", (unsigned long long)value);
+    }
+    return buf;
+  }
+
+  static std::string fromFloat(double value, unsigned char decimalPlaces) {
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%.*f", decimalPlaces, value);
+    return buf;
+  }
+};
+
+inline String operator+(const String& lhs, const String& rhs) { return String(lhs.str() + rhs.str()); }
+inline String operator+(const String& lhs, const char* rhs) { return String(lhs.str() + rhs); }
+inline String operator+(const char* lhs, const String& rhs) { return String(lhs + rhs.str()); }
+
+#endif
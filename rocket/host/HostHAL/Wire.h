@@ -0,0 +1,84 @@
+// ===========================
+// Host HAL - I2C bus (Wire)
+// ===========================
+
+/*
+* Emulated I2C bus. Instead of talking to real hardware the transactions are routed to simulated
+* devices (HostI2CDevice) registered on their 7-bit address. The unmodified sensor drivers (BMI088, TFMPI2C)
+* therefore run on the host exactly as on the Teensy.
+* With the virtual clock every transfer takes the time it would need on the real bus at the configured clock.
+*/
+
+#pragma once
+
+#ifndef HOST_WIRE_H
+#define HOST_WIRE_H
+
+#include <Arduino.h>
+
+#define HOST_WIRE_BUFFER_SIZE 64
+
+// Interface implemented by every simulated I2C slave
+class HostI2CDevice {
+public:
+  virtual ~HostI2CDevice() {}
+
+  // Called on endTransmission() with the bytes written by the master
+  virtual void receive(const uint8_t* data, size_t len) = 0;
+
+  // Called on requestFrom(), fills buf with up to len bytes and returns the number of bytes delivered
+  virtual size_t request(uint8_t* buf, size_t len) = 0;
+};
+
+class TwoWire {
+public:
+  void begin() {}
+  void end() {}
+  void setClock(uint32_t frequency) { clock = frequency; }
+
+  void beginTransmission(uint8_t address);
+  void beginTransmission(int address) { beginTransmission((uint8_t)address); }
+  size_t write(uint8_t data);
+  size_t write(const uint8_t* data, size_t len);
+  uint8_t endTransmission(uint8_t sendStop = 1);
+
+  uint8_t requestFrom(uint8_t address, uint8_t quantity, uint8_t sendStop = 1);
+  uint8_t requestFrom(uint8_t address, uint16_t quantity) { return requestFrom(address, (uint8_t)quantity, (uint8_t)1); }
+  uint8_t requestFrom(int address, int quantity, int sendStop = 1) { return requestFrom((uint8_t)address, (uint8_t)quantity, (uint8_t)sendStop); }
+
+  int available() { return rxLength - rxIndex; }
+  int read() { return rxIndex < rxLength ? rxBuffer[rxIndex++] : -1; }
+  int peek() { return rxIndex < rxLength ? rxBuffer[rxIndex] : -1; }
+
+  // Host only: connect / disconnect a simulated device
+  void attachDevice(uint8_t address, HostI2CDevice* device) { devices[address & 0x7F] = device; }
+  void detachDevice(uint8_t address) { devices[address & 0x7F] = nullptr; }
+
+  // Host only: complete write / read transfer without charging bus time (used by the async I2C engine)
+  // Returns false if no device is attached at the address
+  bool hostTransfer(uint8_t address, const uint8_t* tx, size_t txLen, bool stopBeforeRead, uint8_t* rx, size_t rxLen);
+
+  // Host only: time a transfer of bytes data bytes takes at the configured clock [ns]
+  uint64_t transferNanos(size_t bytes) const;
+
+  // Host only: bus statistics
+  uint32_t getClock() const { return clock; }
+  unsigned long transactionCount() const { return transactions; }
+
+private:
+  HostI2CDevice* devices[128] = {};
+  uint32_t clock = 100000;
+  unsigned long transactions = 0;
+
+  uint8_t txAddress = 0;
+  uint8_t txBuffer[HOST_WIRE_BUFFER_SIZE];
+  uint8_t txLength = 0;
+
+  uint8_t rxBuffer[HOST_WIRE_BUFFER_SIZE];
+  uint8_t rxLength = 0;
+  uint8_t rxIndex = 0;
+};
+
+extern TwoWire Wire;
+
+#endif
@@ -0,0 +1,14 @@
+// =================================
+// Host HAL - nRF24L01 register map
+// =================================
+
+/*
+* The firmware only includes this header, nothing from the register map is used on the host
+*/
+
+#pragma once
+
+#ifndef HOST_NRF24L01_H
+#define HOST_NRF24L01_H
+
+#endif
@@ -0,0 +1,574 @@
+// ==========================================
+// Host tools - Flight log decoder
+// ==========================================
+
+#include "LogDecoder.h"
+#include "LogReader.h"
+#include <FlightLog.h>
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+// =============================================================================================
+//  Definitions
+// =============================================================================================
+#define OUTPUT_BUFFER_SIZE (1 << 16)
+#define MAX_CHANNELS 8
+
+// By channel id (black box dumps are logs of their own with the single channel FLIGHT_LOG_CHANNEL_BLACK_BOX)
+#define CHANNEL_IDS (FLIGHT_LOG_CHANNEL_BLACK_BOX + 1)
+static const char* const CHANNEL_NAMES[CHANNEL_IDS] = {"control", "imu", "replay", "blackbox"};
+
+// Record layout of a channel, taken from the log header
+struct ChannelLayout {
+  std::string name;
+  uint8_t encoding;
+  uint16_t recordSize;
+  std::vector<std::string> fields;
+  std::vector<float> scales;
+  std::vector<int> decimals;    // Scale 10^-decimals: printed as fixed point from the count (-1: float)
+};
+
+// Result of one log
+struct LogResult {
+  bool ok = false;
+  std::string error;
+  uint64_t bytes = 0;
+  uint64_t records[MAX_CHANNELS] = {};
+  uint64_t lostChunks = 0;      // Sequence gaps (chunks dropped by the firmware)
+  uint64_t badChunks = 0;       // Chunks that don't decode
+  uint64_t chunksRead = 0;
+  uint64_t chunkCount = 0;
+  bool indexed = false;         // The time range was looked up in the index
+  std::vector<std::string> channelNames;
+};
+
+// Buffered output file
+class OutputFile {
+public:
+  ~OutputFile() { close(); }
+
+  bool open(const std::string& path) {
+    fp = fopen(path.c_str(), "wb");
+    return fp != nullptr;
+  }
+
+  // Room for n more bytes, committed with commit()
+  char* reserve(size_t n) {
+    if (used + n > sizeof(buf)) {
+      flush();
+    }
+    return buf + used;
+  }
+  void commit(char* end) { used = end - buf; }
+
+  void write(const void* data, size_t n) {
+    memcpy(reserve(n), data, n);
+    used += n;
+  }
+
+  bool close() {
+    if (!fp) {
+      return true;
+    }
+    flush();
+    bool ok = !ferror(fp);
+    ok &= fclose(fp) == 0;
+    fp = nullptr;
+    return ok;
+  }
+
+private:
+  void flush() {
+    fwrite(buf, 1, used, fp);
+    used = 0;
+  }
+
+  FILE* fp = nullptr;
+  char buf[OUTPUT_BUFFER_SIZE];
+  size_t used = 0;
+};
+
+// Output of one channel (one CSV file or one column file per field)
+class ChannelSink {
+public:
+  ChannelSink(const ChannelLayout& layout, LogOutputFormat format) : layout(layout), format(format) {}
+
+  bool open(const std::string& base) {
+    std::string prefix = base + "." + layout.name;
+    if (format == LOG_OUTPUT_CSV) {
+      files.emplace_back(new OutputFile());
+      if (!files[0]->open(prefix + ".csv")) {
+        return false;
+      }
+      std::string header;
+      for (size_t i = 0; i < layout.fields.size(); i++) {
+        header += (i > 0 ? "," : "") + layout.fields[i];
+      }
+      header += "\n";
+      files[0]->write(header.data(), header.size());
+      return true;
+    }
+
+    for (const std::string& field : layout.fields) {
+      files.emplace_back(new OutputFile());
+      if (!files.back()->open(prefix + "." + field + ".f64")) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // values[0] is the time stamp [us]. counts are the quantized values of delta varint channels (nullptr otherwise)
+  void row(const double* values, const int32_t* counts) {
+    size_t n = layout.fields.size();
+    if (format == LOG_OUTPUT_COLUMNS) {
+      for (size_t i = 0; i < n; i++) {
+        files[i]->write(&values[i], sizeof(double));
+      }
+      return;
+    }
+
+    // Quantized values exactly as fixed point, the others as the shortest representation that reads back to
+    // the same float32 (24 bytes per field at most)
+    char* start = files[0]->reserve(n * 24 + 1);
+    char* p = start;
+    for (size_t i = 0; i < n; i++) {
+      if (i > 0) {
+        *p++ = ',';
+      }
+      if (counts && i == 0) {
+        p = std::to_chars(p, p + 24, (uint32_t)counts[i]).ptr;
+      }
+      else if (i == 0 && layout.encoding == FLIGHT_LOG_ENCODING_TIME_FLOAT32) {
+        p = std::to_chars(p, p + 24, (uint32_t)values[i]).ptr;
+      }
+      else if (counts && layout.decimals[i] >= 0) {
+        p = putFixed(p, counts[i], layout.decimals[i]);
+      }
+      else {
+        p = std::to_chars(p, p + 24, (float)values[i]).ptr;
+      }
+    }
+    *p++ = '\n';
+    files[0]->commit(p);
+  }
+
+  bool close() {
+    bool ok = true;
+    for (auto& file : files) {
+      ok &= file->close();
+    }
+    return ok;
+  }
+
+private:
+  static char* putFixed(char* p, int32_t count, int decimals) {
+    uint32_t magnitude = count < 0 ? -(uint32_t)count : (uint32_t)count;
+    if (count < 0) {
+      *p++ = '-';
+    }
+    if (decimals == 0) {
+      return std::to_chars(p, p + 12, magnitude).ptr;
+    }
+    uint32_t unit = 1;
+    for (int i = 0; i < decimals; i++) {
+      unit *= 10;
+    }
+    p = std::to_chars(p, p + 12, magnitude / unit).ptr;
+    *p++ = '.';
+    uint32_t fraction = magnitude % unit;
+    for (int i = decimals - 1; i >= 0; i--) {
+      p[i] = '0' + fraction % 10;
+      fraction /= 10;
+    }
+    return p + decimals;
+  }
+
+  const ChannelLayout& layout;
+  LogOutputFormat format;
+  std::vector<std::unique_ptr<OutputFile>> files;
+};
+
+// =============================================================================================
+//  Decoding
+// =============================================================================================
+static std::vector<std::string> splitFields(const char* text, size_t maxLength) {
+  std::string s(text, strnlen(text, maxLength));
+  std::vector<std::string> fields;
+  size_t start = 0;
+  while (start <= s.size()) {
+    size_t end = s.find(',', start);
+    if (end == std::string::npos) {
+      end = s.size();
+    }
+    fields.push_back(s.substr(start, end - start));
+    start = end + 1;
+  }
+  return fields;
+}
+
+static bool inRange(const LogDecodeOptions& options, double timeUs) {
+  double t = timeUs * 1e-6;
+  return t >= options.from && t <= options.to;
+}
+
+// Chunks [first, last) that can hold records of the time range of the wanted channels, binary searched in the
+// index listed by the footer. The whole log if it has no footer (not closed) or no time range is set
+static void seekRange(const MappedLog& log, const FlightLogHeader& header, const LogDecodeOptions& options,
+                      size_t count, size_t& first, size_t& last, LogResult& result) {
+  first = 0;
+  last = count;
+  if (count == 0 || (options.from == -INFINITY && options.to == INFINITY)) {
+    return;
+  }
+
+  const uint8_t* chunks = log.data + header.headerSize;
+  FlightLogChunkHeader footerHeader;
+  FlightLogFooter footer;
+  memcpy(&footerHeader, chunks + (count - 1) * FLIGHT_LOG_CHUNK_SIZE, sizeof(footerHeader));
+  memcpy(&footer, chunks + (count - 1) * FLIGHT_LOG_CHUNK_SIZE + sizeof(FlightLogChunkHeader), sizeof(footer));
+  if (footerHeader.channel != FLIGHT_LOG_CHUNK_FOOTER || footer.magic != FLIGHT_LOG_FOOTER_MAGIC ||
+      footer.indexCount > FLIGHT_LOG_FOOTER_MAX_INDEX || footer.chunkCount >= count) {
+    return;
+  }
+
+  // Entries per channel, in time order (the chunks of a channel are written in time order)
+  std::vector<std::vector<FlightLogIndexEntry>> entries(header.channelCount);
+  for (uint16_t i = 0; i < footer.indexCount; i++) {
+    uint32_t n = footer.indexChunks[i];
+    FlightLogChunkHeader chunk;
+    memcpy(&chunk, chunks + (size_t)n * FLIGHT_LOG_CHUNK_SIZE, sizeof(chunk));
+    if (n >= footer.chunkCount || chunk.channel != FLIGHT_LOG_CHUNK_INDEX || chunk.records > FLIGHT_LOG_INDEX_ENTRIES) {
+      return;
+    }
+    for (uint8_t r = 0; r < chunk.records; r++) {
+      FlightLogIndexEntry entry;
+      memcpy(&entry, chunks + (size_t)n * FLIGHT_LOG_CHUNK_SIZE + sizeof(chunk) + r * sizeof(entry), sizeof(entry));
+      if (entry.channel < header.channelCount && entry.chunk < footer.chunkCount) {
+        entries[entry.channel].push_back(entry);
+      }
+    }
+  }
+
+  double fromUs = std::max(options.from * 1e6, 0.0);
+  double toUs = std::min(options.to * 1e6, 4294967295.0);
+  auto later = [](double t, const FlightLogIndexEntry& entry) { return t < entry.timeStamp; };
+  first = count;
+  last = 0;
+  for (uint16_t c = 0; c < header.channelCount; c++) {
+    if (options.channel >= 0 && options.channel != header.channels[c].id) {
+      continue;
+    }
+    const std::vector<FlightLogIndexEntry>& e = entries[c];
+    // Start at the last indexed chunk that begins before the range, end at the first one that begins after it
+    auto start = std::upper_bound(e.begin(), e.end(), fromUs, later);
+    auto end = std::upper_bound(e.begin(), e.end(), toUs, later);
+    first = std::min(first, start == e.begin() ? (size_t)0 : (size_t)(start - 1)->chunk);
+    last = std::max(last, end == e.end() ? (size_t)footer.chunkCount : (size_t)end->chunk);
+  }
+  last = std::min(last, count);
+  result.indexed = true;
+}
+
+// Chunks of the channels described in the header
+static void decodeChunks(const MappedLog& log, const LogDecodeOptions& options, const std::string& base, LogResult& result) {
+  FlightLogHeader header;
+  if (!readLogHeader(log, header, result.error)) {
+    return;
+  }
+
+  std::vector<ChannelLayout> layouts(header.channelCount);
+  std::vector<std::unique_ptr<ChannelSink>> sinks(header.channelCount);
+  for (uint16_t c = 0; c < header.channelCount; c++) {
+    const FlightLogChannelInfo& info = header.channels[c];
+    ChannelLayout& layout = layouts[c];
+    layout.name = info.id < CHANNEL_IDS ? CHANNEL_NAMES[info.id] : "channel" + std::to_string(info.id);
+    layout.encoding = info.encoding;
+    layout.recordSize = info.recordSize;
+    layout.fields = splitFields(info.fields, sizeof(info.fields));
+    layout.fields.resize(info.fieldCount);
+    layout.scales.assign(info.scales, info.scales + info.fieldCount);
+    for (float scale : layout.scales) {
+      int decimals = (int)lround(-log10(scale));
+      bool decimal = decimals >= 0 && decimals <= 9 && fabs(scale - pow(10.0, -decimals)) < 1e-6 * scale;
+      layout.decimals.push_back(decimal ? decimals : -1);
+    }
+    result.channelNames.push_back(layout.name);
+
+    if (options.channel < 0 || options.channel == info.id) {
+      sinks[c].reset(new ChannelSink(layout, options.format));
+      if (!sinks[c]->open(base)) {
+        result.error = "can't create the output of " + base;
+        return;
+      }
+    }
+  }
+
+  size_t count = logChunkCount(log, header);
+  size_t first, last;
+  seekRange(log, header, options, count, first, last, result);
+  result.chunkCount = count;
+
+  double values[FLIGHT_LOG_MAX_FIELDS];
+  int32_t counts[FLIGHT_LOG_MAX_FIELDS];
+  uint32_t expected = 0;
+  for (size_t n = first; n < last; n++) {
+    size_t off = header.headerSize + n * FLIGHT_LOG_CHUNK_SIZE;
+    FlightLogChunkHeader chunk = logChunkHeader(log, header, n);
+
+    // End of the log: footer, or the unwritten end of a preallocated file (erased to zero or 0xFF)
+    if (!logChunkValid(header, chunk)) {
+      break;
+    }
+    bool data = chunk.channel < header.channelCount;
+    result.chunksRead++;
+    if (n > first) {
+      result.lostChunks += chunk.sequence - expected;
+    }
+    expected = chunk.sequence + 1;
+    if (!data) {
+      continue;
+    }
+
+    ChannelSink* sink = sinks[chunk.channel].get();
+    if (!sink) {
+      continue;
+    }
+    const ChannelLayout& layout = layouts[chunk.channel];
+    size_t fieldCount = layout.fields.size();
+    const uint8_t* p = log.data + off + sizeof(FlightLogChunkHeader);
+    const uint8_t* end = p + chunk.length;
+
+    if (layout.encoding != FLIGHT_LOG_ENCODING_DELTA_VARINT) {
+      if (chunk.records * layout.recordSize > chunk.length) {
+        result.badChunks++;
+        continue;
+      }
+      float record[FLIGHT_LOG_MAX_FIELDS];
+      for (uint8_t r = 0; r < chunk.records; r++, p += layout.recordSize) {
+        memcpy(record, p, layout.recordSize);
+        for (size_t i = 0; i < fieldCount; i++) {
+          values[i] = record[i];
+        }
+        if (layout.encoding == FLIGHT_LOG_ENCODING_TIME_FLOAT32) {
+          uint32_t timeStamp;
+          memcpy(&timeStamp, p, sizeof(timeStamp));
+          values[0] = timeStamp;
+        }
+        if (inRange(options, values[0])) {
+          sink->row(values, nullptr);
+          result.records[chunk.channel]++;
+        }
+      }
+      continue;
+    }
+
+    // Delta varint: every chunk starts from zero
+    memset(counts, 0, sizeof(counts));
+    bool bad = false;
+    for (uint8_t r = 0; r < chunk.records && !bad; r++) {
+      for (size_t i = 0; i < fieldCount && !bad; i++) {
+        int32_t delta = 0;
+        bad = !readVarint(p, end, delta);
+        counts[i] = (int32_t)((uint32_t)counts[i] + (uint32_t)delta);
+      }
+      if (bad) {
+        result.badChunks++;
+        break;
+      }
+      values[0] = (uint32_t)counts[0];
+      for (size_t i = 1; i < fieldCount; i++) {
+        values[i] = (float)(counts[i] * layout.scales[i]);
+      }
+      if (inRange(options, values[0])) {
+        sink->row(values, counts);
+        result.records[chunk.channel]++;
+      }
+    }
+  }
+
+  result.ok = true;
+  for (auto& sink : sinks) {
+    if (sink && !sink->close()) {
+      result.ok = false;
+      result.error = "write error";
+    }
+  }
+}
+
+static LogResult decodeLog(const char* path, const LogDecodeOptions& options) {
+  LogResult result;
+  MappedLog log;
+  if (!log.map(path, result.error)) {
+    return result;
+  }
+  result.bytes = log.size;
+
+  // Output base name: the log path without .bin, in outDir if set
+  std::string base = path;
+  if (base.size() > 4 && base.compare(base.size() - 4, 4, ".bin") == 0) {
+    base.resize(base.size() - 4);
+  }
+  if (options.outDir) {
+    size_t slash = base.rfind('/');
+    base = std::string(options.outDir) + "/" + (slash == std::string::npos ? base : base.substr(slash + 1));
+  }
+
+  uint16_t version = logVersion(log);
+  if (version == 0) {
+    result.error = "not a flight log (bad magic)";
+  }
+  else if (version == FLIGHT_LOG_VERSION) {
+    decodeChunks(log, options, base, result);
+  }
+  else {
+    result.error = "unsupported format version " + std::to_string(version);
+  }
+  return result;
+}
+
+
+// =============================================================================================
+//  Functions
+// =============================================================================================
+static void printUsage(const char* program) {
+  fprintf(stderr, "Decoder usage: %s --decode [--out DIR] [--format csv|columns] [--from S] [--to S] "
+                  "[--channel control|imu|replay|blackbox] [--jobs J] LOG...\n", program);
+}
+
+bool logDecodeParseArgs(int& argc, char** argv, LogDecodeOptions& options) {
+  bool decode = false;
+  for (int i = 1; i < argc; i++) {
+    decode |= strcmp(argv[i], "--decode") == 0;
+  }
+  if (!decode) {
+    return true;
+  }
+
+  // In decode mode all arguments belong to the decoder
+  options.decode = true;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (arg == "--decode") {
+      continue;
+    }
+    else if (arg == "--out" && hasValue) {
+      options.outDir = argv[++i];
+    }
+    else if (arg == "--format" && hasValue) {
+      std::string format = argv[++i];
+      if (format != "csv" && format != "columns") {
+        fprintf(stderr, "Unknown format %s\n", format.c_str());
+        printUsage(argv[0]);
+        return false;
+      }
+      options.format = format == "csv" ? LOG_OUTPUT_CSV : LOG_OUTPUT_COLUMNS;
+    }
+    else if (arg == "--from" && hasValue) {
+      options.from = atof(argv[++i]);
+    }
+    else if (arg == "--to" && hasValue) {
+      options.to = atof(argv[++i]);
+    }
+    else if (arg == "--channel" && hasValue) {
+      std::string name = argv[++i];
+      options.channel = -1;
+      for (int c = 0; c < CHANNEL_IDS; c++) {
+        if (name == CHANNEL_NAMES[c]) {
+          options.channel = c;
+        }
+      }
+      if (options.channel < 0) {
+        fprintf(stderr, "Unknown channel %s\n", name.c_str());
+        printUsage(argv[0]);
+        return false;
+      }
+    }
+    else if (arg == "--jobs" && hasValue) {
+      options.jobs = atoi(argv[++i]);
+    }
+    else if (arg.compare(0, 2, "--") == 0) {
+      fprintf(stderr, "Bad decoder argument %s\n", arg.c_str());
+      printUsage(argv[0]);
+      return false;
+    }
+    else {
+      options.logs.push_back(argv[i]);
+    }
+  }
+  argc = 1;
+
+  if (options.logs.empty()) {
+    printUsage(argv[0]);
+    return false;
+  }
+  return true;
+}
+
+int logDecodeRun(const LogDecodeOptions& options) {
+  int n = (int)options.logs.size();
+  int jobs = options.jobs > 0 ? options.jobs : (int)std::thread::hardware_concurrency();
+  jobs = std::max(1, std::min(jobs, n));
+  if (options.outDir) {
+    mkdir(options.outDir, 0755);
+  }
+
+  // The logs differ a lot in size, every worker takes the next log when it is done
+  std::vector<LogResult> results(n);
+  std::atomic<int> next(0);
+
+  auto tStart = std::chrono::steady_clock::now();
+  std::vector<std::thread> workers;
+  for (int w = 0; w < jobs; w++) {
+    workers.emplace_back([&]() {
+      int i;
+      while ((i = next++) < n) {
+        results[i] = decodeLog(options.logs[i], options);
+      }
+    });
+  }
+  for (std::thread& worker : workers) {
+    worker.join();
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - tStart).count();
+
+  int failed = 0;
+  uint64_t bytes = 0;
+  for (int i = 0; i < n; i++) {
+    const LogResult& r = results[i];
+    if (!r.ok) {
+      fprintf(stderr, "%s: %s\n", options.logs[i], r.error.c_str());
+      failed++;
+      continue;
+    }
+    bytes += r.bytes;
+    printf("%s:", options.logs[i]);
+    for (size_t c = 0; c < r.channelNames.size(); c++) {
+      printf(" %llu %s", (unsigned long long)r.records[c], r.channelNames[c].c_str());
+    }
+    printf(" records");
+    if (r.indexed) {
+      printf(" (%llu of %llu chunks read, seeked in the index)", (unsigned long long)r.chunksRead,
+             (unsigned long long)r.chunkCount);
+    }
+    if (r.lostChunks || r.badChunks) {
+      printf(", %llu chunks lost, %llu bad chunks", (unsigned long long)r.lostChunks, (unsigned long long)r.badChunks);
+    }
+    printf("\n");
+  }
+  printf("%d logs, %.1f MB in %.2f s (%.0f MB/s, %d workers)%s\n", n - failed, bytes / 1e6, seconds,
+         seconds > 0 ? bytes / 1e6 / seconds : 0.0, jobs, failed ? ", some logs failed" : "");
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,50 @@
+// ==========================================
+// Host tools - Flight log decoder
+// ==========================================
+
+/*
+* Converts binary flight logs (FlightLog.h) into CSV or column files on the host.
+* The logs are memory mapped and decoded chunk by chunk straight into the output buffers, nothing is held
+* per record, so the memory use doesn't depend on the log size. Values keep their full precision (shortest
+* round trip formatting of the float32 / quantized values).
+*
+* Output per log and channel, next to the log or in outDir:
+*   - csv:     <log>.<channel>.csv with a header line of the field names
+*   - columns: <log>.<channel>.<field>.f64, one little endian float64 array per field (e.g. numpy.fromfile)
+* Records can be limited to a time range (field timeStamp, [s] since the start of the flight) and to one
+* channel. In closed logs the chunks of the range are binary searched in the time index (footer), only they are
+* read. Several logs are decoded in parallel, worker threads take the next log when they are done with one.
+* Black box dumps (BlackBox.h, channel blackbox) are read as well.
+*/
+
+#pragma once
+
+#ifndef LOG_DECODER_H
+#define LOG_DECODER_H
+
+#include <math.h>
+#include <vector>
+
+enum LogOutputFormat {
+  LOG_OUTPUT_CSV = 0,
+  LOG_OUTPUT_COLUMNS
+};
+
+struct LogDecodeOptions {
+  std::vector<const char*> logs;          // Nothing to decode: not in decode mode
+  bool decode = false;
+  const char* outDir = nullptr;           // Next to the log by default
+  LogOutputFormat format = LOG_OUTPUT_CSV;
+  double from = -INFINITY;                // Time range [s]
+  double to = INFINITY;
+  int channel = -1;                       // All channels
+  int jobs = 0;                           // Worker threads (0: one per core)
+};
+
+// Take the decoder arguments out of argv (the rest is left for hostInit). Returns false on a bad argument
+bool logDecodeParseArgs(int& argc, char** argv, LogDecodeOptions& options);
+
+// Decode the logs and print a summary. Returns the process exit code
+int logDecodeRun(const LogDecodeOptions& options);
+
+#endif
@@ -0,0 +1,189 @@
+// ==========================================
+// Host tools - Flight log reader
+// ==========================================
+
+#include "LogReader.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+// =============================================================================================
+//  Functions
+// =============================================================================================
+bool MappedLog::map(const char* path, std::string& error) {
+  int fd = ::open(path, O_RDONLY);
+  if (fd < 0) {
+    error = "can't open";
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(uint32_t) * 4) {
+    ::close(fd);
+    error = "not a flight log (too short)";
+    return false;
+  }
+  size = st.st_size;
+  void* p = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (p == MAP_FAILED) {
+    error = "can't map";
+    return false;
+  }
+  madvise(p, size, MADV_SEQUENTIAL);
+  data = (const uint8_t*)p;
+  return true;
+}
+
+MappedLog::~MappedLog() {
+  if (data) {
+    munmap((void*)data, size);
+  }
+}
+
+bool readVarint(const uint8_t*& p, const uint8_t* end, int32_t& value) {
+  uint32_t v = 0;
+  for (int shift = 0; shift < 35; shift += 7) {
+    if (p >= end) {
+      return false;
+    }
+    uint8_t b = *p++;
+    v |= (uint32_t)(b & 0x7F) << shift;
+    if (b < 0x80) {
+      value = (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+      return true;
+    }
+  }
+  return false;
+}
+
+uint16_t logVersion(const MappedLog& log) {
+  uint32_t magic;
+  uint16_t version;
+  memcpy(&magic, log.data, sizeof(magic));
+  memcpy(&version, log.data + 4, sizeof(version));
+  return magic == FLIGHT_LOG_MAGIC ? version : 0;
+}
+
+bool readLogHeader(const MappedLog& log, FlightLogHeader& header, std::string& error) {
+  size_t size = sizeof(FlightLogHeader);
+  if (logVersion(log) != FLIGHT_LOG_VERSION) {
+    error = "unsupported format version";
+    return false;
+  }
+  if (log.size < size) {
+    error = "truncated header";
+    return false;
+  }
+  memset(&header, 0, sizeof(header));
+  memcpy(&header, log.data, size);
+  if (header.chunkSize != FLIGHT_LOG_CHUNK_SIZE || header.headerSize < size || header.headerSize > log.size ||
+      header.channelCount == 0 || header.channelCount > FLIGHT_LOG_CHANNELS) {
+    error = "bad header";
+    return false;
+  }
+
+  for (uint16_t c = 0; c < header.channelCount; c++) {
+    const FlightLogChannelInfo& info = header.channels[c];
+    if (info.fieldCount == 0 || info.fieldCount > FLIGHT_LOG_MAX_FIELDS ||
+        (info.encoding != FLIGHT_LOG_ENCODING_DELTA_VARINT && info.recordSize != info.fieldCount * sizeof(float)) ||
+        info.encoding > FLIGHT_LOG_ENCODING_TIME_FLOAT32) {
+      error = "bad channel descriptor";
+      return false;
+    }
+  }
+  return true;
+}
+
+size_t logChunkCount(const MappedLog& log, const FlightLogHeader& header) {
+  return (log.size - header.headerSize) / FLIGHT_LOG_CHUNK_SIZE;
+}
+
+FlightLogChunkHeader logChunkHeader(const MappedLog& log, const FlightLogHeader& header, size_t n) {
+  FlightLogChunkHeader chunk;
+  memcpy(&chunk, log.data + header.headerSize + n * FLIGHT_LOG_CHUNK_SIZE, sizeof(chunk));
+  return chunk;
+}
+
+bool logChunkValid(const FlightLogHeader& header, const FlightLogChunkHeader& chunk) {
+  bool known = chunk.channel < header.channelCount || chunk.channel == FLIGHT_LOG_CHUNK_INDEX ||
+               chunk.channel == FLIGHT_LOG_CHUNK_STATE;
+  return known && chunk.records > 0 && chunk.length <= FLIGHT_LOG_PAYLOAD_SIZE;
+}
+
+
+// ====== Channel reader ======
+ChannelReader::ChannelReader(const MappedLog& log, const FlightLogHeader& header, uint8_t channel)
+  : log(log), header(header), channel(channel), count(logChunkCount(log, header)) {}
+
+bool ChannelReader::nextChunk() {
+  while (n < count) {
+    FlightLogChunkHeader chunk = logChunkHeader(log, header, n);
+    if (!logChunkValid(header, chunk)) {
+      n = count;
+      return false;
+    }
+    if (n > 0) {
+      lostChunks += chunk.sequence - expected;
+    }
+    expected = chunk.sequence + 1;
+
+    const uint8_t* payload = log.data + header.headerSize + n * FLIGHT_LOG_CHUNK_SIZE + sizeof(FlightLogChunkHeader);
+    n++;
+    if (chunk.channel != channel) {
+      continue;
+    }
+    if (header.channels[channel].encoding != FLIGHT_LOG_ENCODING_DELTA_VARINT &&
+        chunk.records * header.channels[channel].recordSize > chunk.length) {
+      badChunks++;
+      continue;
+    }
+    p = payload;
+    end = payload + chunk.length;
+    recordsLeft = chunk.records;
+    memset(prev, 0, sizeof(prev));
+    return true;
+  }
+  return false;
+}
+
+bool ChannelReader::next(int32_t* counts) {
+  const FlightLogChannelInfo& info = header.channels[channel];
+  while (true) {
+    if (recordsLeft == 0 && !nextChunk()) {
+      return false;
+    }
+
+    // Every chunk starts from zero
+    const uint8_t* q = p;
+    bool bad = false;
+    for (uint16_t i = 0; i < info.fieldCount && !bad; i++) {
+      int32_t delta = 0;
+      bad = !readVarint(q, end, delta);
+      counts[i] = (int32_t)((uint32_t)prev[i] + (uint32_t)delta);
+    }
+    if (bad) {
+      badChunks++;
+      recordsLeft = 0;
+      continue;
+    }
+    memcpy(prev, counts, info.fieldCount * sizeof(int32_t));
+    p = q;
+    recordsLeft--;
+    return true;
+  }
+}
+
+bool ChannelReader::next(float* values) {
+  if (recordsLeft == 0 && !nextChunk()) {
+    return false;
+  }
+  uint16_t recordSize = header.channels[channel].recordSize;
+  memcpy(values, p, recordSize);
+  p += recordSize;
+  recordsLeft--;
+  return true;
+}
@@ -0,0 +1,78 @@
+// ==========================================
+// Host tools - Flight log reader
+// ==========================================
+
+/*
+* Reading side of the flight log format (FlightLog.h) shared by the host tools (LogDecoder.h, LogReplay.h):
+* memory mapped logs, header validation, varints and a sequential reader for the records of one channel.
+*/
+
+#pragma once
+
+#ifndef LOG_READER_H
+#define LOG_READER_H
+
+#include <FlightLog.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+// Memory mapped log (read only)
+struct MappedLog {
+  const uint8_t* data = nullptr;
+  size_t size = 0;
+
+  bool map(const char* path, std::string& error);
+  ~MappedLog();
+};
+
+// Zig-zag varint at p (advanced behind it). Returns false if it runs past end or is longer than 5 bytes
+bool readVarint(const uint8_t*& p, const uint8_t* end, int32_t& value);
+
+// Format version of the log (0 if the magic doesn't match)
+uint16_t logVersion(const MappedLog& log);
+
+// Header of the log. Returns false with an error on a bad header or another format version
+bool readLogHeader(const MappedLog& log, FlightLogHeader& header, std::string& error);
+
+// Chunks after the header (including a partially written last one)
+size_t logChunkCount(const MappedLog& log, const FlightLogHeader& header);
+
+// Chunk header of chunk n
+FlightLogChunkHeader logChunkHeader(const MappedLog& log, const FlightLogHeader& header, size_t n);
+
+// A written chunk: channel data, index or state chunk. The footer and the unwritten end of a preallocated file
+// (erased to zero or 0xFF) end the log
+bool logChunkValid(const FlightLogHeader& header, const FlightLogChunkHeader& chunk);
+
+// Records of one channel in file order (the chunks of a channel are written in time order)
+class ChannelReader {
+public:
+  ChannelReader(const MappedLog& log, const FlightLogHeader& header, uint8_t channel);
+
+  // Next record of a delta varint channel as quantized counts (fieldCount values). Returns false at the end
+  bool next(int32_t* counts);
+
+  // Next record of a fixed size channel (fieldCount 32 bit values, the time stamp of a
+  // FLIGHT_LOG_ENCODING_TIME_FLOAT32 record is a uint32). Returns false at the end
+  bool next(float* values);
+
+  uint64_t lostChunks = 0;      // Sequence gaps before the current chunk (chunks of any channel)
+  uint64_t badChunks = 0;       // Chunks of the channel that don't decode
+
+private:
+  bool nextChunk();
+
+  const MappedLog& log;
+  const FlightLogHeader& header;
+  uint8_t channel;
+  size_t count;
+  size_t n = 0;                 // Next chunk
+  uint32_t expected = 0;        // Sequence number of the next chunk
+  const uint8_t* p = nullptr;   // Current chunk payload
+  const uint8_t* end = nullptr;
+  uint8_t recordsLeft = 0;
+  int32_t prev[FLIGHT_LOG_MAX_FIELDS];
+};
+
+#endif
@@ -0,0 +1,332 @@
+// ==========================================
+// Host tools - Flight log replay
+// ==========================================
+
+#include "LogReplay.h"
+#include "LogReader.h"
+#include <HostHAL.h>
+#include <FlightLog.h>
+#include <Replay.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// =============================================================================================
+//  Definitions
+// =============================================================================================
+#define IMU_REPLAY_FIELDS 12      // timeStamp, acc, gyro, quaternion, newAcc
+#define REPLAY_STEP_FIELDS 4      // timeStamp, imuSamples, lidarSamples, lidarZ
+#define OUTPUTS 3
+
+// The logged sample times are relative to t0 (samples from before t0 are negative). The filter takes a previous
+// sample time of zero as "no sample yet", so they are replayed on an offset time base
+#define REPLAY_TIME_BASE 0x80000000UL
+
+static const char* const OUTPUT_NAMES[OUTPUTS] = {"gimb1", "gimb2", "motorSpeed"};
+
+// Sent from the replay process through a pipe
+struct ReplayResult {
+  bool completed;
+  int status;                     // waitpid() status of a failed replay
+  char error[96];
+  uint64_t steps;                 // Replayed control steps
+  uint64_t compared;              // Steps with a logged control record
+  uint64_t identical;             // Bit-identical control records (all fields)
+  uint64_t differing;             // Steps with an output difference above the tolerance
+  uint64_t imuSamples;
+  uint64_t lidarGaps;             // Steps with more than one new lidar distance (only the last one is logged)
+  uint64_t lostChunks;
+  double maxError[OUTPUTS];
+  double firstDifference;         // [s], -1 if there is none
+};
+
+
+// =============================================================================================
+//  Replay process
+// =============================================================================================
+static void fail(ReplayResult& r, const char* error) {
+  snprintf(r.error, sizeof(r.error), "%s", error);
+}
+
+// The state chunk is queued at t0, before the first control step
+static bool findState(const MappedLog& log, const FlightLogHeader& header, ReplayState& state) {
+  size_t count = logChunkCount(log, header);
+  for (size_t n = 0; n < count; n++) {
+    FlightLogChunkHeader chunk = logChunkHeader(log, header, n);
+    if (!logChunkValid(header, chunk)) {
+      return false;
+    }
+    if (chunk.channel == FLIGHT_LOG_CHUNK_STATE) {
+      if (chunk.length != sizeof(ReplayState)) {
+        return false;
+      }
+      memcpy(&state, log.data + header.headerSize + n * FLIGHT_LOG_CHUNK_SIZE + sizeof(chunk), sizeof(state));
+      return true;
+    }
+  }
+  return false;
+}
+
+static void replayLog(const char* path, double tolerance, ReplayResult& r) {
+  MappedLog log;
+  std::string error;
+  FlightLogHeader header;
+  if (!log.map(path, error) || !readLogHeader(log, header, error)) {
+    fail(r, error.c_str());
+    return;
+  }
+  if (header.channelCount <= FLIGHT_LOG_CHANNEL_REPLAY ||
+      header.channels[FLIGHT_LOG_CHANNEL_IMU].fieldCount < IMU_REPLAY_FIELDS ||
+      header.channels[FLIGHT_LOG_CHANNEL_REPLAY].fieldCount < REPLAY_STEP_FIELDS ||
+      header.channels[FLIGHT_LOG_CHANNEL_CONTROL].recordSize != sizeof(PacketData)) {
+    fail(r, "no replay data (logged without FLIGHT_LOG_REPLAY)");
+    return;
+  }
+  ReplayState state;
+  if (!findState(log, header, state)) {
+    fail(r, "no state chunk (logged without FLIGHT_LOG_REPLAY)");
+    return;
+  }
+
+  replayRestoreState(state);
+  const float* scales = header.channels[FLIGHT_LOG_CHANNEL_IMU].scales;
+  ChannelReader imuReader(log, header, FLIGHT_LOG_CHANNEL_IMU);
+  ChannelReader stepReader(log, header, FLIGHT_LOG_CHANNEL_REPLAY);
+  ChannelReader controlReader(log, header, FLIGHT_LOG_CHANNEL_CONTROL);
+
+  PacketData logged;
+  bool haveLogged = controlReader.next((float*)&logged);
+  int32_t step[FLIGHT_LOG_MAX_FIELDS];
+  int32_t counts[FLIGHT_LOG_MAX_FIELDS];
+  uint32_t lidarCount = 0;
+  r.firstDifference = -1.0;
+
+  while (stepReader.next(step)) {
+    // Samples filtered before the step
+    while (r.imuSamples < (uint32_t)step[1]) {
+      if (!imuReader.next(counts)) {
+        fail(r, "imu samples missing");
+        break;
+      }
+      // Raw counts times the LSB, the same float operation as BMI088::convertSample()
+      ImuSample sample;
+      sample.timeStamp = REPLAY_TIME_BASE + counts[0];
+      for (int i = 0; i < 3; i++) {
+        sample.acc[i] = counts[1 + i] * scales[1 + i];
+        sample.gyro[i] = counts[4 + i] * scales[4 + i];
+      }
+      sample.newAcc = counts[11] != 0;
+      imu.filterSample(sample);
+      r.imuSamples++;
+    }
+    if (r.error[0]) {
+      break;
+    }
+    velocityEstimate();
+
+    if ((uint32_t)step[2] != lidarCount) {
+      if ((uint32_t)step[2] - lidarCount > 1) {
+        r.lidarGaps++;
+      }
+      lidarEstimate((int16_t)step[3]);
+      lidarCount = step[2];
+    }
+
+    controlCompute((uint32_t)step[0]);
+    r.steps++;
+
+    // The control record of the step. Records of steps whose log task didn't run are missing, the last one is
+    // logged twice at the end of the flight
+    float t = (float)(uint32_t)step[0];
+    while (haveLogged && logged.timeStamp < t) {
+      haveLogged = controlReader.next((float*)&logged);
+    }
+    if (!haveLogged || logged.timeStamp != t) {
+      continue;
+    }
+    r.compared++;
+    if (memcmp(&logged, &senderData, sizeof(PacketData)) == 0) {
+      r.identical++;
+      continue;
+    }
+
+    double errors[OUTPUTS] = {fabs((double)senderData.gimb1 - logged.gimb1), fabs((double)senderData.gimb2 - logged.gimb2),
+                              fabs((double)senderData.motorSpeed - logged.motorSpeed)};
+    bool differs = false;
+    for (int i = 0; i < OUTPUTS; i++) {
+      r.maxError[i] = std::max(r.maxError[i], errors[i]);
+      differs |= errors[i] > tolerance || isnan(errors[i]);
+    }
+    if (differs && r.differing++ == 0) {
+      r.firstDifference = t * 1e-6;
+    }
+  }
+  r.lostChunks = stepReader.lostChunks;
+}
+
+// Replay one log in a child process and collect its result
+static ReplayResult replay(const char* path, double tolerance) {
+  ReplayResult r = {};
+
+  int fds[2];
+  if (pipe(fds) != 0) {
+    fail(r, "can't create a pipe");
+    return r;
+  }
+
+  pid_t pid = fork();
+  if (pid == 0) {
+    // Don't hold on to the pipes of replays started by the other workers
+    long maxFd = sysconf(_SC_OPEN_MAX);
+    for (int fd = 3; fd < maxFd && fd < 1024; fd++) {
+      if (fd != fds[1]) {
+        close(fd);
+      }
+    }
+    Serial.setOutput(nullptr);
+
+    replayLog(path, tolerance, r);
+    r.completed = true;
+    ssize_t written = write(fds[1], &r, sizeof(r));
+    _exit(written == (ssize_t)sizeof(r) ? 0 : 3);
+  }
+  close(fds[1]);
+
+  size_t got = 0;
+  while (pid > 0 && got < sizeof(r)) {
+    ssize_t n = read(fds[0], (char*)&r + got, sizeof(r) - got);
+    if (n <= 0) {
+      break;
+    }
+    got += (size_t)n;
+  }
+  close(fds[0]);
+
+  int status = 0;
+  if (pid > 0) {
+    waitpid(pid, &status, 0);
+  }
+  if (got != sizeof(r)) {
+    r = ReplayResult();
+    r.status = status;
+    fail(r, "replay crashed");
+  }
+  return r;
+}
+
+
+// =============================================================================================
+//  Functions
+// =============================================================================================
+static void printUsage(const char* program) {
+  fprintf(stderr, "Replay usage: %s --replay [--tolerance T] [--jobs J] LOG...\n", program);
+}
+
+bool logReplayParseArgs(int& argc, char** argv, LogReplayOptions& options) {
+  bool replay = false;
+  for (int i = 1; i < argc; i++) {
+    replay |= strcmp(argv[i], "--replay") == 0;
+  }
+  if (!replay) {
+    return true;
+  }
+
+  // In replay mode all arguments belong to the replay
+  options.replay = true;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (arg == "--replay") {
+      continue;
+    }
+    else if (arg == "--tolerance" && hasValue) {
+      options.tolerance = atof(argv[++i]);
+    }
+    else if (arg == "--jobs" && hasValue) {
+      options.jobs = atoi(argv[++i]);
+    }
+    else if (arg.compare(0, 2, "--") == 0) {
+      fprintf(stderr, "Bad replay argument %s\n", arg.c_str());
+      printUsage(argv[0]);
+      return false;
+    }
+    else {
+      options.logs.push_back(argv[i]);
+    }
+  }
+  argc = 1;
+
+  if (options.logs.empty()) {
+    printUsage(argv[0]);
+    return false;
+  }
+  return true;
+}
+
+int logReplayRun(const LogReplayOptions& options) {
+  int n = (int)options.logs.size();
+  int jobs = options.jobs > 0 ? options.jobs : (int)std::thread::hardware_concurrency();
+  jobs = std::max(1, std::min(jobs, n));
+
+  std::vector<ReplayResult> results(n);
+  std::atomic<int> next(0);
+
+  // Nothing may be left in the stdio buffers when the workers start forking
+  fflush(stdout);
+  fflush(stderr);
+
+  auto tStart = std::chrono::steady_clock::now();
+  std::vector<std::thread> workers;
+  for (int w = 0; w < jobs; w++) {
+    workers.emplace_back([&]() {
+      int i;
+      while ((i = next++) < n) {
+        results[i] = replay(options.logs[i], options.tolerance);
+      }
+    });
+  }
+  for (std::thread& worker : workers) {
+    worker.join();
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - tStart).count();
+
+  int failed = 0, differing = 0;
+  uint64_t steps = 0;
+  for (int i = 0; i < n; i++) {
+    const ReplayResult& r = results[i];
+    if (!r.completed || r.error[0]) {
+      fprintf(stderr, "%s: %s\n", options.logs[i], r.error);
+      failed++;
+      continue;
+    }
+    steps += r.steps;
+    printf("%s: %llu steps (%llu compared, %llu identical records), %llu imu samples, max difference",
+           options.logs[i], (unsigned long long)r.steps, (unsigned long long)r.compared,
+           (unsigned long long)r.identical, (unsigned long long)r.imuSamples);
+    for (int k = 0; k < OUTPUTS; k++) {
+      printf(" %s %g", OUTPUT_NAMES[k], r.maxError[k]);
+    }
+    if (r.differing > 0) {
+      differing++;
+      printf(", %llu steps differ (first at %.3f s)", (unsigned long long)r.differing, r.firstDifference);
+    }
+    if (r.lostChunks || r.lidarGaps) {
+      printf(", %llu chunks lost, %llu lidar gaps", (unsigned long long)r.lostChunks, (unsigned long long)r.lidarGaps);
+    }
+    printf("\n");
+  }
+  printf("%d logs replayed, %llu steps in %.2f s (%d workers): %d match, %d differ%s\n", n - failed,
+         (unsigned long long)steps, seconds, jobs, n - failed - differing, differing,
+         failed ? ", some logs failed" : "");
+  return failed || differing ? 1 : 0;
+}
@@ -0,0 +1,41 @@
+// ==========================================
+// Host tools - Flight log replay
+// ==========================================
+
+/*
+* Reruns the estimator and the controller of this build on the inputs recorded in flight logs written with
+* FLIGHT_LOG_REPLAY and compares the result with the logged control records.
+* The log holds the filter and controller state at t0 (state chunk), every filtered BMI088 sample as raw sensor
+* counts (imu channel) and per control step its time, the number of samples filtered before it and the lidar
+* distance (replay channel). The replay restores the state, feeds the samples through Imu6DOF::filterSample(),
+* the distances through lidarEstimate() and runs controlCompute() at the logged step times, the same functions
+* the flight tasks run (Replay.h). A log replayed by the build that wrote it reproduces every control record bit
+* for bit (in the host simulation; logs of the Teensy can differ in the last bits where its libm or FMA
+* contraction rounds differently), so any difference after a filter or gain change is caused by the change.
+*
+* Per log the steps whose outputs (gimb1, gimb2, motorSpeed) differ by more than the tolerance are counted and
+* the largest differences are reported. The firmware keeps its state in globals, every log is replayed in its
+* own forked process, worker threads (one per core by default) take the next log when they are done with one.
+*/
+
+#pragma once
+
+#ifndef LOG_REPLAY_H
+#define LOG_REPLAY_H
+
+#include <vector>
+
+struct LogReplayOptions {
+  std::vector<const char*> logs;
+  bool replay = false;
+  double tolerance = 0.0;       // Allowed output difference (0: bit-exact)
+  int jobs = 0;                 // Worker threads (0: one per core)
+};
+
+// Take the replay arguments out of argv. Returns false on a bad argument
+bool logReplayParseArgs(int& argc, char** argv, LogReplayOptions& options);
+
+// Replay the logs and print a report. Returns the process exit code (1 if a log differs or fails)
+int logReplayRun(const LogReplayOptions& options);
+
+#endif
@@ -0,0 +1,426 @@
+// ==========================================
+// Host simulation - Monte Carlo flight campaign
+// ==========================================
+
+#include "Campaign.h"
+#include "SimRocket.h"
+#include <HostHAL.h>
+#include <settings.h>
+#include <GlobalDecRocket.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <math.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Controller reference of the firmware (main.cpp)
+extern LqrSignals lqrSignals;
+
+// =============================================================================================
+//  Definitions
+// =============================================================================================
+#define TIPPED_OVER_TILT 45.0     // A flight with more tilt than this [deg] is counted as lost
+
+// Randomized parameters of one flight
+struct FlightSetup {
+  double roll0, pitch0;
+  double massScale;
+  double noiseScale;
+  float accBias[3];
+  float gyroBias[3];
+  double dropoutRate;
+  double motorScale;
+  uint32_t seed;
+};
+
+// Sent from the flight process to the campaign through a pipe
+struct FlightResult {
+  bool completed;
+  int status;                   // waitpid() status of a failed flight
+  double rmsAltitudeError;      // [m]
+  double maxAltitudeError;      // [m]
+  double finalAltitudeError;    // [m]
+  double rmsTilt;               // [deg]
+  double maxTilt;               // [deg]
+  double maxAltitude;           // [m]
+  double liftOffTime;           // [s]
+  double gimbalSat;             // Fraction of the armed flight
+  double motorHigh;
+  double motorLow;
+  unsigned long touchdowns;
+};
+
+struct WorkQueue {
+  std::mutex lock;
+  std::deque<int> flights;
+};
+
+// Only used inside the flight process
+static int resultFd = -1;
+
+
+// =============================================================================================
+//  Flight process
+// =============================================================================================
+static FlightSetup drawSetup(const CampaignOptions& options, int flight) {
+  const CampaignDispersion& d = options.dispersion;
+  std::seed_seq seq{options.seed, (uint32_t)flight};
+  std::mt19937 rng(seq);
+  std::normal_distribution<double> normal;
+  std::uniform_real_distribution<double> uniform;
+
+  FlightSetup f;
+  f.roll0 = d.tilt * normal(rng);
+  f.pitch0 = d.tilt * normal(rng);
+  f.massScale = 1.0 + d.mass * normal(rng);
+  f.noiseScale = d.noiseMin + (d.noiseMax - d.noiseMin) * uniform(rng);
+  for (int i = 0; i < 3; i++) {
+    f.accBias[i] = float(d.accBias * normal(rng));
+    f.gyroBias[i] = float(d.gyroBias * normal(rng));
+  }
+  f.dropoutRate = d.dropoutMax * uniform(rng);
+  f.motorScale = 1.0 + d.motorCurve * normal(rng);
+  f.seed = rng();
+  return f;
+}
+
+static double flightReference() {
+  return lqrSignals.zRef;
+}
+
+// Exit handler of the flight process: report the statistics and leave without flushing the
+// stdio buffers inherited from the campaign
+static void sendResult(int code) {
+  const SimRocketStats& st = simRocketStats();
+  const RocketPlant& plant = simRocket();
+  double n = st.armedSteps > 0 ? double(st.armedSteps) : 1.0;
+
+  FlightResult r = {};
+  r.completed = true;
+  r.rmsAltitudeError = sqrt(st.sumSqAltitudeError / n);
+  r.maxAltitudeError = st.maxAltitudeError;
+  r.finalAltitudeError = fabs(plant.state().pos[2] - flightReference());
+  r.rmsTilt = sqrt(st.sumSqTilt / n);
+  r.maxTilt = st.maxTilt;
+  r.maxAltitude = st.maxAltitude;
+  r.liftOffTime = st.liftOffTime;
+  r.gimbalSat = st.gimbalSatSteps / n;
+  r.motorHigh = st.motorHighSteps / n;
+  r.motorLow = st.motorLowSteps / n;
+  r.touchdowns = st.touchdowns;
+
+  ssize_t written = write(resultFd, &r, sizeof(r));
+  _exit(written == (ssize_t)sizeof(r) ? code : 3);
+}
+
+static void flyInChild(const CampaignOptions& options, int flight, const FlightSetup& f) {
+  // Don't hold on to the pipes of flights started by the other workers
+  long maxFd = sysconf(_SC_OPEN_MAX);
+  for (int fd = 3; fd < maxFd && fd < 1024; fd++) {
+    if (fd != resultFd) {
+      close(fd);
+    }
+  }
+  alarm(options.timeout);
+
+  Serial.setOutput(nullptr);
+  if (options.logDir) {
+    std::string dir = std::string(options.logDir) + "/flight" + std::to_string(flight);
+    hostSetSdRoot(dir.c_str());
+  }
+  else {
+    hostSetSdRoot(nullptr);
+  }
+
+  hostImu.seed(f.seed);
+  hostImu.setNoise(hostImu.accNoiseStd() * f.noiseScale, hostImu.gyroNoiseStd() * f.noiseScale);
+  hostImu.setBias(f.accBias, f.gyroBias);
+  hostLidar.seed(f.seed + 1);
+  hostLidar.setDropoutRate(float(f.dropoutRate));
+
+  SimRocketConfig config;
+  config.params.m *= f.massScale;
+  config.params.thrustScale = f.motorScale;
+  config.roll0 = f.roll0;
+  config.pitch0 = f.pitch0;
+  config.reference = flightReference;
+  config.summary = false;
+  simRocketInit(config);
+  hostOnExit(sendResult);
+
+  setup();
+  while (true) {
+    loop();
+  }
+}
+
+// Fly one flight in a child process and collect its result
+static FlightResult fly(const CampaignOptions& options, int flight) {
+  FlightResult r = {};
+  FlightSetup f = drawSetup(options, flight);
+
+  int fds[2];
+  if (pipe(fds) != 0) {
+    return r;
+  }
+
+  pid_t pid = fork();
+  if (pid == 0) {
+    close(fds[0]);
+    resultFd = fds[1];
+    flyInChild(options, flight, f);
+  }
+  close(fds[1]);
+
+  size_t got = 0;
+  while (pid > 0 && got < sizeof(r)) {
+    ssize_t n = read(fds[0], (char*)&r + got, sizeof(r) - got);
+    if (n <= 0) {
+      break;
+    }
+    got += (size_t)n;
+  }
+  close(fds[0]);
+
+  int status = 0;
+  if (pid > 0) {
+    waitpid(pid, &status, 0);
+  }
+  if (got != sizeof(r)) {
+    r = FlightResult();
+    r.completed = false;
+    r.status = status;
+  }
+  return r;
+}
+
+
+// =============================================================================================
+//  Scheduling
+// =============================================================================================
+
+// Next flight of a worker: front of its own queue, otherwise steal from the back of another queue
+static bool takeFlight(std::vector<WorkQueue>& queues, int self, int& flight) {
+  {
+    std::lock_guard<std::mutex> guard(queues[self].lock);
+    if (!queues[self].flights.empty()) {
+      flight = queues[self].flights.front();
+      queues[self].flights.pop_front();
+      return true;
+    }
+  }
+
+  int n = (int)queues.size();
+  for (int k = 1; k < n; k++) {
+    WorkQueue& victim = queues[(self + k) % n];
+    std::lock_guard<std::mutex> guard(victim.lock);
+    if (!victim.flights.empty()) {
+      flight = victim.flights.back();
+      victim.flights.pop_back();
+      return true;
+    }
+  }
+  return false;
+}
+
+
+// =============================================================================================
+//  Report
+// =============================================================================================
+static void printRow(const char* name, std::vector<double> values, double scale) {
+  if (values.empty()) {
+    printf("  %-28s %10s\n", name, "-");
+    return;
+  }
+  std::sort(values.begin(), values.end());
+  double sum = 0.0;
+  for (double v : values) {
+    sum += v;
+  }
+  size_t n = values.size();
+  printf("  %-28s %10.4f %10.4f %10.4f %10.4f\n", name,
+         scale * sum / n, scale * values[n / 2], scale * values[std::min(n - 1, (size_t)(0.95 * n))],
+         scale * values[n - 1]);
+}
+
+static void printReport(const CampaignOptions& options, int jobs, double seconds, const std::vector<FlightResult>& results) {
+  std::vector<double> rmsAlt, maxAlt, finalAlt, rmsTilt, maxTilt, gimbalSat, motorHigh, motorLow;
+  int failed = 0, noLiftOff = 0, tipped = 0, touchdowns = 0;
+
+  for (const FlightResult& r : results) {
+    if (!r.completed) {
+      failed++;
+      continue;
+    }
+    if (r.liftOffTime < 0.0) {
+      noLiftOff++;
+    }
+    if (r.maxTilt > TIPPED_OVER_TILT) {
+      tipped++;
+    }
+    if (r.touchdowns > 0) {
+      touchdowns++;
+    }
+    rmsAlt.push_back(r.rmsAltitudeError);
+    maxAlt.push_back(r.maxAltitudeError);
+    finalAlt.push_back(r.finalAltitudeError);
+    rmsTilt.push_back(r.rmsTilt);
+    maxTilt.push_back(r.maxTilt);
+    gimbalSat.push_back(r.gimbalSat);
+    motorHigh.push_back(r.motorHigh);
+    motorLow.push_back(r.motorLow);
+  }
+
+  int n = (int)results.size();
+  printf("\n ===================== Monte Carlo campaign ===================== \n");
+  printf("  %d flights, %d workers, seed %u, %.1f s (%.1f flights/s)\n", n, jobs, options.seed, seconds, n / seconds);
+  printf("  completed: %d   failed (crash/timeout): %d\n", n - failed, failed);
+  printf("  no lift off: %d   tipped over (> %.0f deg): %d   touched down in flight: %d\n",
+         noLiftOff, TIPPED_OVER_TILT, tipped, touchdowns);
+  printf("\n  %-28s %10s %10s %10s %10s\n", "", "mean", "p50", "p95", "max");
+  printRow("RMS altitude error [m]", rmsAlt, 1.0);
+  printRow("Max altitude error [m]", maxAlt, 1.0);
+  printRow("Final altitude error [m]", finalAlt, 1.0);
+  printRow("RMS tilt [deg]", rmsTilt, 1.0);
+  printRow("Max tilt [deg]", maxTilt, 1.0);
+  printRow("Gimbal saturated [%]", gimbalSat, 100.0);
+  printRow("Motor at SPEED_LIMIT [%]", motorHigh, 100.0);
+  printRow("Motor at SPEED_MIN [%]", motorLow, 100.0);
+  printf(" ================================================================ \n");
+}
+
+static void writeCsv(const CampaignOptions& options, const std::vector<FlightResult>& results) {
+  FILE* fp = fopen(options.csvPath, "w");
+  if (!fp) {
+    fprintf(stderr, "Campaign: can't write %s\n", options.csvPath);
+    return;
+  }
+  fprintf(fp, "flight,roll0,pitch0,massScale,noiseScale,accBiasX,accBiasY,accBiasZ,gyroBiasX,gyroBiasY,gyroBiasZ,"
+              "dropoutRate,motorScale,completed,rmsAltitudeError,maxAltitudeError,finalAltitudeError,rmsTilt,maxTilt,"
+              "maxAltitude,liftOffTime,gimbalSat,motorHigh,motorLow,touchdowns\n");
+  for (size_t i = 0; i < results.size(); i++) {
+    FlightSetup f = drawSetup(options, (int)i);
+    const FlightResult& r = results[i];
+    fprintf(fp, "%zu,%.3f,%.3f,%.4f,%.3f,%.2f,%.2f,%.2f,%.3f,%.3f,%.3f,%.4f,%.4f,%d,%.5f,%.5f,%.5f,%.4f,%.4f,%.4f,%.4f,%.5f,%.5f,%.5f,%lu\n",
+            i, f.roll0, f.pitch0, f.massScale, f.noiseScale, f.accBias[0], f.accBias[1], f.accBias[2],
+            f.gyroBias[0], f.gyroBias[1], f.gyroBias[2], f.dropoutRate, f.motorScale, r.completed ? 1 : 0,
+            r.rmsAltitudeError, r.maxAltitudeError, r.finalAltitudeError, r.rmsTilt, r.maxTilt, r.maxAltitude,
+            r.liftOffTime, r.gimbalSat, r.motorHigh, r.motorLow, r.touchdowns);
+  }
+  fclose(fp);
+}
+
+
+// =============================================================================================
+//  Functions
+// =============================================================================================
+bool campaignParseArgs(int& argc, char** argv, CampaignOptions& options) {
+  int out = 1;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (arg == "--campaign" && hasValue) {
+      options.flights = atoi(argv[++i]);
+    }
+    else if (arg == "--jobs" && hasValue) {
+      options.jobs = atoi(argv[++i]);
+    }
+    else if (arg == "--seed" && hasValue) {
+      options.seed = (uint32_t)strtoul(argv[++i], nullptr, 0);
+    }
+    else if (arg == "--timeout" && hasValue) {
+      options.timeout = atoi(argv[++i]);
+    }
+    else if (arg == "--csv" && hasValue) {
+      options.csvPath = argv[++i];
+    }
+    else if (arg == "--logs" && hasValue) {
+      options.logDir = argv[++i];
+    }
+    else if (arg == "--campaign" || arg == "--jobs" || arg == "--seed" || arg == "--timeout" ||
+             arg == "--csv" || arg == "--logs") {
+      fprintf(stderr, "Missing value for %s\n", arg.c_str());
+      fprintf(stderr, "Campaign usage: %s --campaign N [--jobs J] [--seed S] [--timeout SEC] [--csv FILE] [--logs DIR]\n", argv[0]);
+      return false;
+    }
+    else {
+      argv[out++] = argv[i];
+    }
+  }
+  argc = out;
+  return true;
+}
+
+int campaignRun(const CampaignOptions& options) {
+  int jobs = options.jobs > 0 ? options.jobs : (int)std::thread::hardware_concurrency();
+  if (jobs < 1) {
+    jobs = 1;
+  }
+  jobs = std::min(jobs, options.flights);
+  if (options.logDir) {
+    mkdir(options.logDir, 0755);
+  }
+
+  // Deal the flights out in contiguous blocks
+  std::vector<WorkQueue> queues(jobs);
+  for (int i = 0; i < options.flights; i++) {
+    queues[(int)((long)i * jobs / options.flights)].flights.push_back(i);
+  }
+
+  std::vector<FlightResult> results(options.flights);
+  std::atomic<int> done(0);
+  std::mutex printLock;
+  bool progress = isatty(STDERR_FILENO);
+
+  // Nothing may be left in the stdio buffers when the workers start forking
+  fflush(stdout);
+  fflush(stderr);
+
+  auto tStart = std::chrono::steady_clock::now();
+  std::vector<std::thread> workers;
+  for (int w = 0; w < jobs; w++) {
+    workers.emplace_back([&, w]() {
+      int flight;
+      while (takeFlight(queues, w, flight)) {
+        results[flight] = fly(options, flight);
+        int n = ++done;
+        if (progress) {
+          std::lock_guard<std::mutex> guard(printLock);
+          fprintf(stderr, "\rFlights: %d / %d", n, options.flights);
+        }
+      }
+    });
+  }
+  for (std::thread& worker : workers) {
+    worker.join();
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - tStart).count();
+  if (progress) {
+    fprintf(stderr, "\n");
+  }
+
+  printReport(options, jobs, seconds, results);
+  if (options.csvPath) {
+    writeCsv(options, results);
+  }
+
+  for (const FlightResult& r : results) {
+    if (!r.completed) {
+      return 1;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,51 @@
+// ==========================================
+// Host simulation - Monte Carlo flight campaign
+// ==========================================
+
+/*
+* Runs many randomized closed-loop flights of the firmware (with the gains currently set in lqrInit())
+* and reports tracking error and actuator saturation statistics.
+*
+* The firmware keeps its state in globals, so every flight runs in its own forked process. Worker threads
+* (one per core by default) take flights from per-worker queues and steal from the other queues when
+* their own runs empty, so long flights (e.g. tipped over rockets) don't leave cores idle.
+* The dispersions of a flight only depend on the campaign seed and the flight number, a single flight
+* can therefore be rerun on its own.
+*/
+
+#pragma once
+
+#ifndef CAMPAIGN_H
+#define CAMPAIGN_H
+
+#include <stdint.h>
+
+// Standard deviations (or ranges) of the randomized parameters
+struct CampaignDispersion {
+  double tilt = 1.0;            // Initial roll / pitch on the pad [deg]
+  double mass = 0.05;           // Relative mass error
+  double noiseMin = 0.5;        // IMU noise scale, uniform in [noiseMin, noiseMax]
+  double noiseMax = 2.0;
+  double accBias = 20.0;        // Accelerometer bias [mg]
+  double gyroBias = 0.5;        // Gyroscope bias [dps]
+  double dropoutMax = 0.1;      // Lidar dropout rate, uniform in [0, dropoutMax]
+  double motorCurve = 0.05;     // Relative thrust curve error
+};
+
+struct CampaignOptions {
+  int flights = 0;              // Number of flights (0: no campaign)
+  int jobs = 0;                 // Worker threads (0: one per core)
+  uint32_t seed = 1;
+  int timeout = 120;            // Wall clock limit per flight [s]
+  const char* csvPath = nullptr;  // Per flight results
+  const char* logDir = nullptr;   // Keep the SD card of every flight in logDir/flightN (none by default)
+  CampaignDispersion dispersion;
+};
+
+// Take the campaign arguments out of argv (the rest is left for hostInit). Returns false on a bad argument
+bool campaignParseArgs(int& argc, char** argv, CampaignOptions& options);
+
+// Run the campaign and print the report. Returns the process exit code
+int campaignRun(const CampaignOptions& options);
+
+#endif
@@ -0,0 +1,55 @@
+// ================================
+// Host simulation - Program entry
+// ================================
+
+/*
+* On the Teensy the core calls setup() once and loop() forever. The host build does the same until
+* the firmware ends the flight (hostExit). The firmware flies the simulated rocket (SimRocket.h)
+* With --campaign N the program runs a Monte Carlo campaign of N flights instead (Campaign.h),
+* with --decode it converts flight logs (LogDecoder.h), with --replay it reruns the estimator and the controller
+* on the inputs of flight logs (LogReplay.h)
+*/
+
+#include <HostHAL.h>
+#include "SimRocket.h"
+#include "Campaign.h"
+#include <LogDecoder.h>
+#include <LogReplay.h>
+
+int main(int argc, char** argv) {
+  LogDecodeOptions decode;
+  if (!logDecodeParseArgs(argc, argv, decode)) {
+    return 2;
+  }
+  if (decode.decode) {
+    return logDecodeRun(decode);
+  }
+
+  LogReplayOptions replay;
+  if (!logReplayParseArgs(argc, argv, replay)) {
+    return 2;
+  }
+  if (replay.replay) {
+    return logReplayRun(replay);
+  }
+
+  CampaignOptions campaign;
+  if (!campaignParseArgs(argc, argv, campaign)) {
+    return 2;
+  }
+  hostInit(argc, argv);
+
+  if (campaign.flights > 0) {
+    return campaignRun(campaign);
+  }
+
+  // Benchmarks measure the firmware alone
+  #ifndef BENCHMARK
+    simRocketInit();
+  #endif
+
+  setup();
+  while (true) {
+    loop();
+  }
+}
@@ -0,0 +1,232 @@
+// ======================================
+// Host simulation - Rocket plant (6-DOF)
+// ======================================
+
+#include "RocketPlant.h"
+#include <math.h>
+
+// =============================================================================================
+//  Definitions
+// =============================================================================================
+#define DEG2RAD 0.017453292519943295
+#define RAD2DEG 57.29577951308232
+
+#define GRAMS_PER_NEWTON 101.83     // Same conversion as in lqr()
+#define PWM_MIN 1100
+#define PWM_MAX 1940
+
+// Thrust curve from LQR.cpp: motor rate [%] as a function of the thrust of the motor pair [g]
+static double motorRateOfGrams(double x) {
+  return 1e-9 * x * x * x - 6e-6 * x * x + 0.0305 * x + 8.3411;
+}
+
+// Rotation matrix (body to world) of a unit quaternion
+static void toMatrix(const double q[4], double R[3][3]) {
+  double w = q[0], x = q[1], y = q[2], z = q[3];
+  R[0][0] = 1.0 - 2.0*(y*y + z*z);  R[0][1] = 2.0*(x*y - w*z);        R[0][2] = 2.0*(x*z + w*y);
+  R[1][0] = 2.0*(x*y + w*z);        R[1][1] = 1.0 - 2.0*(x*x + z*z);  R[1][2] = 2.0*(y*z - w*x);
+  R[2][0] = 2.0*(x*z - w*y);        R[2][1] = 2.0*(y*z + w*x);        R[2][2] = 1.0 - 2.0*(x*x + y*y);
+}
+
+static double approach(double value, double target, double maxStep) {
+  double d = target - value;
+  if (d > maxStep) {
+    d = maxStep;
+  }
+  else if (d < -maxStep) {
+    d = -maxStep;
+  }
+  return value + d;
+}
+
+
+// =============================================================================================
+//  Functions
+// =============================================================================================
+RocketPlant::RocketPlant(const RocketParams& params) : p(params) {
+  reset();
+}
+
+void RocketPlant::reset(double roll, double pitch) {
+  s = RocketState();
+  t = 0.0;
+  pulses[0] = pulses[1] = -1;
+  thrustCmd[0] = thrustCmd[1] = 0.0;
+  gimbalCmd[0] = gimbalCmd[1] = 0.0;
+  accWorld[0] = accWorld[1] = accWorld[2] = 0.0;
+
+  // gamma1 is the rotation about x, gamma2 the negative rotation about y (yaw zero)
+  double hr = 0.5 * roll * DEG2RAD;
+  double hp = -0.5 * pitch * DEG2RAD;
+  s.q[0] = cos(hr) * cos(hp);
+  s.q[1] = sin(hr) * cos(hp);
+  s.q[2] = cos(hr) * sin(hp);
+  s.q[3] = -sin(hr) * sin(hp);
+}
+
+// Invert the thrust curve (monotonic) with a few Newton steps
+double RocketPlant::pulseToThrust(int us) {
+  if (us <= PWM_MIN) {
+    return 0.0;
+  }
+  if (us > PWM_MAX) {
+    us = PWM_MAX;
+  }
+  double rate = double(us - PWM_MIN) * 100.0 / double(PWM_MAX - PWM_MIN);
+  if (rate <= motorRateOfGrams(0.0)) {
+    return 0.0;
+  }
+
+  double x = (rate - 8.3411) / 0.0305;
+  for (int i = 0; i < 20; i++) {
+    double f = motorRateOfGrams(x) - rate;
+    double df = 3e-9 * x * x - 12e-6 * x + 0.0305;
+    double dx = f / df;
+    x -= dx;
+    if (fabs(dx) < 1e-6) {
+      break;
+    }
+  }
+  return x / GRAMS_PER_NEWTON;
+}
+
+void RocketPlant::setMotorPulses(int motor1Us, int motor2Us) {
+  if (motor1Us == pulses[0] && motor2Us == pulses[1]) {
+    return;
+  }
+  pulses[0] = motor1Us;
+  pulses[1] = motor2Us;
+
+  // The thrust curve is measured for both motors at the same speed, each motor gives half of it
+  thrustCmd[0] = 0.5 * p.thrustScale * pulseToThrust(motor1Us);
+  thrustCmd[1] = 0.5 * p.thrustScale * pulseToThrust(motor2Us);
+}
+
+void RocketPlant::setGimbal(double delta1, double delta2) {
+  gimbalCmd[0] = fmax(-p.gimbalLimit, fmin(p.gimbalLimit, delta1));
+  gimbalCmd[1] = fmax(-p.gimbalLimit, fmin(p.gimbalLimit, delta2));
+}
+
+void RocketPlant::step(double dt) {
+  // ============ Actuators ==============
+  double a = dt / (p.motorTau + dt);
+  s.thrust[0] += a * (thrustCmd[0] - s.thrust[0]);
+  s.thrust[1] += a * (thrustCmd[1] - s.thrust[1]);
+  s.gimbal[0] = approach(s.gimbal[0], gimbalCmd[0], p.gimbalRate * dt);
+  s.gimbal[1] = approach(s.gimbal[1], gimbalCmd[1], p.gimbalRate * dt);
+
+  // ============ Forces and torques (body frame) ==============
+  double T = s.thrust[0] + s.thrust[1];
+  double d1 = s.gimbal[0] * DEG2RAD;
+  double d2 = s.gimbal[1] * DEG2RAD;
+  double c1 = cos(d1);
+  double Fb[3] = {T * c1 * sin(d2), T * sin(d1), T * c1 * cos(d2)};
+
+  // Thrust acts below the center of mass (r = (0, 0, -h))
+  double tau[3] = {
+    p.h1 * Fb[1] - p.angularDrag * s.w[0],
+    -p.h2 * Fb[0] - p.angularDrag * s.w[1],
+    p.yawTorqueCoeff * (s.thrust[1] - s.thrust[0]) - p.angularDrag * s.w[2]
+  };
+
+  double R[3][3];
+  toMatrix(s.q, R);
+
+  double F[3];
+  for (int i = 0; i < 3; i++) {
+    F[i] = R[i][0]*Fb[0] + R[i][1]*Fb[1] + R[i][2]*Fb[2] - p.linearDrag * s.vel[i];
+  }
+  F[2] -= p.m * p.g;
+
+  // ============ Ground contact ==============
+  if (s.landed) {
+    if (F[2] <= 0.0) {
+      accWorld[0] = accWorld[1] = accWorld[2] = 0.0;
+      t += dt;
+      return;
+    }
+    s.landed = false;
+  }
+
+  // ============ Rotation (Euler's equations) ==============
+  double J[3] = {p.Jx, p.Jy, p.Jz};
+  double Jw[3] = {J[0]*s.w[0], J[1]*s.w[1], J[2]*s.w[2]};
+  double gyro[3] = {
+    s.w[1]*Jw[2] - s.w[2]*Jw[1],
+    s.w[2]*Jw[0] - s.w[0]*Jw[2],
+    s.w[0]*Jw[1] - s.w[1]*Jw[0]
+  };
+  for (int i = 0; i < 3; i++) {
+    s.w[i] += (tau[i] - gyro[i]) / J[i] * dt;
+  }
+
+  // Attitude: q = q * exp(w dt / 2)
+  double wn = sqrt(s.w[0]*s.w[0] + s.w[1]*s.w[1] + s.w[2]*s.w[2]);
+  if (wn > 1e-12) {
+    double half = 0.5 * wn * dt;
+    double k = sin(half) / wn;
+    double dq[4] = {cos(half), s.w[0]*k, s.w[1]*k, s.w[2]*k};
+    double q0 = s.q[0], q1 = s.q[1], q2 = s.q[2], q3 = s.q[3];
+    s.q[0] = q0*dq[0] - q1*dq[1] - q2*dq[2] - q3*dq[3];
+    s.q[1] = q0*dq[1] + q1*dq[0] + q2*dq[3] - q3*dq[2];
+    s.q[2] = q0*dq[2] - q1*dq[3] + q2*dq[0] + q3*dq[1];
+    s.q[3] = q0*dq[3] + q1*dq[2] - q2*dq[1] + q3*dq[0];
+    double n = 1.0 / sqrt(s.q[0]*s.q[0] + s.q[1]*s.q[1] + s.q[2]*s.q[2] + s.q[3]*s.q[3]);
+    for (int i = 0; i < 4; i++) {
+      s.q[i] *= n;
+    }
+  }
+
+  // ============ Translation ==============
+  for (int i = 0; i < 3; i++) {
+    accWorld[i] = F[i] / p.m;
+    s.vel[i] += accWorld[i] * dt;
+    s.pos[i] += s.vel[i] * dt;
+  }
+
+  // Touch down: the legs stop the rocket
+  if (s.pos[2] <= 0.0) {
+    s.pos[2] = 0.0;
+    for (int i = 0; i < 3; i++) {
+      s.vel[i] = 0.0;
+      s.w[i] = 0.0;
+      accWorld[i] = 0.0;
+    }
+    s.landed = true;
+  }
+
+  t += dt;
+}
+
+void RocketPlant::specificForce(double f[3]) const {
+  double R[3][3];
+  toMatrix(s.q, R);
+  double a[3] = {accWorld[0], accWorld[1], accWorld[2] + p.g};
+  for (int i = 0; i < 3; i++) {
+    f[i] = R[0][i]*a[0] + R[1][i]*a[1] + R[2][i]*a[2];
+  }
+}
+
+double RocketPlant::tiltCos() const {
+  return 1.0 - 2.0*(s.q[1]*s.q[1] + s.q[2]*s.q[2]);
+}
+
+double RocketPlant::roll() const {
+  const double* q = s.q;
+  return atan2(q[0]*q[1] + q[2]*q[3], 0.5 - q[1]*q[1] - q[2]*q[2]) * RAD2DEG;
+}
+
+double RocketPlant::pitch() const {
+  const double* q = s.q;
+  double v = -2.0 * (q[1]*q[3] - q[0]*q[2]);
+  v = fmax(-1.0, fmin(1.0, v));
+  return -asin(v) * RAD2DEG;
+}
+
+double RocketPlant::lidarDistance() const {
+  double c = tiltCos();
+  if (c < 0.1) {
+    c = 0.1;
+  }
+  return (s.pos[2] + p.lidarOffset) / c;
+}
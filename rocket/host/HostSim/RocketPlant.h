@@ -0,0 +1,101 @@
+// ======================================
+// Host simulation - Rocket plant (6-DOF)
+// ======================================
+
+/*
+* Nonlinear 6-DOF model of the rocket, the C++ counterpart of Matlab_LQR/simulator_code/fDOF_sim_V2.m
+* (parameters from Matlab_LQR/gain_and_trajectory_calculation.m)
+*
+* Rigid body with two coaxial motors in a two axis gimbal below the center of mass:
+*   - thrust of each motor follows its command with a first order lag (motor lag)
+*   - the gimbal tilts the thrust vector, the lateral thrust component at distance h1 / h2 from the
+*     center of mass gives the roll / pitch torques, the thrust difference of the motors the yaw torque
+*   - the servos follow their command with a limited rate
+*   - gravity, linear drag and a flat ground the rocket rests on before lift off
+*
+* Frames: world z is up. The body frame is the frame of the madgwick filter in the firmware
+* (x: roll axis, gamma1; y: pitch axis with gamma2 = -rotation about y; z: along the rocket, up)
+*
+* The model has no dependencies on the HAL and does not allocate, so it can be stepped on its own at
+* millions of steps per second (see SimRocket.h for the coupling to the emulated hardware)
+*/
+
+#pragma once
+
+#ifndef ROCKET_PLANT_H
+#define ROCKET_PLANT_H
+
+struct RocketParams {
+  double m = 2.5;               // Mass [kg]
+  double Jx = 0.215;            // Inertia about the body x axis [kg m^2]
+  double Jy = 0.226;            // Inertia about the body y axis [kg m^2]
+  double Jz = 0.304;            // Inertia about the rocket axis [kg m^2]
+  double h1 = 0.455933;         // Distance center of mass to the lower gimbal axis (servo 1, roll) [m]
+  double h2 = 0.330933;         // Distance center of mass to the upper gimbal axis (servo 2, pitch) [m]
+  double g = 9.82;              // Gravitational acceleration [m/s^2]
+
+  double motorTau = 0.05;       // Motor (thrust) time constant [s]
+  double thrustScale = 1.0;     // Scale of the thrust curve (motor/propeller spread)
+  double yawTorqueCoeff = 0.01; // Yaw torque per Newton of thrust difference [m]
+  double gimbalRate = 600.0;    // Maximum servo speed [deg/s]
+  double gimbalLimit = 30.0;    // Mechanical gimbal limit [deg]
+
+  double linearDrag = 0.1;      // Translational drag [N/(m/s)]
+  double angularDrag = 0.002;   // Rotational drag [Nm/(rad/s)]
+
+  double lidarOffset = 0.10;    // Height of the lidar above the ground when landed [m]
+};
+
+struct RocketState {
+  double pos[3] = {0.0, 0.0, 0.0};        // World position [m]
+  double vel[3] = {0.0, 0.0, 0.0};        // World velocity [m/s]
+  double q[4] = {1.0, 0.0, 0.0, 0.0};     // Attitude, body to world (w, x, y, z)
+  double w[3] = {0.0, 0.0, 0.0};          // Body angular rate [rad/s]
+  double thrust[2] = {0.0, 0.0};          // Thrust of motor 1 (lower) and motor 2 (upper) [N]
+  double gimbal[2] = {0.0, 0.0};          // Gimbal angles delta1 (servo 1) and delta2 (servo 2) [deg]
+  bool landed = true;
+};
+
+class RocketPlant {
+public:
+  explicit RocketPlant(const RocketParams& params = RocketParams());
+
+  void setParams(const RocketParams& params) { p = params; }
+  const RocketParams& params() const { return p; }
+
+  // Start at rest on the ground, tilted by roll / pitch [deg] (gamma1, gamma2)
+  void reset(double roll = 0.0, double pitch = 0.0);
+
+  // Actuator commands: motor PWM on-time [us] and gimbal angles [deg] (delta1, delta2)
+  void setMotorPulses(int motor1Us, int motor2Us);
+  void setGimbal(double delta1, double delta2);
+
+  // Advance the model by dt [s]
+  void step(double dt);
+
+  const RocketState& state() const { return s; }
+  RocketState& state() { return s; }
+  double time() const { return t; }
+
+  // ============ Derived quantities ==============
+  void specificForce(double f[3]) const;    // What an accelerometer in the body frame measures [m/s^2]
+  double tiltCos() const;                   // Cosine of the angle between the rocket axis and world z
+  double roll() const;                      // gamma1 [deg], like imu.roll_IMU
+  double pitch() const;                     // gamma2 [deg], like imu.pitch_IMU
+  double lidarDistance() const;             // Distance along the rocket axis to the ground [m]
+
+  // Thrust curve of the motor pair (inverse of thrustToPwm() in LQR.cpp)
+  static double pulseToThrust(int us);      // Total thrust of both motors running at us [N]
+
+private:
+  RocketParams p;
+  RocketState s;
+  double t = 0.0;
+
+  int pulses[2] = {-1, -1};
+  double thrustCmd[2] = {0.0, 0.0};
+  double gimbalCmd[2] = {0.0, 0.0};
+  double accWorld[3] = {0.0, 0.0, 0.0};
+};
+
+#endif
@@ -0,0 +1,128 @@
+// ===========================================
+// Host simulation - Closed loop rocket model
+// ===========================================
+
+#include "SimRocket.h"
+#include <HostHAL.h>
+#include <settings.h>
+#include <math.h>
+
+// =============================================================================================
+//  Variables
+// =============================================================================================
+static RocketPlant plant;
+static SimRocketStats stats;
+static SimRocketConfig simConfig;
+
+
+// =============================================================================================
+//  Functions
+// =============================================================================================
+
+// Gimbal angle [deg] commanded by a servo pulse (inverse of setServoXPos(-angle))
+static double servoPulseToGimbal(int us, int home) {
+  if (us <= 0) {
+    return 0.0;
+  }
+  double servoAngle = double(us - 900) * 120.0 / 1200.0;
+  return -(servoAngle - home);
+}
+
+// Write the plant state to the simulated sensors (mounting as expected by imu.madgwickStep())
+static void updateSensors() {
+  const RocketState& s = plant.state();
+  double f[3];
+  plant.specificForce(f);
+
+  double mgPerMs2 = 1000.0 / plant.params().g;
+  hostImu.setAcceleration(float(-f[0] * mgPerMs2), float(f[1] * mgPerMs2), float(f[2] * mgPerMs2));
+
+  double dps = 57.29577951308232;
+  hostImu.setGyroscope(float(s.w[0] * dps), float(-s.w[1] * dps), float(-s.w[2] * dps));
+
+  hostLidar.setDistance((int16_t)lround(plant.lidarDistance() * 100.0));
+}
+
+static void plantStep() {
+  int motor1 = hostServoMicros(MOTOR_1_PIN);
+  int motor2 = hostServoMicros(MOTOR_2_PIN);
+  double gimbal1 = servoPulseToGimbal(hostServoMicros(SERVO_1_PIN), SERVO_1_HOME);
+  double gimbal2 = servoPulseToGimbal(hostServoMicros(SERVO_2_PIN), SERVO_2_HOME);
+
+  bool wasLanded = plant.state().landed;
+  plant.setMotorPulses(motor1, motor2);
+  plant.setGimbal(gimbal1, gimbal2);
+  plant.step(simConfig.dt);
+  updateSensors();
+
+  // ============ Statistics ==============
+  const RocketState& s = plant.state();
+  if (s.pos[2] > stats.maxAltitude) {
+    stats.maxAltitude = s.pos[2];
+  }
+  double tilt = acos(fmax(-1.0, fmin(1.0, plant.tiltCos()))) * 57.29577951308232;
+  if (tilt > stats.maxTilt) {
+    stats.maxTilt = tilt;
+  }
+  if (!s.landed && stats.liftOffTime < 0.0) {
+    stats.liftOffTime = plant.time();
+  }
+  if (s.landed && !wasLanded) {
+    stats.touchdowns++;
+  }
+  stats.steps++;
+
+  if (digitalRead(RED_LED_PIN) == HIGH) {
+    stats.armedSteps++;
+    stats.sumSqTilt += tilt * tilt;
+    if (simConfig.reference) {
+      double e = fabs(s.pos[2] - simConfig.reference());
+      stats.sumSqAltitudeError += e * e;
+      if (e > stats.maxAltitudeError) {
+        stats.maxAltitudeError = e;
+      }
+    }
+    if (fabs(gimbal1) >= MAX_GIMBAL || fabs(gimbal2) >= MAX_GIMBAL) {
+      stats.gimbalSatSteps++;
+    }
+    if (motor1 >= SPEED_LIMIT || motor2 >= SPEED_LIMIT) {
+      stats.motorHighSteps++;
+    }
+    else if (motor1 <= SPEED_MIN || motor2 <= SPEED_MIN) {
+      stats.motorLowSteps++;
+    }
+  }
+}
+
+static void printSummary(int code) {
+  (void)code;
+  const RocketState& s = plant.state();
+  fprintf(stderr, "Sim: t = %.3f s, pos = (%.3f, %.3f, %.3f) m, roll = %.2f, pitch = %.2f deg, "
+          "max altitude = %.3f m, max tilt = %.2f deg\n",
+          plant.time(), s.pos[0], s.pos[1], s.pos[2], plant.roll(), plant.pitch(),
+          stats.maxAltitude, stats.maxTilt);
+}
+
+void simRocketInit(const SimRocketConfig& config) {
+  simConfig = config;
+  plant.setParams(config.params);
+  plant.reset(config.roll0, config.pitch0);
+  stats = SimRocketStats();
+
+  updateSensors();
+  hostImu.connectInterrupts(IMU_ACC_INT_PIN, IMU_GYRO_INT_PIN);
+
+  uint64_t period = (uint64_t)llround(config.dt * 1e9);
+  hostSchedulePeriodic(hostNanos() + period, period, plantStep);
+  if (config.summary) {
+    hostOnExit(printSummary);
+  }
+}
+
+RocketPlant& simRocket() {
+  return plant;
+}
+
+const SimRocketStats& simRocketStats() {
+  return stats;
+}
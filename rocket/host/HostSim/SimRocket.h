@@ -0,0 +1,53 @@
+// ===========================================
+// Host simulation - Closed loop rocket model
+// ===========================================
+
+/*
+* Couples the 6-DOF plant (RocketPlant.h) to the emulated hardware so the unmodified firmware flies it:
+*   - motor and servo pulses written by motorsWrite() / setServoXPos() drive the plant
+*   - the plant state is written back to the simulated BMI088 and TFMini-Plus every step
+* The plant runs as a periodic event of the host scheduler (HostClock.h)
+*/
+
+#pragma once
+
+#ifndef SIM_ROCKET_H
+#define SIM_ROCKET_H
+
+#include "RocketPlant.h"
+
+struct SimRocketConfig {
+  RocketParams params;
+  double dt = 0.0005;           // Plant step [s]
+  double roll0 = 0.0;           // Initial tilt on the launch pad [deg]
+  double pitch0 = 0.0;
+
+  double (*reference)() = nullptr;  // Altitude reference of the controller [m], for the tracking statistics
+  bool summary = true;              // Print a flight summary when the program ends
+};
+
+// Flight statistics collected while the plant runs
+// The armed flight is the time the firmware has the red LED on (main loop)
+struct SimRocketStats {
+  double maxAltitude = 0.0;         // [m]
+  double maxTilt = 0.0;             // [deg]
+  double liftOffTime = -1.0;        // Plant time of the first lift off [s] (-1: never)
+  unsigned long steps = 0;
+
+  unsigned long armedSteps = 0;
+  double sumSqAltitudeError = 0.0;  // (z - reference)^2 summed over the armed steps [m^2]
+  double maxAltitudeError = 0.0;    // [m]
+  double sumSqTilt = 0.0;           // [deg^2]
+  unsigned long gimbalSatSteps = 0; // Armed steps with a gimbal command at MAX_GIMBAL
+  unsigned long motorHighSteps = 0; // Armed steps with a motor command at SPEED_LIMIT
+  unsigned long motorLowSteps = 0;  // Armed steps with a motor command at SPEED_MIN
+  unsigned long touchdowns = 0;     // Ground contacts after lift off
+};
+
+// Create the plant and start stepping it (call after hostInit)
+void simRocketInit(const SimRocketConfig& config = SimRocketConfig());
+
+RocketPlant& simRocket();
+const SimRocketStats& simRocketStats();
+
+#endif
@@ -0,0 +1,81 @@
+// ==================================
+// ===== Benchmarks (Header) ========
+// ==================================
+
+/*
+* Microbenchmarks of the flight hot path (only built with -D BENCHMARK)
+* Every function is timed call by call with a cycle counter:
+*   - Teensy: Cortex-M7 DWT cycle counter (CPU clock cycles)
+*   - Host:   TSC on x86 (calibrated against std::chrono), otherwise std::chrono nanoseconds
+* Both print the same table so results from the bench and the host can be compared directly
+*/
+
+#pragma once
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <Arduino.h>
+
+#ifdef BENCHMARK
+
+// Main loop budget at MADGWICK_FREQUENCY [us]
+#define BENCH_LOOP_BUDGET_US (1000000.0 / MADGWICK_FREQUENCY)
+
+struct BenchResult {
+  const char* name;
+  unsigned long iterations;
+  uint32_t minCycles;
+  uint32_t maxCycles;
+  double meanCycles;
+};
+
+// ============ Cycle counter ==============
+void benchInit();
+uint32_t benchCycles();
+double benchCyclesPerUs();
+
+// Print the table header / one result line
+void benchPrintHeader();
+void benchPrint(const BenchResult& result);
+
+// Time fn() iterations times, call by call (the cost of reading the counter is subtracted)
+template <typename Fn>
+BenchResult benchRun(const char* name, unsigned long iterations, Fn fn) {
+  // Cost of an empty measurement
+  uint32_t overhead = 0xFFFFFFFF;
+  for (int i = 0; i < 100; i++) {
+    uint32_t c0 = benchCycles();
+    uint32_t c1 = benchCycles();
+    if (c1 - c0 < overhead) {
+      overhead = c1 - c0;
+    }
+  }
+
+  BenchResult result = {name, iterations, 0xFFFFFFFF, 0, 0.0};
+  double sum = 0.0;
+  for (unsigned long i = 0; i < iterations; i++) {
+    uint32_t c0 = benchCycles();
+    fn();
+    uint32_t c1 = benchCycles();
+    uint32_t c = c1 - c0;
+    c = c > overhead ? c - overhead : 0;
+    if (c < result.minCycles) {
+      result.minCycles = c;
+    }
+    if (c > result.maxCycles) {
+      result.maxCycles = c;
+    }
+    sum += c;
+  }
+  result.meanCycles = iterations > 0 ? sum / iterations : 0.0;
+  benchPrint(result);
+  return result;
+}
+
+// Run the whole suite (called from setup() in benchmark builds)
+void runBenchmarks();
+
+#endif
+
+#endif
@@ -0,0 +1,55 @@
+// ==================================
+// ===== Black box (Header) =========
+// ==================================
+
+/*
+* In-RAM black box of the last BLACK_BOX_SECONDS of the flight
+* Every frame of the main loop (MADGWICK_FREQUENCY) appends one record of the estimator state, the sensor
+* values it was computed from and the actuator commands to a fixed size ring. The ring lives in the Teensy
+* DMAMEM (RAM2, 512 kB that otherwise only holds the heap), so it costs neither tightly coupled RAM
+* nor SD writes in flight: appending is a 64 byte copy, older records are overwritten.
+* The ring is only written to the card when the flight ends (time limit or emergency stop), oldest record
+* first, as a file in the flight log format (FlightLog.h) with the single channel FLIGHT_LOG_CHANNEL_BLACK_BOX,
+* so the host decoder converts it like a flight log (program --decode blackBoxN.bin).
+*/
+
+#pragma once
+
+#ifndef BLACK_BOX_H
+#define BLACK_BOX_H
+
+#include <Arduino.h>
+#include <settings.h>
+#include "FlightLog.h"
+
+#define BLACK_BOX_RECORDS (BLACK_BOX_SECONDS * MADGWICK_FREQUENCY)
+
+// One frame of the main loop, a uint32 time stamp and float32 fields (a FLIGHT_LOG_ENCODING_TIME_FLOAT32 channel)
+struct BlackBoxRecord {
+  uint32_t timeStamp;       // [us] since the start of the flight
+  float acc[3];             // Bias corrected, low pass filtered [mg]
+  float gyro[3];            // Bias corrected, low pass filtered [dps]
+  float roll;               // Attitude [deg]
+  float pitch;
+  float yaw;
+  float z;                  // Altitude [m]
+  float zDot;               // [m/s]
+  float gimb1;              // Last gimbal commands [deg]
+  float gimb2;
+  float motor1;             // Last motor commands [us]
+  float motor2;
+};
+
+static_assert(sizeof(BlackBoxRecord) == 16 * sizeof(float), "BLACK_BOX_FIELDS must list the fields of BlackBoxRecord");
+
+// Start an empty ring (at t0)
+void blackBoxInit();
+
+// Append a record, overwriting the oldest one when the ring is full
+void blackBoxAppend(const BlackBoxRecord& record);
+
+// Write the ring to a new file, oldest record first. Blocking, only called once the flight has ended.
+// Returns the number of records written (0 on an SD error)
+uint32_t blackBoxDump(const char* filename);
+
+#endif
@@ -0,0 +1,27 @@
+// ==============
+// Time source
+// ==============
+
+/*
+* Waiting primitive used by the rate gates
+* On the Teensy it busy-waits on micros(). In the host build the HAL implements it, so that the
+* simulation's virtual clock can jump straight to the wake-up time instead of spinning
+*/
+
+#pragma once
+
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include <Arduino.h>
+
+#ifdef HOST_BUILD
+  #include <HostClock.h>
+#else
+  // Wait until micros() has reached tWake (wrap-around safe)
+  inline void waitUntilMicros(unsigned long tWake) {
+    while ((long)(micros() - tWake) < 0) {}
+  }
+#endif
+
+#endif
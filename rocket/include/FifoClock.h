@@ -0,0 +1,77 @@
+// ==================================
+// ===== FIFO time stamps (Header) ==
+// ==================================
+
+/*
+* Time stamps of sensor FIFO frames
+* A FIFO read only tells how many frames were stored, not when. The frames are produced on the sensor's own
+* output data rate clock, so the frames of a batch are spaced by one sensor period and the newest one was
+* produced within the last period before the fill level was read (tRef).
+*
+* The clock extrapolates the frame times from the previous batch and pulls the newest one towards the middle
+* of that window: the phase follows with a first order loop and the period estimate follows the drift of the
+* sensor oscillator against micros() (about 1 % on the BMI088). The time stamps are continuous from batch
+* to batch, the error is bounded by one sensor period.
+*/
+
+#pragma once
+
+#ifndef FIFO_CLOCK_H
+#define FIFO_CLOCK_H
+
+#include <Arduino.h>
+
+#define FIFO_CLOCK_PHASE_GAIN 0.2f      // Share of the phase error corrected per batch
+#define FIFO_CLOCK_PERIOD_GAIN 0.01f    // Share of the per frame error added to the period estimate
+
+class FifoClock {
+public:
+  void reset(float nominalPeriodUs) {
+    nominal = nominalPeriodUs;
+    period = nominalPeriodUs;
+    valid = false;
+  }
+
+  float periodUs() const { return period; }
+
+  // Time stamps of the n oldest (read) of the available frames that were in the FIFO at tRef [us]
+  // The frames that were not read follow in the next batch
+  void stamp(uint8_t n, uint8_t available, unsigned long tRef, unsigned long* times) {
+    if (n == 0) {
+      return;
+    }
+
+    // Predicted time of the newest frame in the FIFO relative to tRef, it belongs to (-period, 0]
+    float newest = -0.5f * period;
+    if (valid) {
+      newest = (long)(tLast - tRef) + frac + available * period;
+      float error = -0.5f * period - newest;
+      if (error > 0.5f * period || error < -0.5f * period) {
+        newest += error;     // Outside of the window (e.g. after an overrun), restart from the window centre
+      }
+      else {
+        newest += FIFO_CLOCK_PHASE_GAIN * error;
+        period = constrain(period + FIFO_CLOCK_PERIOD_GAIN * error / available, 0.95f * nominal, 1.05f * nominal);
+      }
+    }
+
+    for (uint8_t i = 0; i < n; i++) {
+      times[i] = tRef + (long)lroundf(newest - (available - 1 - i) * period);
+    }
+
+    float last = newest - (available - n) * period;
+    long whole = (long)floorf(last);
+    tLast = tRef + whole;
+    frac = last - whole;
+    valid = true;
+  }
+
+private:
+  float nominal = 0.0f;
+  float period = 0.0f;
+  unsigned long tLast = 0;   // Newest frame [us], integer part
+  float frac = 0.0f;         // and fraction
+  bool valid = false;
+};
+
+#endif
@@ -0,0 +1,212 @@
+// ==================================
+// ===== Flight log (Header) ========
+// ==================================
+
+/*
+* Binary flight log on the SD card
+* The log has three channels:
+*   - control: the PacketData of every control step (CONTROLLER_FREQUENCY), stored as float32 records
+*   - imu:     every filtered BMI088 sample (raw acc/gyro) with the Madgwick quaternion after it, at the sample
+*              rate (2 kHz). The fields are quantized and stored as per field deltas to the previous record,
+*              zig-zag varint encoded (about 1-2 bytes per field instead of 4). acc/gyro are quantized to one
+*              LSB of the BMI088 ranges, i.e. stored as the raw sensor counts, which decode bit-exactly
+*   - replay:  the inputs of every control step that are not in the imu channel (FlightLogReplayStep: time,
+*              samples filtered so far, lidar distance), delta varint encoded as well
+* Together with the estimator and controller state at the start of the flight (a state chunk) the imu and
+* replay channels are everything the host log replay needs to recompute the control channel
+* (host/HostLog/LogReplay.h).
+* Each channel fills its own 512 byte chunk in RAM. A full chunk is copied into a statically allocated ring
+* (no String formatting and no heap), a background task drains the ring one chunk per run into a file that
+* stays open for the whole flight, so no single loop iteration pays for more than one sector write. The
+* header is two sectors, every chunk lands on a sector boundary of the file. Only the end of the flight
+* writes the last partial chunks and closes the file.
+*
+* With FLIGHT_LOG_PREALLOCATE the file is allocated as one contiguous cluster chain for the whole flight
+* (TIME_LIMIT at the full SD writer rate) and its sectors are erased at boot. The chunk writes then go to
+* known sectors without FAT lookups or allocations and without erase cycles in the card, which is what
+* bounds the write latency to SD_WRITE_WCET. A chunk is skipped while the card is still busy with the
+* previous one, so a write never waits for the card. The file is cut to the written length when it is
+* closed; after a power loss it keeps its preallocated size and the unwritten chunks read as erased
+* (zero or 0xFF) bytes. The write times are in the STAGE_SD histogram of the loop statistics.
+*
+* File format (little endian):
+*   - FlightLogHeader, FLIGHT_LOG_HEADER_SIZE bytes: magic, format version, chunk size and one descriptor per
+*     channel (encoding, record size, field count, record rate, field scales, comma separated field names).
+*   - Chunks of FLIGHT_LOG_CHUNK_SIZE bytes from headerSize on: FlightLogChunkHeader (channel, record count,
+*     used payload bytes, sequence number) and the payload
+*       - float32 channels: records back to back, recordSize bytes each (the time stamp field is a uint32 in
+*         FLIGHT_LOG_ENCODING_TIME_FLOAT32 channels)
+*       - delta varint channels: per record one varint per field, value = previous + delta, in steps of the
+*         field scale. The previous values are zero at the start of every chunk (the first record is
+*         absolute), so every chunk decodes on its own
+*       - index chunks (FLIGHT_LOG_CHUNK_INDEX): FlightLogIndexEntry records, the time stamp of the first record
+*         and the chunk number of every FLIGHT_LOG_INDEX_INTERVAL-th chunk of each channel
+*       - state chunks (FLIGHT_LOG_CHUNK_STATE): one opaque record (the ReplayState of Replay.h at t0)
+*   - The footer (FLIGHT_LOG_CHUNK_FOOTER) as the last chunk of a closed log: the chunk numbers of all index
+*     chunks. A reader reads the last chunk, loads the index and binary searches it for a time stamp instead of
+*     scanning the log from the start (logs without a footer, e.g. after a power loss, are scanned)
+* All time stamps are uint32 [us] since the start of the flight, except the float32 timeStamp field of the
+* control channel (the telemetry PacketData, exact to the us for the first 16.7 s). Chunk n is at headerSize + n * chunkSize.
+* A chunk sequence gap means chunks were dropped (ring full). A reader checks magic and version and takes the
+* record layouts from the header, so fields can be added to the end of a channel without breaking old logs
+* (bump FLIGHT_LOG_VERSION when the meaning changes).
+* Black box dumps (BlackBox.h) use the same format with one FLIGHT_LOG_ENCODING_TIME_FLOAT32 channel (id
+* FLIGHT_LOG_CHANNEL_BLACK_BOX).
+*/
+
+#pragma once
+
+#ifndef FLIGHT_LOG_H
+#define FLIGHT_LOG_H
+
+#include <Arduino.h>
+#include <settings.h>
+#include "GlobalDecRocket.h"
+
+#define FLIGHT_LOG_MAGIC 0x474C4B52      // "RKLG"
+#define FLIGHT_LOG_VERSION 1
+#define FLIGHT_LOG_FOOTER_MAGIC 0x58494B52   // "RKIX"
+#define FLIGHT_LOG_HEADER_SIZE 1024     // Two sectors
+#define FLIGHT_LOG_CHUNK_SIZE 512        // SD sector
+#define FLIGHT_LOG_MAX_FIELDS 16
+
+// Channels
+#define FLIGHT_LOG_CHANNEL_CONTROL 0
+#define FLIGHT_LOG_CHANNEL_IMU 1
+#define FLIGHT_LOG_CHANNEL_REPLAY 2
+#define FLIGHT_LOG_CHANNELS 3
+
+// Channel id of black box dumps (BlackBox.h), files of their own with this single channel
+#define FLIGHT_LOG_CHANNEL_BLACK_BOX 3
+
+// Chunks that are not channel data
+#define FLIGHT_LOG_CHUNK_INDEX 0xFE
+#define FLIGHT_LOG_CHUNK_FOOTER 0xFD
+#define FLIGHT_LOG_CHUNK_STATE 0xFC
+
+#define FLIGHT_LOG_INDEX_INTERVAL 8      // Chunks of a channel per index entry
+
+// Record encodings
+#define FLIGHT_LOG_ENCODING_FLOAT32 0
+#define FLIGHT_LOG_ENCODING_DELTA_VARINT 1
+#define FLIGHT_LOG_ENCODING_TIME_FLOAT32 2     // uint32 time stamp followed by float32 fields
+
+// Preallocated file: header, the chunks the SD writer can write in TIME_LIMIT and the ring as margin
+#define FLIGHT_LOG_FILE_SIZE (FLIGHT_LOG_HEADER_SIZE + (uint64_t)TIME_LIMIT * SD_WRITE_FREQUENCY / 1000 * FLIGHT_LOG_CHUNK_SIZE \
+                              + FLIGHT_LOG_RING_SIZE)
+
+static_assert(FLIGHT_LOG_RING_SIZE % FLIGHT_LOG_CHUNK_SIZE == 0, "FLIGHT_LOG_RING_SIZE must be a multiple of 512");
+
+struct FlightLogChannelInfo {
+  uint8_t id;
+  uint8_t encoding;
+  uint16_t fieldCount;
+  uint16_t recordSize;      // Fixed size (float32) channels, 0 for variable length records
+  uint16_t reserved;
+  uint32_t recordRate;      // Nominal records per second
+  float scales[FLIGHT_LOG_MAX_FIELDS];   // Step of one count (delta varint channels)
+  char fields[172];         // Field names, comma separated and zero padded
+};
+
+struct FlightLogHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t headerSize;      // Offset of the first chunk
+  uint16_t chunkSize;
+  uint16_t channelCount;
+  uint32_t reserved;
+  FlightLogChannelInfo channels[FLIGHT_LOG_CHANNELS];
+  uint8_t padding[FLIGHT_LOG_HEADER_SIZE - 16 - FLIGHT_LOG_CHANNELS * 248];
+};
+
+struct FlightLogChunkHeader {
+  uint8_t channel;
+  uint8_t records;
+  uint16_t length;          // Used payload bytes
+  uint32_t sequence;        // Number of the chunk in the file
+};
+
+#define FLIGHT_LOG_PAYLOAD_SIZE (FLIGHT_LOG_CHUNK_SIZE - sizeof(FlightLogChunkHeader))
+
+struct FlightLogIndexEntry {
+  uint32_t timeStamp;       // First record of the chunk [us]
+  uint32_t chunk;           // Chunk number in the file
+  uint8_t channel;
+  uint8_t reserved[3];
+};
+
+#define FLIGHT_LOG_INDEX_ENTRIES (FLIGHT_LOG_PAYLOAD_SIZE / sizeof(FlightLogIndexEntry))
+#define FLIGHT_LOG_FOOTER_MAX_INDEX ((FLIGHT_LOG_PAYLOAD_SIZE - 12) / sizeof(uint32_t))
+
+struct FlightLogFooter {
+  uint32_t magic;
+  uint32_t chunkCount;      // Chunks before the footer
+  uint16_t indexCount;      // Index chunks listed (the oldest if there were more)
+  uint16_t reserved;
+  uint32_t indexChunks[FLIGHT_LOG_FOOTER_MAX_INDEX];
+};
+
+static_assert(sizeof(FlightLogFooter) <= FLIGHT_LOG_PAYLOAD_SIZE, "FlightLogFooter must fit into a chunk");
+
+static_assert(sizeof(FlightLogChannelInfo) == 248, "FlightLogChannelInfo must be 248 bytes");
+static_assert(sizeof(FlightLogHeader) == FLIGHT_LOG_HEADER_SIZE, "FlightLogHeader must be FLIGHT_LOG_HEADER_SIZE bytes");
+static_assert(sizeof(PacketData) % sizeof(float) == 0, "PacketData records are float32 fields only");
+
+// Sample of the imu channel
+struct FlightLogImuSample {
+  uint32_t timeStamp;       // [us] since the start of the flight
+  float acc[3];             // [mg]
+  float gyro[3];            // [dps]
+  float q[4];               // Madgwick quaternion after the sample
+  uint8_t newAcc;           // acc is a new accelerometer sample (otherwise it repeats the last one)
+};
+
+// Record of the replay channel, one per control step
+struct FlightLogReplayStep {
+  uint32_t timeStamp;       // [us] since the start of the flight, the time stamp of the control record
+  uint32_t imuSamples;      // Samples filtered since the start of the flight
+  uint32_t lidarSamples;    // Lidar distances processed since the start of the flight
+  int16_t lidarZ;           // The latest one [cm]
+};
+
+struct FlightLogStats {
+  uint32_t records;         // Appended control records
+  uint32_t imuRecords;      // Appended imu samples
+  uint32_t imuBytes;        // Encoded size of the imu samples
+  uint32_t replayRecords;
+  uint32_t droppedChunks;   // Ring full (the SD writer fell behind)
+  uint32_t indexEntries;
+  uint32_t chunks;          // Written by flightLogService
+  uint32_t busySkips;       // Service calls that found the card busy
+  uint32_t writeErrors;
+  uint32_t maxWriteUs;      // Longest chunk write
+  uint32_t maxPending;      // Ring high-water mark [bytes]
+  uint32_t preallocated;    // Size of the preallocated file [bytes], 0 if not preallocated
+};
+extern FlightLogStats flightLogStats;
+
+// Create (and preallocate) the log file and write the header (the file is kept open until flightLogClose)
+// accScale/gyroScale are the BMI088 LSBs [mg] / [dps], the quantization steps of the imu channel
+bool flightLogOpen(const char* filename, float accScale, float gyroScale);
+
+// Append a control record, only copies into the channel chunk (a full chunk is dropped and counted when
+// the ring is full)
+void flightLogAppend(const PacketData& data);
+
+// Append an imu sample (encoded into the channel chunk)
+void flightLogAppendImu(const FlightLogImuSample& sample);
+
+// Append the replay inputs of a control step (encoded into the channel chunk)
+void flightLogAppendReplay(const FlightLogReplayStep& step);
+
+// Queue a state chunk with size bytes of data (at most FLIGHT_LOG_PAYLOAD_SIZE)
+bool flightLogAppendState(const void* data, uint16_t size);
+
+// Write one chunk when one is pending (background task). Returns true if a chunk was written
+bool flightLogService();
+
+// Write everything that is pending, including the last partial chunks, the index and the footer, cut the file
+// there and close it
+void flightLogClose();
+
+#endif
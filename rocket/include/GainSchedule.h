@@ -0,0 +1,63 @@
+// ==================================
+// ===== Gain schedule (Header) =====
+// ==================================
+
+/*
+* Gain schedules of the LQR: tables of K matrices tuned at different operating points
+* A schedule lists gain sets at increasing values of one scheduling variable, the altitude reference or the
+* feedforward thrust of the trajectory (which separates the accelerating takeoff, the hover and the
+* decelerating landing). Every control step the gains are interpolated linearly between the two neighbouring
+* sets and held at the first or the last set outside the table, so one table covers a whole flight.
+* Both variables come from the trajectory, not from the estimate, so sensor noise does not move the gains.
+* The interval of the last step is kept between the calls and the inverse spans are computed when a schedule is
+* selected: a step costs a short search and 24 multiply-adds.
+*/
+
+#pragma once
+
+#ifndef GAIN_SCHEDULE_H
+#define GAIN_SCHEDULE_H
+
+#include <Arduino.h>
+#include <settings.h>
+
+// Gain schedules
+#define GAINS_HOVER 0               // The hover gains for the whole flight
+#define GAINS_ALTITUDE 1            // Stiffer attitude gains close to the ground, the hover gains from 0.3 m
+#define GAINS_THRUST 2              // Softer altitude gains while decelerating, stiffer while accelerating
+#define GAIN_SCHEDULE_COUNT 3
+
+// Scheduling variables
+#define GAIN_SCHEDULE_ALTITUDE 0    // Altitude reference [m]
+#define GAIN_SCHEDULE_THRUST 1      // Feedforward thrust of the trajectory, mass * (g + zDDot) [N]
+
+#define GAIN_SCHEDULE_MAX_POINTS 4
+
+// Gains at one operating point, inputs (thrust, gimbal 1, gimbal 2) x states (xDot, gamma1, gamma1Dot, yDot,
+// gamma2, gamma2Dot, z, zDot)
+struct GainPoint {
+  float at;                 // Value of the scheduling variable
+  float k[3][8];
+};
+
+struct GainSchedule {
+  const char* name;
+  uint8_t variable;         // GAIN_SCHEDULE_ALTITUDE or GAIN_SCHEDULE_THRUST
+  uint8_t pointCount;
+  GainPoint points[GAIN_SCHEDULE_MAX_POINTS];   // Increasing at
+};
+
+extern const GainSchedule gainSchedules[GAIN_SCHEDULE_COUNT];
+
+// Select a schedule (GAINS_...) and load its first gains into k. Returns false for an unknown schedule (the
+// previous one is kept)
+bool gainScheduleSelect(uint8_t schedule, float k[3][8]);
+
+// Interpolate the gains of the selected schedule at the altitude reference z [m] and the feedforward
+// thrust [N] into k. Does nothing for a schedule with a single point
+void gainScheduleEval(float z, float thrust, float k[3][8]);
+
+// The selected schedule
+const GainSchedule& gainScheduleActive();
+
+#endif
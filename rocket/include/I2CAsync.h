@@ -0,0 +1,86 @@
+// ==================================
+// ===== Async I2C (Header) =========
+// ==================================
+
+/*
+* Non-blocking I2C transactions for the sensor drivers
+* A driver fills an I2CTransaction (register/command bytes to write, buffer to read into), submits it and
+* collects the result later. The transactions are queued and executed back to back by the bus engine:
+*   - Teensy: LPI2C1 (the Wire pins) driven from its interrupt, the CPU only feeds the command FIFO
+*   - Host:   the simulated devices on Wire, completing after the bus time of the transfer (HostClock events)
+* The done callback runs in the completion context (interrupt), it must be short and must not use Wire. It may
+* submit follow-up transactions, e.g. a read whose length depends on the result of this one.
+*
+* While transactions are pending the blocking Wire functions must not be used. i2cAsyncWaitIdle() hands the
+* bus back, e.g. before blocking setup code.
+*
+* A transaction that has not completed I2C_ASYNC_TIMEOUT after its start (a slave holding SDA low, a lost STOP)
+* is ended by i2cAsyncWatchdog(), which the tasks call regularly: the bus engine is reset, the bus is clocked
+* free, the transaction fails with I2C_ERROR and the queue goes on with the next one. On the Teensy the LPI2C
+* pin low timeout reports a stuck line before the deadline.
+*/
+
+#pragma once
+
+#ifndef I2C_ASYNC_H
+#define I2C_ASYNC_H
+
+#include <Arduino.h>
+
+#define I2C_ASYNC_MAX_TX 8          // Bytes written before the read (register address, command)
+#define I2C_ASYNC_QUEUE_SIZE 8      // Power of two
+#define I2C_ASYNC_TIMEOUT 5000      // [us] Deadline of a transaction from its start (a 16 frame FIFO batch read takes ~2.6 ms at 400 kHz)
+
+enum I2CStatus : uint8_t {
+  I2C_IDLE = 0,     // Never submitted
+  I2C_QUEUED,
+  I2C_ACTIVE,
+  I2C_DONE,
+  I2C_ERROR         // NACK, arbitration lost, timeout or queue full
+};
+
+struct I2CTransaction;
+typedef void (*I2CCallback)(I2CTransaction* transaction);
+
+struct I2CTransaction {
+  uint8_t address;
+  uint8_t tx[I2C_ASYNC_MAX_TX];
+  uint8_t txLen;
+  uint8_t* rx;
+  uint8_t rxLen;
+  bool stopBeforeRead;          // STOP + START between write and read instead of a repeated START
+  I2CCallback done;             // Optional, called on completion (success or error)
+  void* context;                // Free for the owner of the transaction
+  volatile I2CStatus status;
+
+  bool pending() const { return status == I2C_QUEUED || status == I2C_ACTIVE; }
+};
+
+// Register read: write reg, repeated START, read len bytes into buf
+void i2cPrepareRead(I2CTransaction& transaction, uint8_t address, uint8_t reg, uint8_t* buf, uint8_t len,
+                    I2CCallback done = nullptr, void* context = nullptr);
+
+// Take over the Wire bus for async transactions (after Wire.begin() / Wire.setClock())
+void i2cAsyncInit();
+
+// Queue a transaction. Returns false if it is still pending (left as is) or the queue is full (status I2C_ERROR)
+bool i2cSubmit(I2CTransaction& transaction);
+
+// Wait until all submitted transactions have completed or failed (at most I2C_ASYNC_TIMEOUT per transaction)
+void i2cAsyncWaitIdle();
+
+// End the active transaction if it is past its deadline or the bus is stuck: reset the bus, fail the transaction
+// and start the next one. Returns true if it did. Call it regularly from the tasks
+bool i2cAsyncWatchdog();
+
+// ============ Statistics ==============
+struct I2CAsyncStats {
+  uint32_t completed;
+  uint32_t errors;
+  uint32_t queueFull;
+  uint32_t timeouts;            // Transactions ended by the watchdog (counted in errors as well)
+  uint8_t maxQueued;
+};
+extern I2CAsyncStats i2cAsyncStats;
+
+#endif
@@ -20,13 +20,47 @@
 #include <Arduino.h>
 #include <BMI088.h>
 #include <settings.h>
+#include <Clock.h>
+#include <SpscRing.h>
+#include <ImuDataReady.h>
+#include <I2CAsync.h>
+#include <FifoClock.h>
 #include <math.h>
 #include <cstring> // for std::memcpy
 
+// Gyroscope data-ready events per sample (IMU_DATA_READY reads the latest sample at IMU_SAMPLE_FREQUENCY)
+#define IMU_READY_DIVIDER (GYRO_ODR / IMU_SAMPLE_FREQUENCY)
+
 // =============================================================================================
 //  IMU class
 // =============================================================================================
 
+// Raw IMU sample with the time of its data-ready interrupt (calibration and LP filter are applied when filtered)
+struct ImuSample {
+  unsigned long timeStamp;   // [us]
+  float acc[3];              // [mg]
+  float gyro[3];             // [dps]
+  bool newAcc;               // acc holds a new accelerometer sample
+};
+
+// Called after the filter step of every drained sample (e.g. to log it with the new quaternion)
+typedef void (*ImuSampleHook)(const ImuSample& sample);
+
+// Calibration and filter state, everything the filter step of a sample depends on (saved at the start of a
+// logged flight, restored by the log replay)
+struct ImuFilterState {
+  float acc[3];              // Filtered accelerometer [mg] and its previous value (LP filter)
+  float accPrev[3];
+  float gyro[3];             // Filtered gyroscope [dps] and its previous value
+  float gyroPrev[3];
+  float accError[3];         // Calibration
+  float gyroError[3];
+  float q[4];                // Madgwick quaternion
+  float angles[3];           // roll, pitch, yaw [deg]
+  float dt;                  // [s]
+  uint32_t prevSampleTime;   // [us], 0 before the first sample
+};
+
 // Class declaration for BMI088 (6DOF) IMU (including madgwick and LP filtering)
 class Imu6DOF {
 public:
@@ -34,6 +68,11 @@ public:
   // ============ Constructor ==============
   Imu6DOF() : bmi088(BMI088_ACC_ADDRESS, BMI088_GYRO_ADDRESS) {}
 
+  // The benchmarks time the private filter and sampling functions directly
+  #ifdef BENCHMARK
+    friend void runBenchmarks();
+  #endif
+
   // ============ Public attributes ==============
   // Create BMI088 object
   BMI088 bmi088;
@@ -48,8 +87,13 @@ public:
   unsigned long start_time, current_time;
 
   float B_madgwick = B_MADGWCIK;  // Madgwick filter parameter
-  float B_accel = B_ACCEL;     // Accelerometer LP filter paramter
-  float B_gyro = B_GYRO;       // Gyro LP filter paramter, (MPU6050 default: 0.1. MPU9250 default: 0.17)
+  #ifdef IMU_FIFO
+    float B_accel = B_ACCEL_FIFO;  // Filtered at the full output data rates
+    float B_gyro = B_GYRO_FIFO;
+  #else
+    float B_accel = B_ACCEL;     // Accelerometer LP filter paramter
+    float B_gyro = B_GYRO;       // Gyro LP filter paramter, (MPU6050 default: 0.1. MPU9250 default: 0.17)
+  #endif
 
   // IMU states (raw sensor data from the BMI088)
   float AccX, AccY, AccZ = 0;                     // Acceleration [g]
@@ -65,6 +109,18 @@ public:
   float q2 = 0.0f;
   float q3 = 0.0f;
 
+  // Data-ready sampling
+  SpscRing<ImuSample, IMU_RING_SIZE> samples;   // Read by sampleDataReady() (I2C interrupt with I2C_ASYNC), drained by madgwickDrain()
+  uint32_t samplesRead = 0;
+  uint32_t samplesMissed = 0;     // Sample periods without a read (FIFO overflows with IMU_FIFO)
+  uint32_t samplesDropped = 0;    // Ring full
+  uint32_t readErrors = 0;        // Failed async reads
+  ImuSampleHook sampleHook = nullptr;
+  bool readyPolling = false;      // The gyroscope data-ready interrupt failed, sampled on the clock instead
+
+  // Polled sampling: a sample was read since the last filter step
+  bool newSample = false;
+
   // ============ Public methods ==============
   // void loopRate() {
   //     //DESCRIPTION: Regulate main loop rate to specified frequency in Hz
@@ -94,12 +150,9 @@ public:
       * and remain above 2kHz, without needing to retune all of our filtering parameters.
       */
       float invFreq = 1.0/freq*1000000.0;
-      unsigned long checker = micros();
 
-      //Sit in loop until appropriate time has passed
-      while (invFreq >= (checker - prev_time)) {
-          checker = micros();
-      }
+      //Sit in loop until appropriate time has passed (more than invFreq since prev_time)
+      waitUntilMicros(prev_time + (unsigned long)invFreq + 1);
   }
 
   // void timeUpdate() {
@@ -116,14 +169,71 @@ public:
     #endif
    
     init_BMI088();
+
+    #if defined(IMU_FIFO)
+      // The gyroscope watermark starts a batch, the accelerometer FIFO is read along with it
+      bmi088.setAccOutputDataRate(ACC_FIFO_RATE_SETTING);
+      bmi088.setGyroOutputDataRate(GYRO_FIFO_RATE_SETTING);
+      bmi088.setAccFifo(true);
+      bmi088.setGyroFifo(true, IMU_FIFO_WATERMARK);
+      bmi088.setGyroFifoWatermarkInt3(true);
+      imuDataReadyInit(IMU_ACC_INT_PIN, IMU_GYRO_INT_PIN);
+      checkDataReady(0, 1);           // The watermark fires once until the FIFO is read
+    #elif defined(IMU_DATA_READY)
+      bmi088.setAccDataReadyInt1(true);
+      bmi088.setGyroDataReadyInt3(true);
+      imuDataReadyInit(IMU_ACC_INT_PIN, IMU_GYRO_INT_PIN);
+      checkDataReady(IMU_READY_CHECK_EDGES, IMU_READY_CHECK_EDGES);
+    #endif
+
     delay(500);
 
     start_time = millis();      // <<<<<<<<<<<<<<<------------------------------- To do: Unused variable, fix!!!!!
   }
 
+  // Wait for the given number of edges on the two lines, sample on the clock if the gyroscope line stays silent
+  // for IMU_READY_TIMEOUT (a silent accelerometer line is read with every sample). Returns false on a missing line
+  bool checkDataReady(uint32_t accEdges, uint32_t gyroEdges) {
+    uint32_t acc0 = imuAccReady.count;
+    uint32_t gyro0 = imuGyroReady.count;
+    uint32_t accSeen = acc0;
+    uint32_t gyroSeen = gyro0;
+    unsigned long tAcc = millis();      // Last edge of each line [ms]
+    unsigned long tGyro = tAcc;
+    bool accOk, gyroOk;
+    while (true) {
+      unsigned long now = millis();
+      if (imuAccReady.count != accSeen) {
+        accSeen = imuAccReady.count;
+        tAcc = now;
+      }
+      if (imuGyroReady.count != gyroSeen) {
+        gyroSeen = imuGyroReady.count;
+        tGyro = now;
+      }
+      accOk = accSeen - acc0 >= accEdges;
+      gyroOk = gyroSeen - gyro0 >= gyroEdges;
+      if ((accOk || now - tAcc > IMU_READY_TIMEOUT) && (gyroOk || now - tGyro > IMU_READY_TIMEOUT)) {
+        break;
+      }
+    }
+    readyPolling = !gyroOk;
+
+    #ifdef DEBUG
+      if (!gyroOk) {
+        Serial.print("No BMI088 gyroscope data-ready interrupts (INT3), sampling on the clock\n");
+      }
+      if (!accOk) {
+        Serial.print("No BMI088 accelerometer data-ready interrupts (INT1), read with every sample\n");
+      }
+    #endif
+    return accOk && gyroOk;
+  }
+
   // Sample IMU data
   void sample() {
     getIMUdata_BMI088();
+    newSample = true;
   }
 
   void madgwickDeltaCalc() {
@@ -140,6 +250,200 @@ public:
     prev_time = current_time;
   }
 
+  // Read the BMI088 if its gyroscope has signaled a new sample since the last read (no I2C traffic otherwise)
+  // The accelerometer is only read when it has new data as well. Returns true if a read was started
+  // With I2C_ASYNC the reads are only submitted, the sample is queued by the I2C completion interrupt
+  bool sampleDataReady() {
+    #ifdef IMU_FIFO
+      return sampleFifo();
+    #endif
+
+    #ifdef I2C_ASYNC
+      // The previous read is still on the bus
+      if (gyroRead.pending() || accRead.pending()) {
+        return false;
+      }
+    #endif
+
+    uint32_t count;
+    unsigned long tReady;
+    bool newAcc = true;
+    if (readyPolling) {
+      if (!pollDue(1000000 / IMU_SAMPLE_FREQUENCY, tReady)) {
+        return false;
+      }
+    }
+    else {
+      readDataReadyLine(imuGyroReady, count, tReady);
+      // The gyroscope runs faster than the sampling: every IMU_READY_DIVIDER-th data-ready event is read, a read
+      // is missed when a whole sample period went by without one
+      if (count - gyroReadyCount < IMU_READY_DIVIDER) {
+        readyWatchdog(tReady);
+        return false;
+      }
+      uint32_t periods = (count - gyroReadyCount) / IMU_READY_DIVIDER;
+      samplesMissed += periods > 1 ? periods - 1 : 0;
+      gyroReadyCount = count;
+
+      // A silent accelerometer line is read with every sample
+      uint32_t accCount;
+      unsigned long tAcc;
+      readDataReadyLine(imuAccReady, accCount, tAcc);
+      newAcc = accCount != accReadyCount || (long)(tReady - tAcc) > IMU_READY_TIMEOUT * 1000L;
+      accReadyCount = accCount;
+    }
+
+    #ifdef I2C_ASYNC
+      pendingSample.timeStamp = tReady;
+      pendingSample.newAcc = newAcc;
+      if (newAcc) {
+        i2cPrepareRead(accRead, bmi088.accAddress(), BMI088_ACC_X_LSB, accBuffer, 6);
+        i2cSubmit(accRead);
+      }
+      i2cPrepareRead(gyroRead, bmi088.gyroAddress(), BMI088_GYRO_RATE_X_LSB, gyroBuffer, 6, gyroReadDone, this);
+      i2cSubmit(gyroRead);
+
+      // Temperature behind the sample, at its own low rate
+      if (tempRead.status == I2C_DONE) {
+        temp = bmi088.convertTemperature(tempBuffer);
+      }
+      if (temperatureDue()) {
+        i2cPrepareRead(tempRead, bmi088.accAddress(), BMI088_ACC_TEMP_MSB, tempBuffer, 2);
+        i2cSubmit(tempRead);
+      }
+    #else
+      ImuSample sample;
+      sample.timeStamp = tReady;
+      sample.newAcc = newAcc;
+      if (newAcc) {
+        bmi088.getSample(sample.acc, sample.gyro);
+      }
+      else {
+        bmi088.getGyroscope(&sample.gyro[0], &sample.gyro[1], &sample.gyro[2]);
+      }
+      queueSample(sample);
+      sampleTemperature();
+    #endif
+    return true;
+  }
+
+  // One Madgwick iteration per queued sample, dt is the time between the data-ready interrupts
+  // Returns the number of samples that were filtered
+  uint8_t madgwickDrain() {
+    ImuSample sample;
+    uint8_t n = 0;
+    while (samples.pop(sample)) {
+      filterSample(sample);
+      if (sampleHook) {
+        sampleHook(sample);
+      }
+      n++;
+    }
+    return n;
+  }
+
+  // Calibration, LP filter and Madgwick iteration of one sample (the log replay feeds the logged samples here)
+  void filterSample(const ImuSample& sample) {
+    if (sample.newAcc) {
+      AccX = sample.acc[0];
+      AccY = sample.acc[1];
+      AccZ = sample.acc[2];
+      filterAcc();
+    }
+    GyroX = sample.gyro[0];
+    GyroY = sample.gyro[1];
+    GyroZ = sample.gyro[2];
+    filterGyro();
+
+    dt = prevSampleTime != 0 ? (sample.timeStamp - prevSampleTime) / 1000000.0f : 1.0f / IMU_SAMPLE_FREQUENCY;
+    prevSampleTime = sample.timeStamp;
+    Madgwick6DOF(GyroX, -GyroY, -GyroZ, -AccX, AccY, AccZ, dt);
+  }
+
+  void saveState(ImuFilterState& state) {
+    state.acc[0] = AccX;
+    state.acc[1] = AccY;
+    state.acc[2] = AccZ;
+    state.accPrev[0] = AccX_prev;
+    state.accPrev[1] = AccY_prev;
+    state.accPrev[2] = AccZ_prev;
+    state.gyro[0] = GyroX;
+    state.gyro[1] = GyroY;
+    state.gyro[2] = GyroZ;
+    state.gyroPrev[0] = GyroX_prev;
+    state.gyroPrev[1] = GyroY_prev;
+    state.gyroPrev[2] = GyroZ_prev;
+    state.accError[0] = AccErrorX;
+    state.accError[1] = AccErrorY;
+    state.accError[2] = AccErrorZ;
+    state.gyroError[0] = GyroErrorX;
+    state.gyroError[1] = GyroErrorY;
+    state.gyroError[2] = GyroErrorZ;
+    state.q[0] = q0;
+    state.q[1] = q1;
+    state.q[2] = q2;
+    state.q[3] = q3;
+    state.angles[0] = roll_IMU;
+    state.angles[1] = pitch_IMU;
+    state.angles[2] = yaw_IMU;
+    state.dt = dt;
+    state.prevSampleTime = prevSampleTime;
+  }
+
+  void restoreState(const ImuFilterState& state) {
+    AccX = state.acc[0];
+    AccY = state.acc[1];
+    AccZ = state.acc[2];
+    AccX_prev = state.accPrev[0];
+    AccY_prev = state.accPrev[1];
+    AccZ_prev = state.accPrev[2];
+    GyroX = state.gyro[0];
+    GyroY = state.gyro[1];
+    GyroZ = state.gyro[2];
+    GyroX_prev = state.gyroPrev[0];
+    GyroY_prev = state.gyroPrev[1];
+    GyroZ_prev = state.gyroPrev[2];
+    AccErrorX = state.accError[0];
+    AccErrorY = state.accError[1];
+    AccErrorZ = state.accError[2];
+    GyroErrorX = state.gyroError[0];
+    GyroErrorY = state.gyroError[1];
+    GyroErrorZ = state.gyroError[2];
+    q0 = state.q[0];
+    q1 = state.q[1];
+    q2 = state.q[2];
+    q3 = state.q[3];
+    roll_IMU = state.angles[0];
+    pitch_IMU = state.angles[1];
+    yaw_IMU = state.angles[2];
+    dt = state.dt;
+    prevSampleTime = state.prevSampleTime;
+  }
+
+  // Forget data-ready events and queued samples from before this call (e.g. at the start of the flight)
+  void resetSamples() {
+    #ifdef I2C_ASYNC
+      i2cAsyncWaitIdle();
+    #endif
+
+    unsigned long t;
+    readDataReadyLine(imuGyroReady, gyroReadyCount, t);
+    readDataReadyLine(imuAccReady, accReadyCount, t);
+    samples.clear();
+    prevSampleTime = 0;
+    resetTime = micros();
+
+    #ifdef IMU_FIFO
+      // Reconfiguring clears the FIFOs
+      bmi088.setAccFifo(true);
+      bmi088.setGyroFifo(true, IMU_FIFO_WATERMARK);
+      accClock.reset(1000000.0f / ACC_FIFO_ODR);
+      gyroClock.reset(1000000.0f / GYRO_FIFO_ODR);
+      accFrameCount = 0;
+      fifoBacklog = false;
+    #endif
+  }
+
   // Madgwick filter iteration
   void madgwickStep() {
     // Regulate madgwick freqcuency
@@ -147,13 +451,24 @@ public:
       loopRate_V2();
     #endif
 
+    madgwickUpdate();
+  }
+
+  // Madgwick filter iteration without rate regulation (used by the task scheduler, which keeps the rate)
+  void madgwickUpdate() {
     #ifdef MADGWICK_DELTA
       madgwickDeltaCalc();
+    #else
+      // dt is the time between IMU samples, so every sample is integrated by one filter step (the filter runs
+      // faster than the sampling)
+      if (!newSample) {
+        return;
+      }
+      newSample = false;
     #endif
 
     // Estimate states with madgwick filter
     Madgwick6DOF(GyroX, -GyroY, -GyroZ, -AccX, AccY, AccZ, dt); //Updates roll_IMU, pitch_IMU, and yaw_IMU angle estimates (degrees)
-
   }
 
 void getAttitude(float* roll, float* pitch, float* yaw) {
@@ -179,21 +494,26 @@ void filterWarmup(unsigned long &t0IMU, unsigned long &t1IMU, float imuSampleInv
       Serial.print("\n \n Warming up madgwick filter \n ------------------------ \n");
     #endif
 
-    t0IMU = micros();
-    t1IMU = micros() + imuSampleInv;
-    unsigned long tRef = millis();
+    // The filter steps on its own period (prev_time and dt advance every step, so the rate gate really waits),
+    // a new sample is read every imuSampleInv
+    const unsigned long period = 1000000 / MADGWICK_FREQUENCY;
+    const unsigned long tRef = micros();
+    unsigned long tStep = tRef;
+    t0IMU = tRef;
+    t1IMU = tRef + (unsigned long)imuSampleInv;
 
-    while (millis() - tRef < WARMUP_TIME) {
-      if (t1IMU - t0IMU >= imuSampleInv) {
+    while (tStep - tRef < (unsigned long)WARMUP_TIME * 1000) {
+      if ((long)(tStep - t1IMU) >= 0) {
         getIMUdata_BMI088();
-
-        t0IMU = micros();
-        t1IMU = micros();
-      }
-      else {
-        t1IMU = micros();
+        t0IMU = tStep;
+        t1IMU = tStep + (unsigned long)imuSampleInv;
       }
-      madgwickStep();
+      dt = period / 1000000.0f;
+      Madgwick6DOF(GyroX, -GyroY, -GyroZ, -AccX, AccY, AccZ, dt);
+
+      prev_time = tStep;
+      tStep += period;
+      waitUntilMicros(tStep);
     }
   }
 
@@ -208,6 +528,296 @@ private:
   float GyroErrorY= 0.0;
   float GyroErrorZ = 0.0;
 
+  // Data-ready counts of the last read and time stamp of the last filtered sample
+  uint32_t gyroReadyCount = 0;
+  uint32_t accReadyCount = 0;
+  unsigned long prevSampleTime = 0;
+  unsigned long pollTime = 0;       // Last sample on the clock (readyPolling) [us]
+  unsigned long resetTime = 0;      // Last resetSamples() [us]
+
+  // Last temperature read [ms]
+  unsigned long tempTime = 0;
+
+  #ifdef IMU_FIFO
+    // Batch state: the fill levels are read first, the FIFO data reads are submitted from their completions
+    I2CTransaction accLengthRead = {};
+    I2CTransaction accFifoRead = {};
+    I2CTransaction gyroStatusRead = {};
+    I2CTransaction gyroFifoRead = {};
+    uint8_t accLengthBuffer[2];
+    uint8_t gyroStatusBuffer[1];
+    uint8_t accFifoBuffer[IMU_FIFO_MAX_FRAMES * BMI088_ACC_FIFO_FRAME_SIZE];
+    uint8_t gyroFifoBuffer[IMU_FIFO_MAX_FRAMES * BMI088_GYRO_FIFO_FRAME_SIZE];
+    unsigned long accRefTime = 0;       // When the fill levels were read [us]
+    unsigned long gyroRefTime = 0;
+    uint8_t accAvailable = 0;           // Frames in the FIFO at that time
+    uint8_t gyroAvailable = 0;
+    volatile bool batchActive = false;
+    bool fifoBacklog = false;           // The last batch left a watermark worth of frames or failed (no new interrupt edge)
+    unsigned long batchTime = 0;        // Start of the last batch [us] (no edge while a backlog is read, the next one follows it)
+
+    FifoClock accClock;
+    FifoClock gyroClock;
+
+    // Accelerometer frames waiting for the gyroscope frame they belong to
+    struct AccFrame {
+      unsigned long timeStamp;
+      uint8_t raw[6];
+    };
+    AccFrame accFrames[2 * IMU_FIFO_MAX_FRAMES];
+    uint8_t accFrameCount = 0;
+  #endif
+
+  // Async reads of the data registers (the gyroscope read is submitted last and completes the sample)
+  I2CTransaction accRead = {};
+  I2CTransaction gyroRead = {};
+  uint8_t accBuffer[6];
+  uint8_t gyroBuffer[6];
+  ImuSample pendingSample;
+  I2CTransaction tempRead = {};
+  uint8_t tempBuffer[2];
+
+  void queueSample(const ImuSample& sample) {
+    samplesRead++;
+    if (!samples.push(sample)) {
+      samplesDropped++;
+    }
+  }
+
+  // No gyroscope data-ready edge (or FIFO batch) since IMU_READY_TIMEOUT (or since resetSamples): sample on the
+  // clock for the rest of the flight
+  void readyWatchdog(unsigned long tLastEdge) {
+    unsigned long now = micros();
+    if ((long)(now - tLastEdge) > IMU_READY_TIMEOUT * 1000L && (long)(now - resetTime) > IMU_READY_TIMEOUT * 1000L) {
+      readyPolling = true;
+      #ifdef DEBUG
+        Serial.print("BMI088 data-ready interrupts stopped, sampling on the clock\n");
+      #endif
+    }
+  }
+
+  // Clock sampling: true (with the time in t) when period [us] has passed since the last sample
+  bool pollDue(unsigned long period, unsigned long& t) {
+    t = micros();
+    if (t - pollTime < period) {
+      return false;
+    }
+    pollTime = t;
+    return true;
+  }
+
+  // I2C completion interrupt: convert the registers and queue the sample
+  static void gyroReadDone(I2CTransaction* transaction) {
+    Imu6DOF* self = (Imu6DOF*)transaction->context;
+    ImuSample& sample = self->pendingSample;
+    if (transaction->status != I2C_DONE) {
+      self->readErrors++;
+      return;
+    }
+    if (sample.newAcc && self->accRead.status != I2C_DONE) {
+      self->readErrors++;
+      sample.newAcc = false;
+    }
+    if (sample.newAcc) {
+      self->bmi088.convertSample(self->accBuffer, self->gyroBuffer, sample.acc, sample.gyro);
+    }
+    else {
+      self->bmi088.convertGyroscope(self->gyroBuffer, &sample.gyro[0], &sample.gyro[1], &sample.gyro[2]);
+    }
+    self->queueSample(sample);
+  }
+
+  #ifdef IMU_FIFO
+  // FIFO batch read, started by the gyroscope watermark interrupt
+  // Both FIFOs are drained, every gyroscope frame becomes a sample and takes the newest accelerometer frame
+  // that was produced before it. The frame times are reconstructed with the FifoClocks
+  bool sampleFifo() {
+    if (batchActive) {
+      return false;
+    }
+
+    uint32_t count;
+    unsigned long tReady;
+    readDataReadyLine(imuGyroReady, count, tReady);
+    if (count == gyroReadyCount && !fifoBacklog) {
+      // Without the watermark interrupt a batch is read every watermark worth of frames
+      if (!readyPolling) {
+        readyWatchdog((long)(batchTime - tReady) > 0 ? batchTime : tReady);
+        return false;
+      }
+      if (!pollDue(1000000 * IMU_FIFO_WATERMARK / GYRO_FIFO_ODR, tReady)) {
+        return false;
+      }
+    }
+    gyroReadyCount = count;
+    batchTime = micros();
+
+    #ifdef I2C_ASYNC
+      batchActive = true;
+      i2cPrepareRead(accLengthRead, bmi088.accAddress(), BMI088_ACC_FIFO_LENGTH_0, accLengthBuffer, 2, accLengthDone, this);
+      i2cPrepareRead(gyroStatusRead, bmi088.gyroAddress(), BMI088_GYRO_FIFO_STATUS, gyroStatusBuffer, 1, gyroStatusDone, this);
+      if (!i2cSubmit(accLengthRead)) {
+        readErrors++;
+      }
+      if (!i2cSubmit(gyroStatusRead)) {
+        readErrors++;
+        fifoBacklog = true;
+        batchActive = false;
+      }
+    #else
+      accRefTime = micros();
+      uint16_t length = bmi088.getAccFifoLength();
+      accAvailable = min(length / BMI088_ACC_FIFO_FRAME_SIZE, 255);
+      length = min(length, (uint16_t)60);
+      if (length > 0) {
+        bmi088.readAccFifo(accFifoBuffer, length);
+        collectAcc(length);
+      }
+
+      gyroRefTime = micros();
+      uint8_t frames = fifoFrames(bmi088.getGyroFifoStatus(), 60 / BMI088_GYRO_FIFO_FRAME_SIZE);
+      if (frames > 0) {
+        bmi088.readGyroFifo(gyroFifoBuffer, frames);
+        collectGyro(frames);
+      }
+    #endif
+    return true;
+  }
+
+  // Frames to read from the gyroscope FIFO status (at most maxFrames), flags overruns and backlogs
+  uint8_t fifoFrames(uint8_t status, uint8_t maxFrames) {
+    if (status & BMI088_GYRO_FIFO_OVERRUN) {
+      samplesMissed++;
+    }
+    gyroAvailable = status & 0x7F;
+    uint8_t frames = min(gyroAvailable, min(maxFrames, (uint8_t)IMU_FIFO_MAX_FRAMES));
+    fifoBacklog = gyroAvailable - frames >= IMU_FIFO_WATERMARK;
+    return frames;
+  }
+
+  // Time stamp the accelerometer frames of a FIFO read (len bytes in accFifoBuffer) and keep them for the gyroscope
+  void collectAcc(uint16_t len) {
+    uint8_t raw[IMU_FIFO_MAX_FRAMES * 6];
+    uint16_t lost = 0;
+    uint8_t n = bmi088.parseAccFifo(accFifoBuffer, len, raw, IMU_FIFO_MAX_FRAMES, &lost);
+    samplesMissed += lost;
+
+    unsigned long times[IMU_FIFO_MAX_FRAMES];
+    accClock.stamp(n, max(n, accAvailable), accRefTime, times);
+
+    for (uint8_t i = 0; i < n; i++) {
+      if (accFrameCount == 2 * IMU_FIFO_MAX_FRAMES) {
+        // No gyroscope frames for a while, keep the newest ones
+        memmove(&accFrames[0], &accFrames[1], (accFrameCount - 1) * sizeof(AccFrame));
+        accFrameCount--;
+      }
+      AccFrame& frame = accFrames[accFrameCount++];
+      frame.timeStamp = times[i];
+      memcpy(frame.raw, &raw[6 * i], 6);
+    }
+  }
+
+  // Convert the gyroscope frames of a FIFO read (in gyroFifoBuffer) into samples
+  void collectGyro(uint8_t frames) {
+    unsigned long times[IMU_FIFO_MAX_FRAMES];
+    gyroClock.stamp(frames, gyroAvailable, gyroRefTime, times);
+
+    // The frames that arrived during a long read (a backlog after a bus stall) can keep the fill level at the
+    // watermark, it is then not crossed again and doesn't fire
+    uint32_t arrived = (micros() - gyroRefTime) * GYRO_FIFO_ODR / 1000000;
+    fifoBacklog = fifoBacklog || gyroAvailable - frames + arrived >= IMU_FIFO_WATERMARK;
+
+    for (uint8_t i = 0; i < frames; i++) {
+      const uint8_t* gyroRaw = &gyroFifoBuffer[BMI088_GYRO_FIFO_FRAME_SIZE * i];
+      ImuSample sample;
+      sample.timeStamp = times[i];
+
+      // Newest accelerometer frame up to this gyroscope frame, older ones are superseded
+      uint8_t used = 0;
+      while (used < accFrameCount && (long)(accFrames[used].timeStamp - times[i]) <= 0) {
+        used++;
+      }
+      sample.newAcc = used > 0;
+      if (sample.newAcc) {
+        bmi088.convertSample(accFrames[used - 1].raw, gyroRaw, sample.acc, sample.gyro);
+        accFrameCount -= used;
+        memmove(&accFrames[0], &accFrames[used], accFrameCount * sizeof(AccFrame));
+      }
+      else {
+        bmi088.convertGyroscope(gyroRaw, &sample.gyro[0], &sample.gyro[1], &sample.gyro[2]);
+      }
+      queueSample(sample);
+    }
+  }
+
+  // I2C completion interrupts of a batch: fill level -> FIFO data
+  static void accLengthDone(I2CTransaction* transaction) {
+    Imu6DOF* self = (Imu6DOF*)transaction->context;
+    if (transaction->status != I2C_DONE) {
+      self->readErrors++;
+      return;
+    }
+    self->accRefTime = micros();
+    uint16_t length = (self->accLengthBuffer[0] | (self->accLengthBuffer[1] << 8)) & 0x3FFF;
+    self->accAvailable = min(length / BMI088_ACC_FIFO_FRAME_SIZE, 255);
+    length = min(length, (uint16_t)sizeof(self->accFifoBuffer));
+    if (length == 0) {
+      return;
+    }
+    i2cPrepareRead(self->accFifoRead, self->bmi088.accAddress(), BMI088_ACC_FIFO_DATA, self->accFifoBuffer, length,
+                   accFifoDone, self);
+    if (!i2cSubmit(self->accFifoRead)) {
+      self->readErrors++;
+    }
+  }
+
+  static void accFifoDone(I2CTransaction* transaction) {
+    Imu6DOF* self = (Imu6DOF*)transaction->context;
+    if (transaction->status != I2C_DONE) {
+      self->readErrors++;
+      return;
+    }
+    self->collectAcc(transaction->rxLen);
+  }
+
+  static void gyroStatusDone(I2CTransaction* transaction) {
+    Imu6DOF* self = (Imu6DOF*)transaction->context;
+    if (transaction->status != I2C_DONE) {
+      self->readErrors++;
+      self->fifoBacklog = true;
+      self->batchActive = false;
+      return;
+    }
+    self->gyroRefTime = micros();
+    uint8_t frames = self->fifoFrames(self->gyroStatusBuffer[0], IMU_FIFO_MAX_FRAMES);
+    if (frames == 0) {
+      self->batchActive = false;
+      return;
+    }
+    i2cPrepareRead(self->gyroFifoRead, self->bmi088.gyroAddress(), BMI088_GYRO_FIFO_DATA, self->gyroFifoBuffer,
+                   frames * BMI088_GYRO_FIFO_FRAME_SIZE, gyroFifoDone, self);
+    if (!i2cSubmit(self->gyroFifoRead)) {
+      self->readErrors++;
+      self->fifoBacklog = true;
+      self->batchActive = false;
+    }
+  }
+
+  // The accelerometer data was queued before the gyroscope data and has been collected already
+  static void gyroFifoDone(I2CTransaction* transaction) {
+    Imu6DOF* self = (Imu6DOF*)transaction->context;
+    // A failed read leaves the frames in the FIFO, the next batch starts without waiting for an edge
+    if (transaction->status != I2C_DONE) {
+      self->readErrors++;
+      self->fifoBacklog = true;
+    }
+    else {
+      self->collectGyro(transaction->rxLen / BMI088_GYRO_FIFO_FRAME_SIZE);
+    }
+    self->batchActive = false;
+  }
+  #endif
+
 
   // ============ Private methods ==============
   // Helper methods
@@ -353,9 +963,8 @@ private:
     int c = 0;
     while (c < CAL_BUTTON_DURATION) {
       // BMI088 - Get values
-      bmi088.getAcceleration(&AccX, &AccY, &AccZ);
-      bmi088.getGyroscope(&GyroX, &GyroY, &GyroZ);
-      temp = bmi088.getTemperature();
+      readRaw();
+      sampleTemperature();
 
       // Acceleration [mg]
       AccX = AccX - AccErrorX;
@@ -412,11 +1021,43 @@ private:
 
   // Sensor data fetching
   void getIMUdata_BMI088() {
-    // Fetch IMU data
-    bmi088.getAcceleration(&AccX, &AccY, &AccZ);
-    bmi088.getGyroscope(&GyroX, &GyroY, &GyroZ);
-    temp = bmi088.getTemperature();
+    // Fetch IMU data (one burst per sensor, the temperature only every IMU_TEMP_PERIOD)
+    readRaw();
+    filterAcc();
+    filterGyro();
+    sampleTemperature();
+  }
 
+  // Accelerometer [mg] and gyroscope [dps] without calibration and filtering
+  void readRaw() {
+    float acc[3], gyro[3];
+    bmi088.getSample(acc, gyro);
+    AccX = acc[0];
+    AccY = acc[1];
+    AccZ = acc[2];
+    GyroX = gyro[0];
+    GyroY = gyro[1];
+    GyroZ = gyro[2];
+  }
+
+  // The BMI088 updates its temperature every 1.28 s, reading it with every sample only costs bus time
+  bool temperatureDue() {
+    unsigned long tNow = millis();
+    if (tNow - tempTime < IMU_TEMP_PERIOD) {
+      return false;
+    }
+    tempTime = tNow;
+    return true;
+  }
+
+  void sampleTemperature() {
+    if (temperatureDue()) {
+      temp = bmi088.getTemperature();
+    }
+  }
+
+  // Accelerometer with calibration and LP filter
+  void filterAcc() {
     // Acceleration [mg]
     // -----------------
     AccX = AccX - AccErrorX;
@@ -430,8 +1071,10 @@ private:
     AccX_prev = AccX;
     AccY_prev = AccY;
     AccZ_prev = AccZ;
+  }
 
-
+  // Gyroscope with calibration and LP filter
+  void filterGyro() {
     // Rotation [dps]
     // --------------
     GyroX = GyroX - GyroErrorX;
@@ -501,12 +1144,6 @@ private:
       }
       delay(1000); //2000        // <<<<<<<<<<<<<------------------Not sure if this is needed
     }
-
-  // Adjust IMU-settings (will be adjusted during testing)
-  bmi088.setAccScaleRange(RANGE_6G);
-  bmi088.setAccOutputDataRate(ODR_1600);
-  bmi088.setGyroScaleRange(RANGE_2000);
-  bmi088.setGyroOutputDataRate(ODR_2000_BW_532);
   }
 };
 
@@ -0,0 +1,39 @@
+// ==================================
+// ==== IMU data-ready (Header) =====
+// ==================================
+
+/*
+* Interrupt handlers of the BMI088 data-ready lines (INT1 accelerometer, INT3 gyroscope)
+* The handlers only count the edges and store the time of the last one, the I2C read happens in loop()
+* (the bus is shared with the lidar). A count that moved by more than one since the last read means
+* samples were overwritten in the sensor before they were read.
+* Imu6DOF checks at init that the lines fire and watches them in flight, without edges it samples on the clock.
+*/
+
+#pragma once
+
+#ifndef IMU_DATA_READY_H
+#define IMU_DATA_READY_H
+
+#include <Arduino.h>
+
+struct DataReadyLine {
+  volatile uint32_t count;            // Data-ready edges since start
+  volatile unsigned long timeStamp;   // micros() of the last edge
+};
+
+extern DataReadyLine imuAccReady;
+extern DataReadyLine imuGyroReady;
+
+// Attach the handlers (rising edge) to the INT1 / INT3 pins
+void imuDataReadyInit(uint8_t accPin, uint8_t gyroPin);
+
+// Consistent copy of a line (count and the matching time stamp)
+inline void readDataReadyLine(const DataReadyLine& line, uint32_t& count, unsigned long& timeStamp) {
+  do {
+    count = line.count;
+    timeStamp = line.timeStamp;
+  } while (count != line.count);
+}
+
+#endif
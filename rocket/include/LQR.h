@@ -15,11 +15,16 @@
 #include <Arduino.h>
 #include <settings.h>
 #include <GlobalDecRocket.h>
-#include <BasicLinearAlgebra.h>
 
 // Inits
 void lqrInit();
+// Altitude reference at current_time [s since t0], evaluated from the minimum-jerk segments of the mission profile (trajectoryEval)
 void get_tradj_ref(float current_time);
+// True if all gains outside of the axis blocks are zero (lqr() only applies the blocks)
+bool lqrGainsDecoupled(const float k[3][8]);
+
+// Thrust of the motor pair [N] to the ESC pulse width [us] (clamped to 1100..SPEED_LIMIT)
+int thrustToPwm(float thrust);
 void lqr(float x_dot, float gamma1, float gamma1_dot, float y_dot, float gamma2, float gamma2_dot, float z, float z_dot, float t0, LqrSignals& lqrSignals);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,85 @@
+// ==================================
+// ====== Loop statistics (Header) ==
+// ==================================
+
+/*
+* Always-on timing instrumentation of the main loop
+* Every stage of the main loop is timed with micros() and sorted into a fixed-bucket histogram, the loop period
+* is checked against the MADGWICK_FREQUENCY budget (overruns) and the period of the control step against
+* CONTROLLER_FREQUENCY (jitter). Recording is a handful of compares, nothing is allocated in flight.
+* The histograms are written to SD, sent to ground control and printed when the flight ends
+*/
+
+#pragma once
+
+#ifndef LOOP_STATS_H
+#define LOOP_STATS_H
+
+#include <Arduino.h>
+#include <settings.h>
+
+#define LOOP_HIST_BUCKETS 16
+#define LOOP_BUDGET_US (1000000 / MADGWICK_FREQUENCY)
+#define LOOP_OVERRUN_MARGIN_US 25          // Allowed lateness of a loop iteration before it counts as overrun
+#define CONTROL_PERIOD_US (1000000 / CONTROLLER_FREQUENCY)
+
+enum LoopStage {
+  STAGE_IMU = 0,
+  STAGE_MADGWICK,
+  STAGE_LIDAR,
+  STAGE_LQR,
+  STAGE_ACTUATORS,
+  STAGE_SD,
+  STAGE_RADIO,
+  STAGE_LOOP_PERIOD,    // Start to start of the Madgwick task (the frame of the main loop)
+  STAGE_CONTROL_JITTER, // |control period - CONTROL_PERIOD_US|
+  STAGE_COUNT
+};
+
+struct LoopHistogram {
+  uint32_t counts[LOOP_HIST_BUCKETS];
+  uint32_t samples;
+  uint32_t maxUs;
+  uint64_t sumUs;
+};
+
+struct LoopStats {
+  LoopHistogram stages[STAGE_COUNT];
+  uint32_t iterations;
+  uint32_t overruns;      // Loop periods longer than LOOP_BUDGET_US + LOOP_OVERRUN_MARGIN_US
+  uint32_t controlSteps;
+};
+
+// Upper bucket edges [us], the last bucket holds everything above
+extern const uint32_t loopHistEdges[LOOP_HIST_BUCKETS - 1];
+extern const char* const loopStageNames[STAGE_COUNT];
+extern LoopStats loopStats;
+
+// ============ Recording ==============
+inline void loopStatsRecord(LoopStage stage, uint32_t us) {
+  LoopHistogram& h = loopStats.stages[stage];
+  uint8_t b = 0;
+  while (b < LOOP_HIST_BUCKETS - 1 && us >= loopHistEdges[b]) {
+    b++;
+  }
+  h.counts[b]++;
+  h.samples++;
+  h.sumUs += us;
+  if (us > h.maxUs) {
+    h.maxUs = us;
+  }
+}
+
+void loopStatsInit();
+
+// Call at the start of every frame (Madgwick task)
+void loopStatsLoopStart(unsigned long tNow);
+
+// Call at the start of every control step
+void loopStatsControlStart(unsigned long tNow);
+
+// ============ Output ==============
+void loopStatsPrint();
+bool loopStatsWriteSD(const char* filename);
+
+#endif
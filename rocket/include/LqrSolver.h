@@ -0,0 +1,68 @@
+// ==================================
+// ===== LQR solver (Header) ========
+// ==================================
+
+/*
+* On-board LQR gains: discrete algebraic Riccati equation of the linearized hover model in single precision
+* The model is the one of Matlab_LQR/gain_and_trajectory_calculation.m (8 states xDot, gamma1, gamma1Dot, yDot,
+* gamma2, gamma2Dot, z, zDot, 3 inputs thrust, gimbal 1, gimbal 2) built from the mass, the inertias and the
+* gimbal lever arms, discretized with a zero order hold at the controller period. The Riccati equation
+*   P = A'PA - A'PB (R + B'PB)^-1 B'PA + Q,  K = (R + B'PB)^-1 B'PA
+* is solved with the structured doubling algorithm, which converges quadratically (11 iterations for the default
+* model against thousands for the plain Riccati recursion) and only needs one 8x8 LU factorization per iteration.
+*
+* The work is split into slices of a few microseconds (the discretization, then one doubling iteration per
+* call, then the gains), so a recompute runs as a background task of the scheduler without touching the
+* control deadlines. The gains are written into the back buffer of two and published by one index store,
+* the controller only ever sees a complete set: lqr() picks up a new set at the start of its next step.
+*/
+
+#pragma once
+
+#ifndef LQR_SOLVER_H
+#define LQR_SOLVER_H
+
+#include <Arduino.h>
+#include <settings.h>
+
+#define LQR_STATES 8
+#define LQR_INPUTS 3
+#define LQR_SOLVER_MAX_ITERATIONS 40
+#define LQR_SOLVER_TOLERANCE 1e-6f      // Relative change of P that ends the doubling
+
+// Physical parameters and weights of the model
+struct LqrModel {
+  float mass;               // [kg]
+  float Jx;                 // Inertia about the body x axis [kg m^2]
+  float Jy;                 // Inertia about the body y axis [kg m^2]
+  float h1;                 // Center of mass to the lower gimbal axis [m]
+  float h2;                 // Center of mass to the upper gimbal axis [m]
+  float q[LQR_STATES];      // Diagonal of Q
+  float r[LQR_INPUTS];      // Diagonal of R
+};
+
+// Model of the Matlab script
+extern const LqrModel lqrModelDefault;
+
+struct LqrSolution {
+  float k[LQR_INPUTS][LQR_STATES];
+  float mass;               // Of the model, for the feedforward thrust
+  uint8_t iterations;       // Doubling iterations
+  bool converged;           // Always true for a published solution (failed recomputes are not published)
+  uint32_t generation;      // Counts the published solutions
+};
+
+// Start a recompute for a model (a running one is restarted with it)
+void lqrSolverRequest(const LqrModel& model);
+
+// Run the next slice of a pending recompute. Returns true when this call published new gains. A recompute that
+// doesn't converge (or hits a singular system) ends without publishing, the previous gains stay in use
+bool lqrSolverStep();
+
+// True while a recompute is pending
+bool lqrSolverBusy();
+
+// The latest published gains (nullptr before the first)
+const LqrSolution* lqrSolverSolution();
+
+#endif
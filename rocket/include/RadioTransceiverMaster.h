@@ -44,7 +44,22 @@ void initRadio(uint8_t level,
 
 
 void transmitFlightData(PacketData& dataToSend, ControlData& ackData);
+
+/**
+ * @brief Transmits the flight data without waiting for the radio, one of its two packets per call.
+ * 
+ * The packet is only written into the TX FIFO (a few SPI transfers), the radio sends it and waits for the
+ * acknowledgement on its own. The next call collects the outcome (the ack payload into ackData, or drops the
+ * packet after the last retry) before it starts the next packet, a call while the packet is still on air
+ * sends nothing. A new frame is taken from dataToSend every second packet.
+ * 
+ * @param dataToSend The flight data.
+ * @param ackData The acknowledgment data received after transmission.
+ * @return true if a packet was started.
+ */
+bool transmitFlightDataAsync(PacketData& dataToSend, ControlData& ackData);
 void transmitState(States state, ControlData& ackData);
+void transmitLoopStats(ControlData& ackData);
 // void transmitErrorMsg(Errors errCode, ControlData& ackData);
 
 #endif // RADIOTRANSCEIVERMASTER_H
\ No newline at end of file
@@ -0,0 +1,55 @@
+// ==================================
+// ===== Flight replay (Header) =====
+// ==================================
+
+/*
+* Estimator and controller steps of the flight code that the host log replay (host/HostLog/LogReplay.h) runs on
+* the inputs of a flight log, and the state they start from. The flight tasks (main.cpp) call the same functions
+* on the same globals, so a replay of an unchanged build recomputes the logged control records bit for bit.
+*/
+
+#pragma once
+
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <Arduino.h>
+#include "GlobalDecRocket.h"
+#include "IMU.h"
+#include "FlightLog.h"
+
+// Estimator and controller state at the start of the flight (t0), logged as a state chunk
+struct ReplayState {
+  ImuFilterState imu;
+  float xDot;
+  float yDot;
+  float zMeter;
+  float zPrev;
+  float zDot;
+  float zCalibration;
+  int16_t lidarZ;
+  int16_t lidarZPrev;
+  float yawZero;
+};
+
+static_assert(sizeof(ReplayState) <= FLIGHT_LOG_PAYLOAD_SIZE, "ReplayState must fit into a chunk");
+
+// Flight code state (main.cpp)
+extern Imu6DOF imu;
+extern PacketData senderData;
+extern LqrSignals lqrSignals;
+
+// Save / restore the state (the restore also resets the controller with lqrInit())
+void replaySaveState(ReplayState& state);
+void replayRestoreState(const ReplayState& state);
+
+// States derived from the attitude filter after its samples (xDot, yDot)
+void velocityEstimate();
+
+// Altitude and vertical speed from a new lidar distance [cm]
+void lidarEstimate(int16_t distance);
+
+// Control law of the step at tControl [us since t0]: LQR, roll control and the flight data (senderData), no actuation
+void controlCompute(unsigned long tControl);
+
+#endif
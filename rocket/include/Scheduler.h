@@ -0,0 +1,64 @@
+// ==================================
+// ===== Task scheduler (Header) ====
+// ==================================
+
+/*
+* Cooperative rate monotonic scheduler for the main loop
+* Every periodic job of the flight (IMU, Madgwick, lidar, LQR, SD, telemetry) is declared once in a static
+* task table with its period, phase offset, deadline and priority. Releases are phase locked to the
+* scheduler start (release += period), so the tasks never drift against each other.
+*
+* loop() calls schedulerRun() which either runs the highest priority released task to completion, or
+* waits for the next release. Tasks are never preempted, a long task only delays the ones released
+* while it runs and every such delay shows up in the per task accounting:
+*   - lateness:  start - release
+*   - response:  finish - release, a deadline miss when it is above deadlineUs
+*   - skipped:   releases that were never run because the task was a whole period behind
+*
+* Background tasks (SD, telemetry) only start when their expected execution time (wcetUs) fits before
+* the next release of a hard task. A background task that has waited longer than its own deadline is
+* started anyway, so it is delayed by load but never starved.
+*/
+
+#pragma once
+
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <Arduino.h>
+
+typedef void (*TaskFunction)();
+
+struct Task {
+  // Declaration (rate monotonic: the shorter the period, the higher the priority)
+  const char* name;
+  TaskFunction run;
+  uint32_t periodUs;
+  uint32_t offsetUs;        // First release relative to the scheduler start
+  uint32_t deadlineUs;      // Relative to the release
+  uint8_t priority;         // 0 = highest
+  bool background;          // Only runs in the slack of the hard tasks
+  uint32_t wcetUs;          // Expected execution time (background tasks)
+
+  // Accounting (zero initialized, set by the scheduler)
+  unsigned long release;    // Next release [us]
+  uint32_t runs;
+  uint32_t deadlineMisses;
+  uint32_t skipped;
+  uint32_t maxLatenessUs;
+  uint32_t maxResponseUs;
+  uint64_t sumResponseUs;
+};
+
+// Sorts the table by priority and sets the first releases (tStart + offsetUs)
+void schedulerInit(Task* tasks, uint8_t count, unsigned long tStart);
+
+// Run the highest priority released task, or wait for the next release when there is none
+// Returns the task that was run (nullptr when idle)
+Task* schedulerRun();
+
+// ============ Output ==============
+void schedulerPrint();
+bool schedulerWriteSD(const char* filename);
+
+#endif
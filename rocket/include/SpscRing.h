@@ -0,0 +1,71 @@
+// ==================================
+// ===== SPSC ring buffer (Header) ==
+// ==================================
+
+/*
+* Lock-free single-producer/single-consumer ring buffer
+* One side (e.g. an interrupt) only pushes, the other side (e.g. loop()) only pops. Each index is written by
+* exactly one side, so neither needs to disable interrupts. The memory barriers keep the element copy ordered
+* before the index update that publishes it.
+* SIZE must be a power of two, the ring holds SIZE elements.
+*/
+
+#pragma once
+
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <Arduino.h>
+
+template <typename T, uint16_t SIZE>
+class SpscRing {
+  static_assert(SIZE > 0 && (SIZE & (SIZE - 1)) == 0, "SpscRing size must be a power of two");
+
+public:
+  // ============ Producer ==============
+  // Returns false (and drops the element) when the ring is full
+  bool push(const T& item) {
+    uint16_t h = head;
+    if ((uint16_t)(h - tail) >= SIZE) {
+      return false;
+    }
+    buffer[h & (SIZE - 1)] = item;
+    __sync_synchronize();
+    head = h + 1;
+    return true;
+  }
+
+  // ============ Consumer ==============
+  bool pop(T& item) {
+    uint16_t t = tail;
+    if (t == head) {
+      return false;
+    }
+    __sync_synchronize();
+    item = buffer[t & (SIZE - 1)];
+    __sync_synchronize();
+    tail = t + 1;
+    return true;
+  }
+
+  // Drop everything that has been pushed so far
+  void clear() {
+    tail = head;
+  }
+
+  // ============ Both sides ==============
+  uint16_t size() const {
+    return (uint16_t)(head - tail);
+  }
+
+  bool empty() const {
+    return head == tail;
+  }
+
+private:
+  T buffer[SIZE];
+  volatile uint16_t head = 0;   // Written by the producer only
+  volatile uint16_t tail = 0;   // Written by the consumer only
+};
+
+#endif
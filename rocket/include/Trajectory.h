@@ -0,0 +1,66 @@
+// ==================================
+// ===== Trajectory (Header) ========
+// ==================================
+
+/*
+* Altitude reference of the LQR, generated on board from the waypoints of a mission profile
+* A profile is a list of altitudes with a hold time at each. Every move between two altitudes is a minimum-jerk
+* quintic, z(tau) = z0 + dz * (10 tau^3 - 15 tau^4 + 6 tau^5) with tau = (t - tStart) / T, which starts and
+* ends at rest with zero acceleration. T is the shortest duration that keeps the peak speed (1.875 |dz| / T)
+* and the peak acceleration (5.7735 |dz| / T^2) within the limits of the profile.
+* The segments are laid out once when a profile is selected (a few floats each). Evaluating the reference takes
+* a few dozen FLOPs: the current segment is kept between the calls (time only moves forward in flight, a jump
+* back restarts the search at the first segment).
+* Replaces the 10 s reference tables computed in Matlab_LQR/gain_and_trajectory_calculation.m.
+*/
+
+#pragma once
+
+#ifndef TRAJECTORY_H
+#define TRAJECTORY_H
+
+#include <Arduino.h>
+#include <settings.h>
+
+// Mission profiles
+#define MISSION_HOVER 0             // Rise to 1 m and hover
+#define MISSION_HOP 1               // Rise to 0.5 m, hover 1 s and land
+#define MISSION_STAIRS 2            // 0.5 m, 1 m and back to 0.5 m with 1 s holds
+#define MISSION_COUNT 3
+
+#define TRAJECTORY_MAX_WAYPOINTS 6
+#define TRAJECTORY_MAX_SEGMENTS (2 * TRAJECTORY_MAX_WAYPOINTS)
+
+struct TrajectoryWaypoint {
+  float z;                  // Altitude [m]
+  float hold;               // Time at the altitude before the next move [s] (the last one is held to the end)
+};
+
+struct MissionProfile {
+  const char* name;
+  float zStart;             // Altitude at t = 0 [m]
+  float vMax;               // Speed limit [m/s]
+  float aMax;               // Acceleration limit [m/s^2]
+  uint8_t waypointCount;
+  TrajectoryWaypoint waypoints[TRAJECTORY_MAX_WAYPOINTS];
+};
+
+extern const MissionProfile missionProfiles[MISSION_COUNT];
+
+// Reference at one point in time
+struct TrajectoryRef {
+  float z;                  // [m]
+  float zDot;               // [m/s]
+  float zDDot;              // Feedforward acceleration [m/s^2]
+};
+
+// Lay out the segments of a profile (MISSION_...). Returns false for an unknown profile (the previous one is kept)
+bool trajectorySelect(uint8_t mission);
+
+// Reference at t [s since t0]. Before the start it is the start altitude, after the end the last waypoint
+void trajectoryEval(float t, TrajectoryRef& ref);
+
+// Time at which the last waypoint is reached [s]
+float trajectoryDuration();
+
+#endif
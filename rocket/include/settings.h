@@ -17,6 +17,9 @@
 #define DISABLE_COM
 #define TIME_LIMIT 8000
 #define LOOP_RATE
+#define IMU_DATA_READY                  // Sample the BMI088 on its data-ready interrupts (otherwise polled at IMU_SAMPLE_FREQUENCY)
+#define I2C_ASYNC                       // Non-blocking sensor reads in flight (interrupt driven I2C transaction queue)
+// #define IMU_FIFO                     // Batch read the BMI088 FIFOs at the full output data rate (needs IMU_DATA_READY)
 // #define ROLLCONTROLLER
 #define MOTORS_SERVOS
 
@@ -25,6 +28,9 @@
 
 // Reference values
 #define ALT_REF 1
+#define MISSION_PROFILE MISSION_HOVER   // Altitude reference of the LQR (MISSION_HOVER, MISSION_HOP, MISSION_STAIRS in Trajectory.h)
+#define GAIN_SCHEDULE GAINS_HOVER       // Gains of the LQR along the flight (GAINS_HOVER, GAINS_ALTITUDE, GAINS_THRUST in GainSchedule.h)
+// #define LQR_SOLVER                   // Solve the LQR gains on board from the model in LqrSolver.cpp at boot and on lqrSolverRequest() (replaces GAIN_SCHEDULE)
 
 
 // =============================================================================================
@@ -38,6 +44,8 @@
 #define SERVO_2_PIN 3       // Upper servo (yRot = imu.pitch_IMU)
 #define CAL_BUTTON  37 //6
 #define RED_LED_PIN 41 
+#define IMU_ACC_INT_PIN 22  // BMI088 INT1 (accelerometer data ready)
+#define IMU_GYRO_INT_PIN 23 // BMI088 INT3 (gyroscope data ready)
 
 // // ===== Radio pin assignment =====
 // Define the pins used for the nRF24L01 transceiver module (CE, CSN)
@@ -67,6 +75,12 @@
 // ====== I2C interface ======
 #define I2C_CLOCKSPEED 400000
 #define IMU_ADR 0x68 //b1101000 // Sensor adress for I2C communication
+#define IMU_RING_SIZE 32                // Queued IMU samples between reading and filtering (power of two)
+#define IMU_FIFO_WATERMARK 4            // Gyroscope FIFO frames that start a batch read (IMU_FIFO)
+#define IMU_FIFO_MAX_FRAMES 16          // Frames read per sensor and batch, the rest follows with the next batch
+#define IMU_READY_CHECK_EDGES 10        // Data-ready edges of each line init() waits for before it trusts the interrupts (IMU_DATA_READY)
+#define IMU_READY_TIMEOUT 20            // [ms] No data-ready edge for this long (at init or in flight): the IMU is sampled on the clock
+#define IMU_TEMP_PERIOD 1000            // [ms] BMI088 temperature read interval (the sensor updates it every 1.28 s)
 //#define PRESSURE_SENSOR_ADR 0x77 // Default adress and does not need to be given
 
 // ====== Radio Configuration ======
@@ -89,6 +103,23 @@
 // ======== Roll Configuration =================================
 #define ROLL_Kp 3     // Proportional gain
 
+// ======== Task scheduler =====================================
+#define LIDAR_FREQUENCY 100             // Lidar sampling frequency [Hz]
+#define TELEMETRY_FREQUENCY 50          // Flight data sent to ground control, runs in the slack of the control tasks [Hz]
+#define SD_WRITE_FREQUENCY 200          // Flight log chunk writes (one 512 byte chunk each), runs in the slack [Hz]
+#define LQR_SOLVER_FREQUENCY 1000       // Slices of a gain recompute (LQR_SOLVER, one Riccati doubling iteration each), runs in the slack [Hz]
+
+// ======== Flight log =========================================
+#define FLIGHT_LOG_RING_SIZE 16384      // Full chunks waiting for the SD writer [bytes], a multiple of 512
+#define FLIGHT_LOG_PREALLOCATE          // Allocate and erase a contiguous file for TIME_LIMIT at boot (no FAT allocation in flight)
+#define FLIGHT_LOG_IMU                  // Log every filtered IMU sample with the quaternion (data-ready sampling only, 2 kHz channel)
+#define FLIGHT_LOG_REPLAY               // Log the start state and the lidar/timing inputs of every control step for the host log replay (needs FLIGHT_LOG_IMU)
+#define SD_WRITE_WCET 300               // Budget of one 512 byte chunk write into the preallocated file [us]
+
+// ======== Black box ==========================================
+#define BLACK_BOX                       // Keep the last seconds of every main loop frame in RAM, written to SD when the flight ends
+#define BLACK_BOX_SECONDS 2             // Length of the ring [s] (64 bytes per frame, 2 s at 2 kHz = 256 kB of DMAMEM)
+
 
 
 // =============================================================================================
@@ -121,6 +152,7 @@
 // Test 1
 // -----------------------------
 // #define MADGWICK_DELTA                   // If defined, the madgwick dt = time between madgwick calls - If not defined, madgwick dt = IMU sample dt
+                                         // (the filter then only steps after a new sample, so with IMU_SAMPLE_FREQUENCY < MADGWICK_FREQUENCY every sample is integrated once)
 #define MADGWICK_FREQUENCY 2000          // Main loop frequency (the same as mdagwick filter frequency)
 #define CONTROLLER_FREQUENCY 100         // The frequency at which the LQR recalculates the control values
 #define IMU_SAMPLE_FREQUENCY 400//100 // 400
@@ -131,11 +163,21 @@
 #define B_ACCEL 0.35//0.25//0.14                       // Accelerometer LP filter paramter, (MPU6050 default: 0.14. MPU9250 default: 0.2)
 #define B_GYRO 0.35//0.25//0.1                         // Gyro LP filter paramter, (MPU6050 default: 0.1. MPU9250 default: 0.17)
 
-#define ACC_RANGE_SETTING RANGE_3G
-#define ACC_RATE_SETTING ODR_400 //ODR_200 //ODR_400 //ODR_100//    // bwp = 145 Hz
-
-#define GYRO_RANGE_SETTING RANGE_500
-#define GYRO_RATE_SETTING ODR_400_BW_47 // ODR_200_BW_23 // ODR_400_BW_47 //ODR_100_BW_32
+// The flown settings, sampled at IMU_SAMPLE_FREQUENCY (data-ready sampling reads the latest sample)
+#define ACC_RANGE_SETTING RANGE_6G //RANGE_3G
+#define ACC_RATE_SETTING ODR_1600 //ODR_400 //ODR_200 //ODR_100//    // bwp = 145 Hz at ODR_400
+
+#define GYRO_RANGE_SETTING RANGE_2000 //RANGE_500
+#define GYRO_RATE_SETTING ODR_2000_BW_532 //ODR_400_BW_47 // ODR_200_BW_23 //ODR_100_BW_32
+#define GYRO_ODR 2000                          // Nominal output data rate of GYRO_RATE_SETTING [Hz]
+
+// FIFO batch mode (IMU_FIFO): full output data rates, LP filters with the same cutoff as above at 400 Hz
+#define ACC_FIFO_RATE_SETTING ODR_1600
+#define GYRO_FIFO_RATE_SETTING ODR_2000_BW_230
+#define ACC_FIFO_ODR 1600                      // Nominal output data rates of the two settings above [Hz]
+#define GYRO_FIFO_ODR 2000
+#define B_ACCEL_FIFO 0.102                     // 1 - (1 - B_ACCEL)^(400/1600)
+#define B_GYRO_FIFO 0.083                      // 1 - (1 - B_GYRO)^(400/2000)
 // -----------------------------
 // Test 1
 
@@ -94,6 +94,7 @@ void BMI088::setAccScaleRange(acc_scale_type_t range) {
     } else if (range == RANGE_24G) {
         accRange = 24000;
     }
+    accScale = accRange / 32768;
 
     write8(ACC, BMI088_ACC_RANGE, (uint8_t)range);
 }
@@ -120,6 +121,7 @@ void BMI088::setGyroScaleRange(gyro_scale_type_t range) {
     } else if (range == RANGE_125) {
         gyroRange = 125;
     }
+    gyroScale = gyroRange / 32768;
 
     write8(GYRO, BMI088_GYRO_RANGE, (uint8_t)range);
 }
@@ -128,12 +130,130 @@ void BMI088::setGyroOutputDataRate(gyro_odr_type_t odr) {
     write8(GYRO, BMI088_GYRO_BAND_WIDTH, (uint8_t)odr);
 }
 
+void BMI088::setAccDataReadyInt1(bool enable) {
+    if (enable) {
+        write8(ACC, BMI088_ACC_INT1_IO_CTRL, 0x0A);     // int1_out, push-pull, active high
+        write8(ACC, BMI088_ACC_INT_MAP_DATA, 0x04);     // int1_drdy
+    } else {
+        write8(ACC, BMI088_ACC_INT_MAP_DATA, 0x00);
+        write8(ACC, BMI088_ACC_INT1_IO_CTRL, 0x00);
+    }
+}
+
+void BMI088::setGyroDataReadyInt3(bool enable) {
+    if (enable) {
+        write8(GYRO, BMI088_GYRO_INT3_INT4_IO_CONF, 0x01);  // int3 push-pull, active high
+        write8(GYRO, BMI088_GYRO_INT3_INT4_IO_MAP, 0x01);   // data ready on int3
+        write8(GYRO, BMI088_GYRO_INT_CTRL, 0x80);           // enable new data interrupt
+    } else {
+        write8(GYRO, BMI088_GYRO_INT_CTRL, 0x00);
+        write8(GYRO, BMI088_GYRO_INT3_INT4_IO_MAP, 0x00);
+    }
+}
+
+void BMI088::setAccFifo(bool enable, uint16_t watermark) {
+    if (enable) {
+        write8(ACC, BMI088_ACC_FIFO_CONFIG_0, 0x02);            // Stream mode
+        write8(ACC, BMI088_ACC_FIFO_DOWNS, 0x80);               // No downsampling
+        write8(ACC, BMI088_ACC_FIFO_WTM_0, watermark & 0xFF);
+        write8(ACC, BMI088_ACC_FIFO_WTM_1, (watermark >> 8) & 0x1F);
+        write8(ACC, BMI088_ACC_FIFO_CONFIG_1, 0x50);            // Acceleration frames with header
+    } else {
+        write8(ACC, BMI088_ACC_FIFO_CONFIG_1, 0x10);
+    }
+    write8(ACC, BMI088_ACC_SOFT_RESET, 0xB0);                   // FIFO flush
+}
+
+void BMI088::setGyroFifo(bool enable, uint8_t watermark) {
+    if (enable) {
+        write8(GYRO, BMI088_GYRO_FIFO_CONFIG_0, watermark & 0x7F);
+        write8(GYRO, BMI088_GYRO_FIFO_CONFIG_1, 0x80);          // Stream mode, clears the FIFO
+        write8(GYRO, BMI088_GYRO_FIFO_WM_EN, 0x88);
+    } else {
+        write8(GYRO, BMI088_GYRO_FIFO_WM_EN, 0x08);
+        write8(GYRO, BMI088_GYRO_FIFO_CONFIG_1, 0x00);          // Bypass
+    }
+}
+
+void BMI088::setAccFifoWatermarkInt1(bool enable) {
+    if (enable) {
+        write8(ACC, BMI088_ACC_INT1_IO_CTRL, 0x0A);     // int1_out, push-pull, active high
+        write8(ACC, BMI088_ACC_INT_MAP_DATA, 0x01);     // int1_fwm
+    } else {
+        write8(ACC, BMI088_ACC_INT_MAP_DATA, 0x00);
+        write8(ACC, BMI088_ACC_INT1_IO_CTRL, 0x00);
+    }
+}
+
+void BMI088::setGyroFifoWatermarkInt3(bool enable) {
+    if (enable) {
+        write8(GYRO, BMI088_GYRO_INT3_INT4_IO_CONF, 0x01);  // int3 push-pull, active high
+        write8(GYRO, BMI088_GYRO_INT3_INT4_IO_MAP, 0x04);   // FIFO interrupt on int3
+        write8(GYRO, BMI088_GYRO_INT_CTRL, 0x40);           // enable FIFO interrupt
+    } else {
+        write8(GYRO, BMI088_GYRO_INT_CTRL, 0x00);
+        write8(GYRO, BMI088_GYRO_INT3_INT4_IO_MAP, 0x00);
+    }
+}
+
+uint16_t BMI088::getAccFifoLength(void) {
+    return read16(ACC, BMI088_ACC_FIFO_LENGTH_0) & 0x3FFF;
+}
+
+uint8_t BMI088::getGyroFifoStatus(void) {
+    return read8(GYRO, BMI088_GYRO_FIFO_STATUS);
+}
+
+void BMI088::readAccFifo(uint8_t* buf, uint16_t len) {
+    read(ACC, BMI088_ACC_FIFO_DATA, buf, min(len, (uint16_t)60));
+}
+
+void BMI088::readGyroFifo(uint8_t* buf, uint8_t frames) {
+    frames = min(frames, (uint8_t)(60 / BMI088_GYRO_FIFO_FRAME_SIZE));
+    read(GYRO, BMI088_GYRO_FIFO_DATA, buf, frames * BMI088_GYRO_FIFO_FRAME_SIZE);
+}
+
+uint8_t BMI088::parseAccFifo(const uint8_t* buf, uint16_t len, uint8_t* frames, uint8_t maxFrames, uint16_t* dropped) {
+    uint8_t n = 0;
+    uint16_t i = 0;
+
+    while (i < len && n < maxFrames) {
+        uint8_t header = buf[i];
+
+        if ((header & 0xFC) == 0x84) {          // Acceleration frame
+            if (i + BMI088_ACC_FIFO_FRAME_SIZE > len) {
+                break;                          // Partially read, the sensor sends it again
+            }
+            memcpy(&frames[6 * n], &buf[i + 1], 6);
+            n++;
+            i += BMI088_ACC_FIFO_FRAME_SIZE;
+        } else if (header == 0x40) {            // Skip frame, number of frames lost in an overflow
+            if (dropped && i + 1 < len) {
+                *dropped += buf[i + 1];
+            }
+            i += 2;
+        } else if (header == 0x44) {            // Sensor time frame
+            i += 4;
+        } else if (header == 0x48 || header == 0x50) {  // Configuration change / drop frame
+            i += 2;
+        } else {                                // 0x80: FIFO empty
+            break;
+        }
+    }
+
+    return n;
+}
+
 void BMI088::getAcceleration(float* x, float* y, float* z) {
     uint8_t buf[6] = {0};
-    uint16_t ax = 0, ay = 0, az = 0;
-    float value = 0;
 
     read(ACC, BMI088_ACC_X_LSB, buf, 6);
+    convertAcceleration(buf, x, y, z);
+}
+
+void BMI088::convertAcceleration(const uint8_t* buf, float* x, float* y, float* z) {
+    uint16_t ax = 0, ay = 0, az = 0;
+    float value = 0;
 
     ax = buf[0] | (buf[1] << 8);
     ay = buf[2] | (buf[3] << 8);
@@ -187,10 +307,14 @@ float BMI088::getAccelerationZ(void) {
 
 void BMI088::getGyroscope(float* x, float* y, float* z) {
     uint8_t buf[6] = {0};
-    uint16_t gx = 0, gy = 0, gz = 0;
-    float value = 0;
 
     read(GYRO, BMI088_GYRO_RATE_X_LSB, buf, 6);
+    convertGyroscope(buf, x, y, z);
+}
+
+void BMI088::convertGyroscope(const uint8_t* buf, float* x, float* y, float* z) {
+    uint16_t gx = 0, gy = 0, gz = 0;
+    float value = 0;
 
     gx = buf[0] | (buf[1] << 8);
     gy = buf[2] | (buf[3] << 8);
@@ -242,11 +366,24 @@ float BMI088::getGyroscopeZ(void) {
     return value;
 }
 
-int16_t BMI088::getTemperature(void) {
-    uint16_t data = 0;
+void BMI088::getSample(float* acc, float* gyro) {
+    uint8_t accBuf[6] = {0};
+    uint8_t gyroBuf[6] = {0};
+
+    read(ACC, BMI088_ACC_X_LSB, accBuf, 6);
+    read(GYRO, BMI088_GYRO_RATE_X_LSB, gyroBuf, 6);
+    convertSample(accBuf, gyroBuf, acc, gyro);
+}
 
-    data = read16Be(ACC, BMI088_ACC_TEMP_MSB);
-    data = data >> 5;
+void BMI088::convertSample(const uint8_t* accBuf, const uint8_t* gyroBuf, float* acc, float* gyro) {
+    for (uint8_t i = 0; i < 3; i++) {
+        acc[i] = accScale * (int16_t)(accBuf[2 * i] | (accBuf[2 * i + 1] << 8));
+        gyro[i] = gyroScale * (int16_t)(gyroBuf[2 * i] | (gyroBuf[2 * i + 1] << 8));
+    }
+}
+
+int16_t BMI088::convertTemperature(const uint8_t* buf) {
+    int16_t data = (buf[1] | (buf[0] << 8)) >> 5;
 
     if (data > 1023) {
         data = data - 2048;
@@ -255,6 +392,13 @@ int16_t BMI088::getTemperature(void) {
     return (int16_t)(data / 8 + 23);
 }
 
+int16_t BMI088::getTemperature(void) {
+    uint8_t buf[2] = {0};
+
+    read(ACC, BMI088_ACC_TEMP_MSB, buf, 2);
+    return convertTemperature(buf);
+}
+
 void BMI088::write8(device_type_t dev, uint8_t reg, uint8_t val) {
     uint8_t addr = 0;
 
@@ -56,9 +56,19 @@
 #define BMI088_ACC_TEMP_MSB         0x22
 #define BMI088_ACC_TEMP_LSB         0x23
 
+#define BMI088_ACC_FIFO_LENGTH_0    0x24
+#define BMI088_ACC_FIFO_LENGTH_1    0x25
+#define BMI088_ACC_FIFO_DATA        0x26
+
 #define BMI088_ACC_CONF             0x40
 #define BMI088_ACC_RANGE            0x41
 
+#define BMI088_ACC_FIFO_DOWNS       0x45
+#define BMI088_ACC_FIFO_WTM_0       0x46
+#define BMI088_ACC_FIFO_WTM_1       0x47
+#define BMI088_ACC_FIFO_CONFIG_0    0x48
+#define BMI088_ACC_FIFO_CONFIG_1    0x49
+
 #define BMI088_ACC_INT1_IO_CTRL     0x53
 #define BMI088_ACC_INT2_IO_CTRL     0x54
 #define BMI088_ACC_INT_MAP_DATA     0x58
@@ -85,6 +95,8 @@
 
 #define BMI088_GYRO_INT_STAT_1          0x0A
 
+#define BMI088_GYRO_FIFO_STATUS         0x0E
+
 #define BMI088_GYRO_RANGE               0x0F
 #define BMI088_GYRO_BAND_WIDTH          0x10
 
@@ -96,8 +108,21 @@
 #define BMI088_GYRO_INT3_INT4_IO_CONF   0x16
 #define BMI088_GYRO_INT3_INT4_IO_MAP    0x18
 
+#define BMI088_GYRO_FIFO_WM_EN          0x1E
+
 #define BMI088_GYRO_SELF_TEST           0x3C
 
+#define BMI088_GYRO_FIFO_CONFIG_0       0x3D
+#define BMI088_GYRO_FIFO_CONFIG_1       0x3E
+#define BMI088_GYRO_FIFO_DATA           0x3F
+
+// FIFO frames
+#define BMI088_ACC_FIFO_SIZE            1024    // [bytes]
+#define BMI088_ACC_FIFO_FRAME_SIZE      7       // Header + x, y, z
+#define BMI088_GYRO_FIFO_SIZE           100     // [frames]
+#define BMI088_GYRO_FIFO_FRAME_SIZE     6       // x, y, z (no header)
+#define BMI088_GYRO_FIFO_OVERRUN        0x80    // FIFO_STATUS flag, frames were lost
+
 enum device_type_t { // device type
     ACC = 0x00, //
     GYRO = 0x01, //
@@ -169,6 +194,32 @@ public:
     void setGyroScaleRange(gyro_scale_type_t range);
     void setGyroOutputDataRate(gyro_odr_type_t odr);
 
+    // Data-ready interrupts (push-pull, active high): accelerometer on INT1, gyroscope on INT3
+    void setAccDataReadyInt1(bool enable);
+    void setGyroDataReadyInt3(bool enable);
+
+    // FIFOs in stream mode (oldest frames are overwritten when full), cleared when configured
+    // Accelerometer: header + 6 data bytes per frame, watermark in bytes. Gyroscope: 6 bytes per frame, watermark in frames
+    void setAccFifo(bool enable, uint16_t watermark = 0);
+    void setGyroFifo(bool enable, uint8_t watermark = 0);
+
+    // FIFO watermark interrupts, on the same pins as the data-ready interrupts (replace them)
+    void setAccFifoWatermarkInt1(bool enable);
+    void setGyroFifoWatermarkInt3(bool enable);
+
+    // Fill levels: accelerometer [bytes], gyroscope FIFO_STATUS (frames, BMI088_GYRO_FIFO_OVERRUN flag)
+    uint16_t getAccFifoLength(void);
+    uint8_t getGyroFifoStatus(void);
+
+    // Read len bytes / frames from the FIFO data registers (at most 60 bytes per call, the Wire buffer)
+    void readAccFifo(uint8_t* buf, uint16_t len);
+    void readGyroFifo(uint8_t* buf, uint8_t frames);
+
+    // Parse accelerometer FIFO data: the data of up to maxFrames acceleration frames (6 bytes each) is copied
+    // into frames, control frames are skipped. Returns the number of acceleration frames, dropped counts the
+    // frames the sensor reports as lost in an overflow (skip frames)
+    uint8_t parseAccFifo(const uint8_t* buf, uint16_t len, uint8_t* frames, uint8_t maxFrames, uint16_t* dropped);
+
     void getAcceleration(float* x, float* y, float* z);
     float getAccelerationX(void);
     float getAccelerationY(void);
@@ -181,6 +232,24 @@ public:
 
     int16_t getTemperature(void);
 
+    // Conversion of raw data registers (6 bytes from ACC_X_LSB / GYRO_RATE_X_LSB), e.g. read asynchronously
+    void convertAcceleration(const uint8_t* buf, float* x, float* y, float* z);
+    void convertGyroscope(const uint8_t* buf, float* x, float* y, float* z);
+
+    // Burst read: acceleration [mg] and rotation [dps] with one register burst per sensor, converted in one pass
+    void getSample(float* acc, float* gyro);
+    void convertSample(const uint8_t* accBuf, const uint8_t* gyroBuf, float* acc, float* gyro);
+
+    // Conversion of the temperature registers (2 bytes from ACC_TEMP_MSB)
+    int16_t convertTemperature(const uint8_t* buf);
+
+    // One LSB of the current ranges, acceleration [mg] and rotation [dps] are the raw counts times these
+    float getAccScale(void) { return accScale; }
+    float getGyroScale(void) { return gyroScale; }
+
+    uint8_t accAddress(void) { return devAddrAcc; }
+    uint8_t gyroAddress(void) { return devAddrGyro; }
+
     uint8_t getAccID(void);
     uint8_t getGyroID(void);
 
@@ -198,6 +267,8 @@ public:
 
     float accRange;
     float gyroRange;
+    float accScale = 6000.0f / 32768;    // accRange / 32768, [mg/LSB]
+    float gyroScale = 2000.0f / 32768;   // gyroRange / 32768, [dps/LSB]
     uint8_t devAddrAcc;
     uint8_t devAddrGyro;
 };
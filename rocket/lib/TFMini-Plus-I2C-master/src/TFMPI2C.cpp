@@ -120,6 +120,15 @@ bool TFMPI2C::getData( int16_t &dist, int16_t &flux, int16_t &temp, uint8_t addr
       else frame[ i] = uint8_t( Wire.read());
     }
 
+    return parseFrame( dist, flux, temp);
+}
+
+// = = = = =  INTERPRET A FRAME OF DATA  = = = = = = = = = = = = =
+//
+// Steps 2 and 3 of getData(), also used for frames that were
+// read asynchronously into `frame`.
+bool TFMPI2C::parseFrame( int16_t &dist, int16_t &flux, int16_t &temp)
+{
     // - - - - - - - - - - - - - - - - - - - - - - - - - - - -
     // Step 2 - Perform a checksum test.
     // - - - - - - - - - - - - - - - - - - - - - - - - - - - -
@@ -195,38 +204,8 @@ bool TFMPI2C::sendCommand( uint32_t cmnd, uint32_t param, uint8_t addr)
     // - - - - - - - - - - - - - - - - - - - - - - - - - - - -
     // `reply` data array, `replyLen`, `cmndLen` and `cmndData`
     // variables are all declared in TFMPI2C.h
-
-    // Clear the send command data array.
-    memset( cmndData, 0, sizeof( cmndData));
-    memcpy( &cmndData[ 0], &cmnd, 4);   // Copy 4 bytes of data: reply length,
-                                        // command length, command number and
-                                        // a one byte parameter, all encoded as
-                                        // a 32 bit unsigned integer.
-
-    replyLen = cmndData[ 0];            // Save the first byte as reply length.
-    cmndLen = cmndData[ 1];             // Save the second byte as command length.
-    cmndData[ 0] = 0x5A;                // Set the first byte to the header character.
-
-    if( cmnd == SET_FRAME_RATE)           // If the command is to Set Frame Rate...
-    {
-      memcpy( &cmndData[ 3], &param, 2);  // add the 2 byte Frame Rate parameter.
-    }
-    else if( cmnd == SET_BAUD_RATE)       // If the command is to Set Baud Rate...
-    {
-      memcpy( &cmndData[ 3], &param, 4);  // add the 3 byte Baud Rate parameter.
-    }
-    else if( cmnd == SET_I2C_ADDRESS)     // If the command to set I2C address...
-    {
-      memcpy( &cmndData[ 3], &param, 1);  // copy the 1 byte Address parameter.
-    }
-
-    // Create a checksum byte for the command data array.
-    // chkSum variable declared in `TFMPI2C.h`
-    chkSum = 0;
-    // Add together all bytes but the last...
-    for( uint8_t i = 0; i < ( cmndLen - 1); i++) chkSum += cmndData[ i];
-    // and save it as the last byte of command data.
-    cmndData[ cmndLen - 1] = uint8_t( chkSum);
+    replyLen = uint8_t( cmnd);          // The first byte is the reply length.
+    cmndLen = prepareCommand( cmnd, param, cmndData);
 
     // - - - - - - - - - - - - - - - - - - - - - - - - - - - -
     // Step 2 - Send the command data array to the device
@@ -317,6 +296,43 @@ bool TFMPI2C::sendCommand( uint32_t cmnd, uint32_t param, uint8_t addr)
     return true;
 }
 
+// = = = = =  BUILD THE COMMAND DATA  = = = = = = = = = = = = = =
+//
+// Returns the command length. `data` must hold TFMP_COMMAND_MAX bytes.
+uint8_t TFMPI2C::prepareCommand( uint32_t cmnd, uint32_t param, uint8_t *data)
+{
+    // Clear the send command data array.
+    memset( data, 0, TFMP_COMMAND_MAX);
+    memcpy( &data[ 0], &cmnd, 4);       // Copy 4 bytes of data: reply length,
+                                        // command length, command number and
+                                        // a one byte parameter, all encoded as
+                                        // a 32 bit unsigned integer.
+
+    uint8_t len = data[ 1];             // The second byte is the command length.
+    data[ 0] = 0x5A;                    // Set the first byte to the header character.
+
+    if( cmnd == SET_FRAME_RATE)           // If the command is to Set Frame Rate...
+    {
+      memcpy( &data[ 3], &param, 2);      // add the 2 byte Frame Rate parameter.
+    }
+    else if( cmnd == SET_BAUD_RATE)       // If the command is to Set Baud Rate...
+    {
+      memcpy( &data[ 3], &param, 4);      // add the 3 byte Baud Rate parameter.
+    }
+    else if( cmnd == SET_I2C_ADDRESS)     // If the command to set I2C address...
+    {
+      memcpy( &data[ 3], &param, 1);      // copy the 1 byte Address parameter.
+    }
+
+    // Create a checksum byte for the command data array
+    // and save it as the last byte of command data.
+    uint16_t sum = 0;
+    for( uint8_t i = 0; i < ( len - 1); i++) sum += data[ i];
+    data[ len - 1] = uint8_t( sum);
+
+    return len;
+}
+
 // Send a command using default I2C address
 bool TFMPI2C::sendCommand( uint32_t cmnd, uint32_t param)
 {
@@ -228,6 +228,12 @@ class TFMPI2C
     // Send a command and check response using default address.
     bool sendCommand( uint32_t cmnd, uint32_t param);
 
+    // Split versions for asynchronous I2C transfers:
+    // Build the command bytes into `data` (at least TFMP_COMMAND_MAX bytes), returns the command length
+    uint8_t prepareCommand( uint32_t cmnd, uint32_t param, uint8_t *data);
+    // Checksum test and interpretation of the data-frame in `frame`, sets `status`
+    bool parseFrame( int16_t &dist, int16_t &flux, int16_t &temp);
+
     //  For testing purposes:
     //  Print status and frame data as string of HEX characters
     void printFrame();
@@ -0,0 +1,191 @@
+// =======================
+// ===== Benchmarks ======
+// =======================
+
+/*
+* Per function cost of the flight hot path, compared to the main loop budget (500 us at 2 kHz)
+* Build with the teensy41_bench / native_bench environments, the results are printed on Serial
+*/
+
+
+// =============================================================================================
+//  Preprocessor Definitions
+// =============================================================================================
+#ifdef BENCHMARK
+
+#include <Arduino.h>
+#include <settings.h>
+#include <GlobalDecRocket.h>
+#include "Benchmark.h"
+#include "IMU.h"
+#include "LQR.h"
+#include "GainSchedule.h"
+#include "LqrSolver.h"
+#include "RadioTransceiverMaster.h"
+
+#ifdef HOST_BUILD
+  #include <chrono>
+  #if defined(__x86_64__) || defined(__i386__)
+    #include <x86intrin.h>
+    #define BENCH_TSC
+  #endif
+#endif
+
+
+// =============================================================================================
+//  Definitions
+// =============================================================================================
+
+// Firmware state (main.cpp)
+extern Imu6DOF imu;
+extern PacketData senderData;
+extern ControlData ackData;
+extern LqrSignals lqrSignals;
+void write2SD();
+
+// Counter frequency
+static double cyclesPerUs = 1.0;
+static const char* counterName = "";
+
+// Keeps the compiler from removing benchmarked calls without side effects
+static volatile double benchSink = 0.0;
+
+
+// =============================================================================================
+//  Functions
+// =============================================================================================
+
+// ====== Cycle counter ======
+void benchInit() {
+  #ifdef HOST_BUILD
+    #ifdef BENCH_TSC
+      // Calibrate the TSC against the monotonic clock
+      auto t0 = std::chrono::steady_clock::now();
+      uint64_t c0 = __rdtsc();
+      while (std::chrono::steady_clock::now() - t0 < std::chrono::milliseconds(50)) {}
+      uint64_t c1 = __rdtsc();
+      double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count();
+      cyclesPerUs = double(c1 - c0) / us;
+      counterName = "TSC";
+    #else
+      cyclesPerUs = 1000.0;
+      counterName = "std::chrono [ns]";
+    #endif
+  #else
+    // Enable the DWT cycle counter of the Cortex-M7
+    ARM_DEMCR |= ARM_DEMCR_TRCENA;
+    ARM_DWT_CTRL |= ARM_DWT_CTRL_CYCCNTENA;
+    cyclesPerUs = F_CPU_ACTUAL / 1000000.0;
+    counterName = "DWT";
+  #endif
+}
+
+// Wraps after 2^32 cycles, only differences of short intervals are used
+uint32_t benchCycles() {
+  #ifdef HOST_BUILD
+    #ifdef BENCH_TSC
+      return (uint32_t)__rdtsc();
+    #else
+      return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+    #endif
+  #else
+    return ARM_DWT_CYCCNT;
+  #endif
+}
+
+double benchCyclesPerUs() {
+  return cyclesPerUs;
+}
+
+// ====== Output ======
+void benchPrintHeader() {
+  Serial.printf("\n ========================== Benchmarks ========================== \n");
+  Serial.printf(" Counter: %s @ %.1f MHz, loop budget: %.0f us\n\n", counterName, cyclesPerUs, BENCH_LOOP_BUDGET_US);
+  Serial.printf(" %-24s %7s %10s %10s %10s %9s %9s %9s %8s\n",
+                "function", "calls", "min [cyc]", "mean [cyc]", "max [cyc]", "min [us]", "mean [us]", "max [us]", "budget");
+}
+
+void benchPrint(const BenchResult& r) {
+  double meanUs = r.meanCycles / cyclesPerUs;
+  Serial.printf(" %-24s %7lu %10lu %10.0f %10lu %9.2f %9.2f %9.2f %7.2f%%\n",
+                r.name, r.iterations, (unsigned long)r.minCycles, r.meanCycles, (unsigned long)r.maxCycles,
+                r.minCycles / cyclesPerUs, meanUs, r.maxCycles / cyclesPerUs, 100.0 * meanUs / BENCH_LOOP_BUDGET_US);
+}
+
+// ====== Suite ======
+void runBenchmarks() {
+  benchInit();
+  benchPrintHeader();
+
+  // Filter inputs from a real sample
+  imu.getIMUdata_BMI088();
+
+  // Attitude estimation
+  benchRun("Madgwick6DOF", 10000, []() {
+    imu.Madgwick6DOF(imu.GyroX, -imu.GyroY, -imu.GyroZ, -imu.AccX, imu.AccY, imu.AccZ, 1.0f / MADGWICK_FREQUENCY);
+  });
+  benchRun("getIMUdata_BMI088", 1000, []() {
+    imu.getIMUdata_BMI088();
+  });
+
+  // Control (the time sweeps the first seconds of the trajectory like in flight)
+  float t = 0.0;
+  lqrInit();
+  benchRun("get_tradj_ref", 1000, [&t]() {
+    get_tradj_ref(t);
+    t += 0.005f;
+  });
+
+  t = 0.0;
+  lqrInit();
+  benchRun("lqr", 1000, [&t]() {
+    lqr(0.01f, imu.roll_IMU, imu.GyroX, 0.01f, imu.pitch_IMU, imu.GyroY, 0.5f, 0.1f, t, lqrSignals);
+    t += 0.005f;
+  });
+  lqrInit();
+
+  float newtons = 0.0f;
+  benchRun("thrustToPwm", 10000, [&newtons]() {
+    benchSink = thrustToPwm(newtons);
+    newtons += 0.003f;
+  });
+
+  // Interpolation between two gain sets (the thrust schedule sweeps its table)
+  float gains[3][8];
+  float thrust = 23.5f;
+  gainScheduleSelect(GAINS_THRUST, gains);
+  benchRun("gainScheduleEval", 10000, [&thrust, &gains]() {
+    gainScheduleEval(0.5f, thrust, gains);
+    benchSink = int(gains[0][6]);
+    thrust = thrust < 25.5f ? thrust + 0.0002f : 23.5f;
+  });
+  lqrInit();
+
+  // Slices of the on-board gain recompute (the solver restarts when it is done)
+  benchRun("lqrSolverStep", 1000, []() {
+    if (!lqrSolverBusy()) {
+      lqrSolverRequest(lqrModelDefault);
+    }
+    benchSink = lqrSolverStep();
+  });
+
+  // Logging and telemetry
+  benchRun("write2SD", 1000, []() {
+    write2SD();
+  });
+
+  #ifdef DISABLE_COM
+    initRadio(RF24_PA_LEVEL, RF24_SPEED, RF24_CHANNEL);
+  #endif
+  benchRun("transmitFlightData", 200, []() {
+    transmitFlightData(senderData, ackData);
+  });
+  benchRun("transmitFlightDataAsync", 200, []() {
+    benchSink = transmitFlightDataAsync(senderData, ackData);
+  });
+
+  Serial.printf(" ================================================================ \n");
+}
+
+#endif
@@ -0,0 +1,106 @@
+// =======================
+// ====== Black box ======
+// =======================
+
+/*
+* Full rate ring of the last seconds of the flight and its dump in the flight log format
+*/
+
+
+// =============================================================================================
+//  Preprocessor Definitions
+// =============================================================================================
+#include <Arduino.h>
+#include <SD.h>
+#include <settings.h>
+#include "BlackBox.h"
+
+#define RECORDS_PER_CHUNK (FLIGHT_LOG_PAYLOAD_SIZE / sizeof(BlackBoxRecord))
+
+
+// =============================================================================================
+//  Definitions
+// =============================================================================================
+// Field names of BlackBoxRecord in declaration order
+static const char* const BLACK_BOX_FIELDS =
+  "timeStamp,accX,accY,accZ,gyroX,gyroY,gyroZ,roll,pitch,yaw,z,zDot,gimb1,gimb2,motor1,motor2";
+
+// Not initialized at boot (DMAMEM), only the records below count are valid
+DMAMEM static BlackBoxRecord ring[BLACK_BOX_RECORDS];
+static uint32_t next = 0;      // Slot of the next record
+static uint32_t count = 0;     // Valid records
+
+
+// =============================================================================================
+//  Functions
+// =============================================================================================
+void blackBoxInit() {
+  next = 0;
+  count = 0;
+}
+
+void blackBoxAppend(const BlackBoxRecord& record) {
+  ring[next] = record;
+  next = next + 1 < BLACK_BOX_RECORDS ? next + 1 : 0;
+  if (count < BLACK_BOX_RECORDS) {
+    count++;
+  }
+}
+
+uint32_t blackBoxDump(const char* filename) {
+  File file = SD.open(filename, FILE_WRITE);
+  if (!file) {
+    #ifdef DEBUG
+      Serial.println("SD: Failed to create the black box file");
+    #endif
+    return 0;
+  }
+
+  FlightLogHeader header;
+  memset(&header, 0, sizeof(header));
+  header.magic = FLIGHT_LOG_MAGIC;
+  header.version = FLIGHT_LOG_VERSION;
+  header.headerSize = sizeof(FlightLogHeader);
+  header.chunkSize = FLIGHT_LOG_CHUNK_SIZE;
+  header.channelCount = 1;
+  FlightLogChannelInfo& info = header.channels[0];
+  info.id = FLIGHT_LOG_CHANNEL_BLACK_BOX;
+  info.encoding = FLIGHT_LOG_ENCODING_TIME_FLOAT32;
+  info.fieldCount = sizeof(BlackBoxRecord) / sizeof(float);
+  info.recordSize = sizeof(BlackBoxRecord);
+  info.recordRate = MADGWICK_FREQUENCY;
+  for (uint16_t i = 0; i < info.fieldCount; i++) {
+    info.scales[i] = 1.0f;
+  }
+  strncpy(info.fields, BLACK_BOX_FIELDS, sizeof(info.fields) - 1);
+  bool ok = file.write((const uint8_t*)&header, sizeof(header)) == sizeof(header);
+
+  // Oldest record first, chunk by chunk
+  struct {
+    FlightLogChunkHeader header;
+    uint8_t payload[FLIGHT_LOG_PAYLOAD_SIZE];
+  } chunk;
+  uint32_t slot = (next + BLACK_BOX_RECORDS - count) % BLACK_BOX_RECORDS;
+  uint32_t written = 0;
+  for (uint32_t sequence = 0; ok && written < count; sequence++) {
+    memset(&chunk, 0, sizeof(chunk));
+    chunk.header.channel = 0;
+    chunk.header.sequence = sequence;
+    while (chunk.header.records < RECORDS_PER_CHUNK && written + chunk.header.records < count) {
+      memcpy(&chunk.payload[chunk.header.length], &ring[slot], sizeof(BlackBoxRecord));
+      chunk.header.length += sizeof(BlackBoxRecord);
+      chunk.header.records++;
+      slot = slot + 1 < BLACK_BOX_RECORDS ? slot + 1 : 0;
+    }
+    ok = file.write((const uint8_t*)&chunk, sizeof(chunk)) == sizeof(chunk);
+    written += chunk.header.records;
+  }
+  file.close();
+
+  #ifdef DEBUG
+    if (!ok) {
+      Serial.println("SD: Black box write error");
+    }
+  #endif
+  return ok ? count : 0;
+}
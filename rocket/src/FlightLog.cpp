@@ -0,0 +1,389 @@
+// =======================
+// ===== Flight log ======
+// =======================
+
+/*
+* Channel chunks, record encoding, time index and chunked file output of the binary flight log
+*/
+
+
+// =============================================================================================
+//  Preprocessor Definitions
+// =============================================================================================
+#include <Arduino.h>
+#include <SD.h>
+#include <settings.h>
+#include "FlightLog.h"
+
+#define IMU_FIELDS 12
+#define REPLAY_FIELDS 4
+#define VARINT_MAX_SIZE 5
+
+// One imu record per gyroscope sample, at the full output data rate in the FIFO batch mode
+#ifdef IMU_FIFO
+  #define IMU_RECORD_RATE GYRO_FIFO_ODR
+#else
+  #define IMU_RECORD_RATE IMU_SAMPLE_FREQUENCY
+#endif
+
+
+// =============================================================================================
+//  Definitions
+// =============================================================================================
+FlightLogStats flightLogStats = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+
+// Field names of PacketData in declaration order. The control records are the telemetry packets, so their time
+// stamp is the float32 of PacketData ([us], exact up to 2^24 us = 16.7 s, coarser after that), not a uint32
+static const char* const LOG_FIELDS =
+  "timeStamp,xDot,roll,rollDot,yDot,pitch,pitchDot,z,zDot,zRef,zDotRef,motorSpeed,gimb1,gimb2";
+
+static_assert(sizeof(PacketData) == 14 * sizeof(float), "LOG_FIELDS must list the fields of PacketData");
+
+// Fields of FlightLogImuSample and their quantization steps (time [us], acc [mg], gyro [dps], quaternion, flag)
+// The acc/gyro steps are set to the BMI088 LSBs when the log is opened
+static const char* const IMU_LOG_FIELDS = "timeStamp,accX,accY,accZ,gyroX,gyroY,gyroZ,q0,q1,q2,q3,newAcc";
+static float imuScales[IMU_FIELDS] = {1.0f, 0.1f, 0.1f, 0.1f, 0.01f, 0.01f, 0.01f, 1e-6f, 1e-6f, 1e-6f, 1e-6f, 1.0f};
+
+// Fields of FlightLogReplayStep (integers)
+static const char* const REPLAY_LOG_FIELDS = "timeStamp,imuSamples,lidarSamples,lidarZ";
+
+struct Chunk {
+  FlightLogChunkHeader header;
+  uint8_t payload[FLIGHT_LOG_PAYLOAD_SIZE];
+};
+static_assert(sizeof(Chunk) == FLIGHT_LOG_CHUNK_SIZE, "Chunk must be FLIGHT_LOG_CHUNK_SIZE bytes");
+
+// Chunk being filled per channel, copied into the ring when full
+static Chunk chunks[FLIGHT_LOG_CHANNELS];
+static uint32_t chunkTime[FLIGHT_LOG_CHANNELS];      // First record of the chunk [us]
+static uint32_t channelChunks[FLIGHT_LOG_CHANNELS];  // Queued chunks of the channel
+static uint32_t sequence = 0;
+static uint32_t fileChunks = 0;                      // Queued chunks, the number of the next one in the file
+
+// Index chunk being filled and the positions of the queued ones (listed in the footer)
+static Chunk indexChunk;
+static uint32_t indexChunks[FLIGHT_LOG_FOOTER_MAX_INDEX];
+static uint16_t indexCount = 0;
+
+// Previous quantized record of the current chunk per channel (delta base)
+static int32_t prevRecord[FLIGHT_LOG_CHANNELS][FLIGHT_LOG_MAX_FIELDS];
+
+// Last new accelerometer sample [counts], repeated by the imu samples without one
+static int32_t lastAcc[3];
+
+// Full chunks waiting for the SD writer. Both ends are only used from loop() (control/IMU tasks and the SD
+// task), the byte indices run freely and wrap with the ring
+static uint8_t ring[FLIGHT_LOG_RING_SIZE];
+static uint32_t head = 0;      // Committed bytes
+static uint32_t tail = 0;      // Written bytes
+static FsFile logFile;
+
+
+// =============================================================================================
+//  Functions
+// =============================================================================================
+
+// ====== Helpers ======
+// Write the oldest chunk of the ring
+static void writeChunk() {
+  uint32_t offset = tail % FLIGHT_LOG_RING_SIZE;
+  if (logFile.write(&ring[offset], FLIGHT_LOG_CHUNK_SIZE) != FLIGHT_LOG_CHUNK_SIZE) {
+    flightLogStats.writeErrors++;
+    #ifdef DEBUG
+      Serial.println("SD: Flight log write failed");
+    #endif
+  }
+  tail += FLIGHT_LOG_CHUNK_SIZE;
+}
+
+// Queue a chunk for the SD writer. Returns false if it was dropped (ring full)
+static bool queueChunk(Chunk& chunk) {
+  chunk.header.sequence = sequence++;
+  if (head - tail + FLIGHT_LOG_CHUNK_SIZE > FLIGHT_LOG_RING_SIZE) {
+    flightLogStats.droppedChunks++;
+    return false;
+  }
+
+  // The ring size is a multiple of the chunk size, a chunk never wraps
+  memcpy(&ring[head % FLIGHT_LOG_RING_SIZE], &chunk, FLIGHT_LOG_CHUNK_SIZE);
+  head += FLIGHT_LOG_CHUNK_SIZE;
+  fileChunks++;
+  if (head - tail > flightLogStats.maxPending) {
+    flightLogStats.maxPending = head - tail;
+  }
+  return true;
+}
+
+static void commitIndexChunk() {
+  if (indexChunk.header.records == 0) {
+    return;
+  }
+  uint32_t position = fileChunks;
+  if (queueChunk(indexChunk) && indexCount < FLIGHT_LOG_FOOTER_MAX_INDEX) {
+    indexChunks[indexCount++] = position;
+  }
+  memset(&indexChunk, 0, sizeof(indexChunk));
+  indexChunk.header.channel = FLIGHT_LOG_CHUNK_INDEX;
+}
+
+static void addIndexEntry(uint8_t channel, uint32_t timeStamp, uint32_t position) {
+  FlightLogIndexEntry entry = {timeStamp, position, channel, {0, 0, 0}};
+  memcpy(&indexChunk.payload[indexChunk.header.length], &entry, sizeof(entry));
+  indexChunk.header.length += sizeof(entry);
+  indexChunk.header.records++;
+  flightLogStats.indexEntries++;
+
+  if (indexChunk.header.records == FLIGHT_LOG_INDEX_ENTRIES) {
+    commitIndexChunk();
+  }
+}
+
+// Queue the chunk of a channel (every FLIGHT_LOG_INDEX_INTERVAL-th one is indexed) and start a new one
+static void commitChunk(uint8_t channel) {
+  Chunk& chunk = chunks[channel];
+  if (chunk.header.records == 0) {
+    return;
+  }
+
+  uint32_t position = fileChunks;
+  if (queueChunk(chunk) && channelChunks[channel]++ % FLIGHT_LOG_INDEX_INTERVAL == 0) {
+    addIndexEntry(channel, chunkTime[channel], position);
+  }
+
+  memset(&chunk, 0, sizeof(chunk));
+  chunk.header.channel = channel;
+  memset(prevRecord[channel], 0, sizeof(prevRecord[channel]));
+}
+
+// Zig-zag varint: small positive and negative values take one byte per 7 bits of magnitude
+static uint8_t* putVarint(uint8_t* p, int32_t value) {
+  uint32_t v = ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+  while (v >= 0x80) {
+    *p++ = (uint8_t)(v | 0x80);
+    v >>= 7;
+  }
+  *p++ = (uint8_t)v;
+  return p;
+}
+
+// Append a quantized record to a delta varint channel. Returns its encoded size
+static uint8_t appendVarintRecord(uint8_t channel, const int32_t* values, uint8_t fieldCount, uint32_t timeStamp) {
+  Chunk& chunk = chunks[channel];
+  if (chunk.header.length + fieldCount * VARINT_MAX_SIZE > (int)FLIGHT_LOG_PAYLOAD_SIZE || chunk.header.records == 255) {
+    commitChunk(channel);
+  }
+  if (chunk.header.records == 0) {
+    chunkTime[channel] = timeStamp;
+  }
+
+  // The deltas are taken modulo 2^32 (the time stamp wraps)
+  uint8_t* start = &chunk.payload[chunk.header.length];
+  uint8_t* p = start;
+  int32_t* prev = prevRecord[channel];
+  for (uint8_t i = 0; i < fieldCount; i++) {
+    p = putVarint(p, (int32_t)((uint32_t)values[i] - (uint32_t)prev[i]));
+    prev[i] = values[i];
+  }
+  chunk.header.length += p - start;
+  chunk.header.records++;
+  return p - start;
+}
+
+static void describeChannel(FlightLogChannelInfo& info, uint8_t id, uint8_t encoding, const char* fields,
+                            uint16_t fieldCount, uint16_t recordSize, uint32_t recordRate, const float* scales) {
+  info.id = id;
+  info.encoding = encoding;
+  info.fieldCount = fieldCount;
+  info.recordSize = recordSize;
+  info.recordRate = recordRate;
+  for (uint16_t i = 0; i < fieldCount; i++) {
+    info.scales[i] = scales ? scales[i] : 1.0f;
+  }
+  strncpy(info.fields, fields, sizeof(info.fields) - 1);
+}
+
+#ifdef FLIGHT_LOG_PREALLOCATE
+// Allocate the file contiguously and erase its sectors, the card does no erase cycles for it in flight
+static void preallocate() {
+  if (!logFile.preAllocate(FLIGHT_LOG_FILE_SIZE)) {
+    #ifdef DEBUG
+      Serial.println("SD: Flight log preallocation failed, clusters are allocated in flight");
+    #endif
+    return;
+  }
+  flightLogStats.preallocated = FLIGHT_LOG_FILE_SIZE;
+
+  uint32_t firstSector, lastSector;
+  if (!logFile.contiguousRange(&firstSector, &lastSector) || !SD.sdfs.card()->erase(firstSector, lastSector)) {
+    #ifdef DEBUG
+      Serial.println("SD: Flight log sectors not erased");
+    #endif
+  }
+}
+#endif
+
+// ====== Logging ======
+bool flightLogOpen(const char* filename, float accScale, float gyroScale) {
+  head = 0;
+  tail = 0;
+  sequence = 0;
+  fileChunks = 0;
+  indexCount = 0;
+  memset(&flightLogStats, 0, sizeof(flightLogStats));
+  memset(chunks, 0, sizeof(chunks));
+  memset(channelChunks, 0, sizeof(channelChunks));
+  memset(&indexChunk, 0, sizeof(indexChunk));
+  indexChunk.header.channel = FLIGHT_LOG_CHUNK_INDEX;
+  memset(prevRecord, 0, sizeof(prevRecord));
+  memset(lastAcc, 0, sizeof(lastAcc));
+  for (uint8_t i = 0; i < FLIGHT_LOG_CHANNELS; i++) {
+    chunks[i].header.channel = i;
+  }
+  for (uint8_t i = 0; i < 3; i++) {
+    imuScales[1 + i] = accScale;
+    imuScales[4 + i] = gyroScale;
+  }
+
+  logFile = SD.sdfs.open(filename, O_RDWR | O_CREAT | O_TRUNC);
+  if (!logFile) {
+    #ifdef DEBUG
+      Serial.println("SD: Failed to create the flight log");
+    #endif
+    return false;
+  }
+
+  // Erasing clears the file, the header is written after it
+  #ifdef FLIGHT_LOG_PREALLOCATE
+    preallocate();
+  #endif
+
+  FlightLogHeader header;
+  memset(&header, 0, sizeof(header));
+  header.magic = FLIGHT_LOG_MAGIC;
+  header.version = FLIGHT_LOG_VERSION;
+  header.headerSize = sizeof(FlightLogHeader);
+  header.chunkSize = FLIGHT_LOG_CHUNK_SIZE;
+  header.channelCount = FLIGHT_LOG_CHANNELS;
+  describeChannel(header.channels[FLIGHT_LOG_CHANNEL_CONTROL], FLIGHT_LOG_CHANNEL_CONTROL, FLIGHT_LOG_ENCODING_FLOAT32,
+                  LOG_FIELDS, sizeof(PacketData) / sizeof(float), sizeof(PacketData), CONTROLLER_FREQUENCY, nullptr);
+  describeChannel(header.channels[FLIGHT_LOG_CHANNEL_IMU], FLIGHT_LOG_CHANNEL_IMU, FLIGHT_LOG_ENCODING_DELTA_VARINT,
+                  IMU_LOG_FIELDS, IMU_FIELDS, 0, IMU_RECORD_RATE, imuScales);
+  describeChannel(header.channels[FLIGHT_LOG_CHANNEL_REPLAY], FLIGHT_LOG_CHANNEL_REPLAY, FLIGHT_LOG_ENCODING_DELTA_VARINT,
+                  REPLAY_LOG_FIELDS, REPLAY_FIELDS, 0, CONTROLLER_FREQUENCY, nullptr);
+
+  if (logFile.write((const uint8_t*)&header, sizeof(header)) != sizeof(header)) {
+    flightLogStats.writeErrors++;
+    return false;
+  }
+  logFile.flush();
+  return true;
+}
+
+void flightLogAppend(const PacketData& data) {
+  Chunk& chunk = chunks[FLIGHT_LOG_CHANNEL_CONTROL];
+  if (chunk.header.records == 0) {
+    chunkTime[FLIGHT_LOG_CHANNEL_CONTROL] = (uint32_t)data.timeStamp;
+  }
+  memcpy(&chunk.payload[chunk.header.length], &data, sizeof(PacketData));
+  chunk.header.length += sizeof(PacketData);
+  chunk.header.records++;
+  flightLogStats.records++;
+
+  if (chunk.header.length + sizeof(PacketData) > FLIGHT_LOG_PAYLOAD_SIZE) {
+    commitChunk(FLIGHT_LOG_CHANNEL_CONTROL);
+  }
+}
+
+void flightLogAppendImu(const FlightLogImuSample& sample) {
+  int32_t values[IMU_FIELDS];
+  values[0] = (int32_t)sample.timeStamp;
+  for (uint8_t i = 0; i < 3; i++) {
+    if (sample.newAcc) {
+      lastAcc[i] = (int32_t)lroundf(sample.acc[i] / imuScales[1 + i]);
+    }
+    values[1 + i] = lastAcc[i];
+    values[4 + i] = (int32_t)lroundf(sample.gyro[i] / imuScales[4 + i]);
+  }
+  for (uint8_t i = 0; i < 4; i++) {
+    values[7 + i] = (int32_t)lroundf(sample.q[i] / imuScales[7 + i]);
+  }
+  values[11] = sample.newAcc ? 1 : 0;
+
+  flightLogStats.imuBytes += appendVarintRecord(FLIGHT_LOG_CHANNEL_IMU, values, IMU_FIELDS, sample.timeStamp);
+  flightLogStats.imuRecords++;
+}
+
+void flightLogAppendReplay(const FlightLogReplayStep& step) {
+  int32_t values[REPLAY_FIELDS] = {(int32_t)step.timeStamp, (int32_t)step.imuSamples, (int32_t)step.lidarSamples,
+                                   step.lidarZ};
+  appendVarintRecord(FLIGHT_LOG_CHANNEL_REPLAY, values, REPLAY_FIELDS, step.timeStamp);
+  flightLogStats.replayRecords++;
+}
+
+bool flightLogAppendState(const void* data, uint16_t size) {
+  if (size > FLIGHT_LOG_PAYLOAD_SIZE) {
+    return false;
+  }
+  Chunk chunk;
+  memset(&chunk, 0, sizeof(chunk));
+  chunk.header.channel = FLIGHT_LOG_CHUNK_STATE;
+  chunk.header.records = 1;
+  chunk.header.length = size;
+  memcpy(chunk.payload, data, size);
+  return queueChunk(chunk);
+}
+
+bool flightLogService() {
+  if (!logFile || head == tail) {
+    return false;
+  }
+  if (logFile.isBusy()) {
+    flightLogStats.busySkips++;
+    return false;
+  }
+
+  unsigned long tStart = micros();
+  writeChunk();
+  uint32_t us = micros() - tStart;
+
+  flightLogStats.chunks++;
+  if (us > flightLogStats.maxWriteUs) {
+    flightLogStats.maxWriteUs = us;
+  }
+  return true;
+}
+
+void flightLogClose() {
+  if (!logFile) {
+    return;
+  }
+
+  // Make room for the partial chunks, the index and the footer (an index entry can fill the index chunk)
+  while (head - tail + (FLIGHT_LOG_CHANNELS + 3) * FLIGHT_LOG_CHUNK_SIZE > FLIGHT_LOG_RING_SIZE) {
+    writeChunk();
+  }
+  for (uint8_t i = 0; i < FLIGHT_LOG_CHANNELS; i++) {
+    commitChunk(i);
+  }
+  commitIndexChunk();
+
+  Chunk footerChunk;
+  memset(&footerChunk, 0, sizeof(footerChunk));
+  FlightLogFooter footer;
+  memset(&footer, 0, sizeof(footer));
+  footer.magic = FLIGHT_LOG_FOOTER_MAGIC;
+  footer.chunkCount = fileChunks;
+  footer.indexCount = indexCount;
+  memcpy(footer.indexChunks, indexChunks, indexCount * sizeof(uint32_t));
+  footerChunk.header.channel = FLIGHT_LOG_CHUNK_FOOTER;
+  footerChunk.header.records = 1;
+  footerChunk.header.length = sizeof(footer);
+  memcpy(footerChunk.payload, &footer, sizeof(footer));
+  queueChunk(footerChunk);
+
+  while (head != tail) {
+    writeChunk();
+  }
+  logFile.truncate();
+  logFile.close();
+}
@@ -0,0 +1,161 @@
+// =======================
+// ==== Gain schedule ====
+// =======================
+
+/*
+* Gain tables of the LQR and their interpolation
+*/
+
+
+// =============================================================================================
+//  Preprocessor Definitions
+// =============================================================================================
+#include <Arduino.h>
+#include <settings.h>
+#include "GainSchedule.h"
+
+// Gains of the hover (Matlab_LQR/gain_and_trajectory_calculation.m), with the altitude and attitude blocks
+// replaceable for the other operating points
+#define K_ROW_THRUST(kz, kzDot) {0.0000f, -0.0000f, -0.0000f, -0.0000f, 0.0000f, 0.0000f, kz, kzDot}
+#define K_ROW_GIMBAL_1(kv, kg, kgDot) {kv, kg, kgDot, -0.0000f, -0.0000f, 0.0000f, -0.0000f, -0.0000f}
+#define K_ROW_GIMBAL_2(kv, kg, kgDot) {-0.0000f, -0.0000f, 0.0000f, kv, kg, kgDot, 0.0000f, 0.0000f}
+
+#define K_THRUST_HOVER K_ROW_THRUST(4.9271f, 3.6454f)
+#define K_GIMBAL_1_HOVER K_ROW_GIMBAL_1(0.2128f, 6.0158f, 2.1560f)
+#define K_GIMBAL_2_HOVER K_ROW_GIMBAL_2(0.2323f, 6.5665f, 2.3498f)
+
+
+// =============================================================================================
+//  Definitions
+// =============================================================================================
+const GainSchedule gainSchedules[GAIN_SCHEDULE_COUNT] = {
+  {"hover", GAIN_SCHEDULE_ALTITUDE, 1, {
+    {0.0f, {K_THRUST_HOVER, K_GIMBAL_1_HOVER, K_GIMBAL_2_HOVER}},
+  }},
+  // at [m]
+  {"altitude", GAIN_SCHEDULE_ALTITUDE, 2, {
+    {0.0f, {K_THRUST_HOVER, K_ROW_GIMBAL_1(0.2123f, 7.0410f, 2.1699f), K_ROW_GIMBAL_2(0.2317f, 7.6865f, 2.3689f)}},
+    {0.3f, {K_THRUST_HOVER, K_GIMBAL_1_HOVER, K_GIMBAL_2_HOVER}},
+  }},
+  // at [N], 2.5 kg * 9.82 m/s^2 = 24.55 N in hover, +-0.25 m/s^2 (the profile limit) is +-0.625 N
+  {"thrust", GAIN_SCHEDULE_THRUST, 3, {
+    {23.925f, {K_ROW_THRUST(3.8227f, 3.2451f), K_GIMBAL_1_HOVER, K_GIMBAL_2_HOVER}},
+    {24.55f,  {K_THRUST_HOVER, K_GIMBAL_1_HOVER, K_GIMBAL_2_HOVER}},
+    {25.175f, {K_ROW_THRUST(6.1758f, 4.6783f), K_GIMBAL_1_HOVER, K_GIMBAL_2_HOVER}},
+  }},
+};
+
+// Earlier single gain sets (lqrInit)
+// -0.0000,    0.0000,    0.0000,   -0.0000,    0.0000,    0.0000,   21.0558,   11.4359,
+// -3.6555,   16.3671,    3.5823,   -0.0000,    0.0000,    0.0000,    0.0000,   -0.0000,
+// -0.0000,    0.0000,    0.0000,   -3.7323,   19.9068,    5.2541,   -0.0000,   -0.0000
+//     0.0000,    -0.0000,    -0.0000,     0.0000,    -0.0000,    -0.0000,     6.8995,     4.8290,
+//    -0.2742,     4.6317,     1.1902,    -0.0000,     0.0000,     0.0000,    -0.0000,    -0.0000,
+//     0.0000,    -0.0000,    -0.0000,    -0.2852,     4.9051,     1.3903,     0.0000,     0.0000
+//     0.0000   -0.0000,   0.0000,   0.0000,  -0.0000,   0.0000,   6.8995,   4.8290,
+//    -0.0966,   0.8451,   0.3272,  -0.0000,   0.0000,   0.0000,   0.0000,   0.0000,
+//     0.0000,  -0.0000,  -0.0000   -0.0971,   0.9531,   0.4267,   0.0000,   0.0000,
+// -0.0000,    0.0000,    0.0000,    0.0000,    -0.0000,    -0.0000,    21.5488,    7.2377,
+// -0.0966,    0.8451,    0.3272,    -0.0000,    0.0000,    0.0000,    -0.0000,    -0.0000,
+// 0.0000,    -0.0000,    0.0000,    -0.0971,    0.9531,    0.4267,    -0.0000,    -0.0000};
+
+//  0.0000,    -0.0000,    -0.0000,     0.0000,    -0.0000,    -0.0000,     6.1758,     4.6783,
+// -0.0966,     0.8451,     0.3272,     0.0000,    -0.0000,    -0.0000,    -0.0000,    -0.0000,
+// -0.0000,    -0.0000,     0.0000,    -0.0971,     0.9531,     0.4267,    -0.0000,    -0.0000};
+
+//  0.0000,    -0.0000,    -0.0000,    -0.0000,     0.0000,     0.0000,     6.1758,     4.6783,
+// -0.0963,     1.0179,     0.3515,     0.0000,    -0.0000,    -0.0000,     0.0000,     0.0000,
+// -0.0000,     0.0000,     0.0000,    -0.0969,     1.1129,     0.4534,     0.0000,     0.0000};
+
+//    -0.0000,    0.0000,    0.0000,    0.0000,   -0.0000,   -0.0000,    8.7730,    4.7848,
+//     2.0505,   10.7667,    1.5809,   -0.0000,   -0.0000,    0.0000,    0.0000,    0.0000,
+//     0.0000,    0.0000,   -0.0000,    2.2222,   11.5446,    1.5816,    0.0000,    0.0000};
+
+// 0.0000,    0.0000,    0.0000,   -0.0000,   -0.0000,    0.0000,    8.7730,    4.7848,
+// 0.2110,    9.6746,    2.2053,    0.0000,    0.0000,    0.0000,   -0.0000,   -0.0000,
+// 0.0000,    0.0000,   -0.0000,    0.2303,   10.5634,    2.4176,   -0.0000,   -0.0000};
+
+//     0.0000,    0.0000,   -0.0000,   -0.0000,    0.0000,    0.0000,    3.1248,    2.9645,
+//     1.4817,    6.8453,    1.7116,   -0.0000,    0.0000,    0.0000,   -0.0000,   -0.0000,
+//    -0.0000,   -0.0000,    0.0000,    1.6112,    7.3178,    1.7440,    0.0000,    0.0000};
+//     0.0000,    0.0000,   -0.0000,   -0.0000,   -0.0000,   -0.0000,    3.1248,    2.9645,
+//     0.2131,    5.2159,    2.1451,    0.0000,   -0.0000,   -0.0000,    0.0000,    0.0000,
+//    -0.0000,   -0.0000,   -0.0000,    0.2327,    5.6925,    2.3348,   -0.0000,   -0.0000};
+
+//     0.0000,    0.0000,   -0.0000,    0.0000,    0.0000,   -0.0000,    2.7965,    2.8229,
+//     0.2123,    7.0410,    2.1699,   -0.0000,   -0.0000,    0.0000,    0.0000,    0.0000,
+//    -0.0000,    0.0000,    0.0000,    0.2317,    7.6865,    2.3689,    0.0000,    0.0000};
+
+//     0.0000,   -0.0000,   -0.0000,   -0.0000,    0.0000,    0.0000,    3.8227,    3.2451,
+//     0.2123,    7.0410,    2.1699,   -0.0000,    0.0000,    0.0000,    0.0000,    0.0000,
+//    -0.0000,    0.0000,    0.0000,    0.2317,    7.6865,    2.3689,    0.0000,    0.0000};
+//     0.0000,    0.0000,   -0.0000,    0.0000,    0.0000,   -0.0000,    3.8227,    3.2451,
+//     0.2128,    6.0158,    2.1560,   -0.0000,    0.0000,    0.0000,   -0.0000,    0.0000,
+//    -0.0000,    0.0000,    0.0000,    0.2323,    6.5665,    2.3498,    0.0000,    0.0000};
+
+// K-matrix without no gain on gamm1Dot and gamma2Dot:
+//     0.0000,    -0.0000,    -0.0000,    -0.0000,     0.0000,     0.0000,     4.9271,     3.6454,
+//     0.000,     6.0158,     0.0000,    -0.0000,    -0.0000,     0.0000,    -0.0000,    -0.0000,
+//    -0.0000,    -0.0000,     0.0000,     0.000,     6.5665,     0.0000,     0.0000,     0.0000};
+
+static uint8_t selected = GAINS_HOVER;
+static uint8_t current = 0;                              // Lower point of the interval of the last evaluation
+static float invSpan[GAIN_SCHEDULE_MAX_POINTS - 1];      // 1 / (at[i + 1] - at[i])
+
+
+// =============================================================================================
+//  Functions
+// =============================================================================================
+bool gainScheduleSelect(uint8_t schedule, float k[3][8]) {
+  if (schedule >= GAIN_SCHEDULE_COUNT) {
+    return false;
+  }
+  selected = schedule;
+  current = 0;
+
+  const GainSchedule& s = gainSchedules[schedule];
+  for (uint8_t i = 0; i + 1 < s.pointCount; i++) {
+    invSpan[i] = 1.0f / (s.points[i + 1].at - s.points[i].at);
+  }
+  memcpy(k, s.points[0].k, sizeof(s.points[0].k));
+  return true;
+}
+
+void gainScheduleEval(float z, float thrust, float k[3][8]) {
+  const GainSchedule& s = gainSchedules[selected];
+  if (s.pointCount < 2) {
+    return;
+  }
+  float x = s.variable == GAIN_SCHEDULE_THRUST ? thrust : z;
+
+  // Held outside of the table
+  if (!(x > s.points[0].at)) {
+    memcpy(k, s.points[0].k, sizeof(s.points[0].k));
+    return;
+  }
+  if (x >= s.points[s.pointCount - 1].at) {
+    memcpy(k, s.points[s.pointCount - 1].k, sizeof(s.points[0].k));
+    return;
+  }
+
+  // Interval of x, a neighbour of the last one in flight
+  while (current > 0 && x < s.points[current].at) {
+    current--;
+  }
+  while (current + 2 < s.pointCount && x >= s.points[current + 1].at) {
+    current++;
+  }
+
+  const float (*a)[8] = s.points[current].k;
+  const float (*b)[8] = s.points[current + 1].k;
+  float w = (x - s.points[current].at) * invSpan[current];
+  for (int i = 0; i < 3; i++) {
+    for (int j = 0; j < 8; j++) {
+      k[i][j] = a[i][j] + w * (b[i][j] - a[i][j]);
+    }
+  }
+}
+
+const GainSchedule& gainScheduleActive() {
+  return gainSchedules[selected];
+}
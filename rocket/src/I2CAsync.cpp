@@ -0,0 +1,358 @@
+// =======================
+// ===== Async I2C =======
+// =======================
+
+/*
+* Transaction queue and bus engines (Teensy LPI2C1 interrupt / host simulated bus) of the async I2C driver
+*/
+
+
+// =============================================================================================
+//  Preprocessor Definitions
+// =============================================================================================
+#include <Arduino.h>
+#include <Wire.h>
+#include <settings.h>
+#include "I2CAsync.h"
+#include "SpscRing.h"
+
+#ifdef HOST_BUILD
+  #include <HostClock.h>
+#endif
+
+
+// =============================================================================================
+//  Definitions
+// =============================================================================================
+I2CAsyncStats i2cAsyncStats = {0, 0, 0, 0, 0};
+
+// Submitted transactions. Pushed by i2cSubmit(), popped by the engine, either from the completion interrupt
+// or from i2cSubmit() with interrupts disabled, so the pops never run concurrently
+static SpscRing<I2CTransaction*, I2C_ASYNC_QUEUE_SIZE> queue;
+static I2CTransaction* volatile active = nullptr;
+static volatile unsigned long deadline = 0;     // Of the active transaction [us]
+static volatile bool stuck = false;             // The engine has given up on the active transaction
+
+static void startNext();
+
+
+// =============================================================================================
+//  Functions
+// =============================================================================================
+
+// ====== Completion (interrupt context, or the watchdog with the interrupt held off) ======
+static void finish(I2CStatus status) {
+  I2CTransaction* transaction = active;
+  active = nullptr;
+
+  if (status == I2C_DONE) {
+    i2cAsyncStats.completed++;
+  }
+  else {
+    i2cAsyncStats.errors++;
+  }
+
+  transaction->status = status;
+  if (transaction->done) {
+    transaction->done(transaction);
+  }
+
+  // A transaction submitted by the callback has been started already
+  if (!active) {
+    startNext();
+  }
+}
+
+
+// ====== Bus engine ======
+#ifdef HOST_BUILD
+
+// Transfers started before the last reset don't complete any more
+static uint32_t generation = 0;
+
+// The transfer is done on the simulated devices when the bus would have finished it
+static void portStart(I2CTransaction* transaction) {
+  uint64_t ns = 0;
+  if (transaction->txLen > 0) {
+    ns += Wire.transferNanos(transaction->txLen);
+  }
+  if (transaction->rxLen > 0) {
+    ns += Wire.transferNanos(transaction->rxLen);
+  }
+
+  uint32_t started = generation;
+  hostSchedule(hostNanos() + ns, [transaction, started]() {
+    if (started != generation) {
+      return;
+    }
+    bool ok = Wire.hostTransfer(transaction->address, transaction->tx, transaction->txLen,
+                                transaction->stopBeforeRead, transaction->rx, transaction->rxLen);
+    finish(ok ? I2C_DONE : I2C_ERROR);
+  });
+}
+
+static void portInit() {}
+
+static void portReset() {
+  generation++;
+}
+
+static void portDisableIrq() {}
+static void portEnableIrq() {}
+
+#else
+
+// LPI2C1 is the peripheral behind Wire (pins 18/19), Wire.begin() has set up the pins and the clock
+static IMXRT_LPI2C_t* const port = &IMXRT_LPI2C1;
+
+#define LPI2C_FIFO_SIZE 4
+#define LPI2C_ERROR_FLAGS (LPI2C_MSR_NDF | LPI2C_MSR_ALF | LPI2C_MSR_FEF)
+#define LPI2C_CLOCK_MHZ 24          // Functional clock of the LPI2C (before MCFGR1 PRESCALE), set up by Wire
+#define LPI2C_PIN_LOW_TIMEOUT 1000  // [us] SCL or SDA held low this long sets PLTF (no slave on the bus stretches the clock)
+#define LPI2C_BUS_IDLE_TIMEOUT 10   // [us] SCL and SDA high this long count as an idle bus (a STOP lost before a reset)
+#define I2C_SDA_PIN 18              // Wire pins, driven as GPIO to clock a stuck slave free
+#define I2C_SCL_PIN 19
+
+// Command words of the active transaction (START/TRANSMIT/RECEIVE/STOP), fed into the 4 word TX FIFO
+static uint16_t cmds[I2C_ASYNC_MAX_TX + 5];
+static uint8_t cmdCount = 0;
+static uint8_t cmdIndex = 0;
+static uint8_t rxIndex = 0;
+static uint8_t stopsLeft = 0;
+static bool busError = false;
+
+static void feed() {
+  while (cmdIndex < cmdCount && (port->MFSR & 0x07) < LPI2C_FIFO_SIZE) {
+    port->MTDR = cmds[cmdIndex++];
+  }
+  if (cmdIndex >= cmdCount) {
+    port->MIER &= ~LPI2C_MIER_TDIE;
+  }
+}
+
+static void drain(I2CTransaction* transaction) {
+  while ((port->MFSR >> 16) & 0x07) {
+    uint8_t data = port->MRDR & 0xFF;
+    if (rxIndex < transaction->rxLen) {
+      transaction->rx[rxIndex++] = data;
+    }
+  }
+}
+
+static void lpi2cIsr() {
+  I2CTransaction* transaction = active;
+  uint32_t msr = port->MSR;
+  if (!transaction) {
+    port->MIER = 0;
+    return;
+  }
+
+  // SCL or SDA held low: nothing completes any more, the watchdog resets the bus
+  if (msr & LPI2C_MSR_PLTF) {
+    port->MIER = 0;
+    stuck = true;
+    return;
+  }
+
+  // NACK, arbitration lost or FIFO error: flush and release the bus, completes with the STOP
+  if (msr & LPI2C_ERROR_FLAGS) {
+    port->MSR = LPI2C_ERROR_FLAGS;
+    port->MCR |= LPI2C_MCR_RTF | LPI2C_MCR_RRF;
+    port->MIER &= ~(LPI2C_MIER_TDIE | LPI2C_MIER_RDIE);
+    cmdIndex = cmdCount;
+    busError = true;
+    if (msr & LPI2C_MSR_MBF) {
+      stopsLeft = 1;
+      port->MTDR = LPI2C_MTDR_CMD_STOP;
+      return;
+    }
+    port->MIER = 0;
+    finish(I2C_ERROR);
+    return;
+  }
+
+  drain(transaction);
+  feed();
+
+  if (msr & LPI2C_MSR_SDF) {
+    port->MSR = LPI2C_MSR_SDF;
+    if (--stopsLeft == 0) {
+      drain(transaction);
+      port->MIER = 0;
+      finish(busError || rxIndex < transaction->rxLen ? I2C_ERROR : I2C_DONE);
+    }
+  }
+}
+
+static void portStart(I2CTransaction* transaction) {
+  uint8_t address = transaction->address << 1;
+  cmdCount = 0;
+  stopsLeft = 1;
+
+  if (transaction->txLen > 0) {
+    cmds[cmdCount++] = LPI2C_MTDR_CMD_START | address;
+    for (uint8_t i = 0; i < transaction->txLen; i++) {
+      cmds[cmdCount++] = transaction->tx[i];    // Command 0 = transmit data
+    }
+    if (transaction->rxLen > 0 && transaction->stopBeforeRead) {
+      cmds[cmdCount++] = LPI2C_MTDR_CMD_STOP;
+      stopsLeft = 2;
+    }
+  }
+  if (transaction->rxLen > 0) {
+    cmds[cmdCount++] = LPI2C_MTDR_CMD_START | address | 1;
+    cmds[cmdCount++] = LPI2C_MTDR_CMD_RECEIVE | (transaction->rxLen - 1);
+  }
+  cmds[cmdCount++] = LPI2C_MTDR_CMD_STOP;
+
+  cmdIndex = 0;
+  rxIndex = 0;
+  busError = false;
+
+  port->MFCR = LPI2C_MFCR_RXWATER(0) | LPI2C_MFCR_TXWATER(1);
+  port->MSR = LPI2C_MSR_SDF | LPI2C_ERROR_FLAGS;
+  feed();
+  port->MIER = LPI2C_MIER_RDIE | LPI2C_MIER_SDIE | LPI2C_MIER_NDIE | LPI2C_MIER_ALIE | LPI2C_MIER_FEIE |
+               LPI2C_MIER_PLTIE | (cmdIndex < cmdCount ? LPI2C_MIER_TDIE : 0);
+}
+
+// Pin low and bus idle timeouts (the configuration registers are only written with the master disabled)
+static void portTimeouts() {
+  uint32_t mcr = port->MCR;
+  port->MCR = mcr & ~LPI2C_MCR_MEN;
+  uint32_t cyclesPerUs = LPI2C_CLOCK_MHZ >> (port->MCFGR1 & 0x07);
+  port->MCFGR1 |= LPI2C_MCFGR1_TIMECFG;     // Pin low timeout on SCL or SDA
+  port->MCFGR2 = (port->MCFGR2 & ~LPI2C_MCFGR2_BUSIDLE(0xFFF)) | LPI2C_MCFGR2_BUSIDLE(LPI2C_BUS_IDLE_TIMEOUT * cyclesPerUs);
+  port->MCFGR3 = LPI2C_MCFGR3_PINLOW((LPI2C_PIN_LOW_TIMEOUT * cyclesPerUs + 255) / 256);
+  port->MCR = mcr;
+}
+
+static void portInit() {
+  port->MIER = 0;
+  portTimeouts();
+  attachInterruptVector(IRQ_LPI2C1, lpi2cIsr);
+  NVIC_SET_PRIORITY(IRQ_LPI2C1, 64);
+  NVIC_ENABLE_IRQ(IRQ_LPI2C1);
+}
+
+// Reset the master and clock the bus free: up to 9 SCL pulses until the slave releases SDA, then a STOP
+static void portReset() {
+  port->MIER = 0;
+  port->MCR = LPI2C_MCR_RST;
+  port->MCR = 0;
+
+  pinMode(I2C_SDA_PIN, INPUT_PULLUP);
+  pinMode(I2C_SCL_PIN, OUTPUT_OPENDRAIN);
+  digitalWrite(I2C_SCL_PIN, HIGH);
+  for (uint8_t i = 0; i < 9 && !digitalRead(I2C_SDA_PIN); i++) {
+    digitalWrite(I2C_SCL_PIN, LOW);
+    delayMicroseconds(5);
+    digitalWrite(I2C_SCL_PIN, HIGH);
+    delayMicroseconds(5);
+  }
+  pinMode(I2C_SDA_PIN, OUTPUT_OPENDRAIN);
+  digitalWrite(I2C_SDA_PIN, LOW);
+  delayMicroseconds(5);
+  digitalWrite(I2C_SDA_PIN, HIGH);
+  delayMicroseconds(5);
+
+  // Wire takes the pins back and sets the master up again
+  Wire.begin();
+  Wire.setClock(I2C_CLOCKSPEED);
+  port->MIER = 0;
+  portTimeouts();
+}
+
+static void portDisableIrq() {
+  NVIC_DISABLE_IRQ(IRQ_LPI2C1);
+}
+
+static void portEnableIrq() {
+  NVIC_ENABLE_IRQ(IRQ_LPI2C1);
+}
+
+#endif
+
+
+// ====== Queue ======
+static void startNext() {
+  I2CTransaction* transaction;
+  if (!queue.pop(transaction)) {
+    return;
+  }
+  active = transaction;
+  transaction->status = I2C_ACTIVE;
+  deadline = micros() + I2C_ASYNC_TIMEOUT;
+  stuck = false;
+  portStart(transaction);
+}
+
+void i2cPrepareRead(I2CTransaction& transaction, uint8_t address, uint8_t reg, uint8_t* buf, uint8_t len,
+                    I2CCallback done, void* context) {
+  transaction.address = address;
+  transaction.tx[0] = reg;
+  transaction.txLen = 1;
+  transaction.rx = buf;
+  transaction.rxLen = len;
+  transaction.stopBeforeRead = false;
+  transaction.done = done;
+  transaction.context = context;
+  transaction.status = I2C_IDLE;
+}
+
+void i2cAsyncInit() {
+  queue.clear();
+  active = nullptr;
+  stuck = false;
+  portInit();
+}
+
+bool i2cSubmit(I2CTransaction& transaction) {
+  if (transaction.pending()) {
+    return false;
+  }
+  transaction.status = I2C_QUEUED;
+
+  noInterrupts();
+  bool queued = queue.push(&transaction);
+  if (queued) {
+    uint8_t n = queue.size() + (active ? 1 : 0);
+    if (n > i2cAsyncStats.maxQueued) {
+      i2cAsyncStats.maxQueued = n;
+    }
+    if (!active) {
+      startNext();
+    }
+  }
+  interrupts();
+
+  if (!queued) {
+    transaction.status = I2C_ERROR;
+    i2cAsyncStats.queueFull++;
+  }
+  return queued;
+}
+
+void i2cAsyncWaitIdle() {
+  while (active || !queue.empty()) {
+    i2cAsyncWatchdog();
+    delayMicroseconds(1);
+  }
+}
+
+bool i2cAsyncWatchdog() {
+  if (!active || !(stuck || (long)(micros() - deadline) > 0)) {
+    return false;
+  }
+
+  // The completion interrupt is held off, the transaction may still have completed before that
+  portDisableIrq();
+  bool expired = active && (stuck || (long)(micros() - deadline) > 0);
+  if (expired) {
+    portReset();
+    i2cAsyncStats.timeouts++;
+    finish(I2C_ERROR);
+  }
+  portEnableIrq();
+  return expired;
+}
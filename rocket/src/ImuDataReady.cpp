@@ -0,0 +1,44 @@
+// =======================
+// === IMU data-ready ====
+// =======================
+
+/*
+* Data-ready interrupt handlers of the BMI088
+*/
+
+
+// =============================================================================================
+//  Preprocessor Definitions
+// =============================================================================================
+#include <Arduino.h>
+#include "ImuDataReady.h"
+
+// =============================================================================================
+//  Definitions
+// =============================================================================================
+DataReadyLine imuAccReady = {0, 0};
+DataReadyLine imuGyroReady = {0, 0};
+
+
+// =============================================================================================
+//  Functions
+// =============================================================================================
+
+// ====== Interrupt handlers ======
+// The time stamp is written before the count, a reader that sees the new count also sees its time stamp
+static void accReadyIsr() {
+  imuAccReady.timeStamp = micros();
+  imuAccReady.count = imuAccReady.count + 1;
+}
+
+static void gyroReadyIsr() {
+  imuGyroReady.timeStamp = micros();
+  imuGyroReady.count = imuGyroReady.count + 1;
+}
+
+void imuDataReadyInit(uint8_t accPin, uint8_t gyroPin) {
+  pinMode(accPin, INPUT);
+  pinMode(gyroPin, INPUT);
+  attachInterrupt(digitalPinToInterrupt(accPin), accReadyIsr, RISING);
+  attachInterrupt(digitalPinToInterrupt(gyroPin), gyroReadyIsr, RISING);
+}
@@ -0,0 +1,122 @@
+// =======================
+// ==== Loop statistics ==
+// =======================
+
+/*
+* Per stage latency histograms and overrun counters of the main loop
+*/
+
+
+// =============================================================================================
+//  Preprocessor Definitions
+// =============================================================================================
+#include <Arduino.h>
+#include <SD.h>
+#include <settings.h>
+#include "LoopStats.h"
+
+// =============================================================================================
+//  Definitions
+// =============================================================================================
+const uint32_t loopHistEdges[LOOP_HIST_BUCKETS - 1] = {
+  5, 10, 20, 50, 100, 200, 300, 400, 500, 750, 1000, 2000, 5000, 10000, 20000
+};
+
+const char* const loopStageNames[STAGE_COUNT] = {
+  "imu", "madgwick", "lidar", "lqr", "actuators", "sd", "radio", "loopPeriod", "controlJitter"
+};
+
+LoopStats loopStats;
+
+static unsigned long tLoopPrev = 0;
+static unsigned long tControlPrev = 0;
+
+
+// =============================================================================================
+//  Functions
+// =============================================================================================
+void loopStatsInit() {
+  memset(&loopStats, 0, sizeof(loopStats));
+  tLoopPrev = 0;
+  tControlPrev = 0;
+}
+
+void loopStatsLoopStart(unsigned long tNow) {
+  if (loopStats.iterations > 0) {
+    uint32_t period = tNow - tLoopPrev;
+    loopStatsRecord(STAGE_LOOP_PERIOD, period);
+    if (period > LOOP_BUDGET_US + LOOP_OVERRUN_MARGIN_US) {
+      loopStats.overruns++;
+    }
+  }
+  tLoopPrev = tNow;
+  loopStats.iterations++;
+}
+
+void loopStatsControlStart(unsigned long tNow) {
+  if (loopStats.controlSteps > 0) {
+    long deviation = (long)(tNow - tControlPrev) - CONTROL_PERIOD_US;
+    loopStatsRecord(STAGE_CONTROL_JITTER, deviation < 0 ? -deviation : deviation);
+  }
+  tControlPrev = tNow;
+  loopStats.controlSteps++;
+}
+
+// ====== Output ======
+void loopStatsPrint() {
+  Serial.print("\n\n =================== Loop statistics =================== \n");
+  Serial.print(" Iterations: ");
+  Serial.print(loopStats.iterations);
+  Serial.print("   Overruns (> ");
+  Serial.print(LOOP_BUDGET_US + LOOP_OVERRUN_MARGIN_US);
+  Serial.print(" us): ");
+  Serial.print(loopStats.overruns);
+  Serial.print("   Control steps: ");
+  Serial.print(loopStats.controlSteps);
+  Serial.print("\n\n stage           samples   mean [us]   max [us]   histogram (<5,<10,<20,<50,<100,<200,<300,<400,<500,<750,<1k,<2k,<5k,<10k,<20k,rest)\n");
+
+  for (int s = 0; s < STAGE_COUNT; s++) {
+    const LoopHistogram& h = loopStats.stages[s];
+    char line[96];
+    snprintf(line, sizeof(line), " %-14s %8lu %11.1f %10lu   ", loopStageNames[s], (unsigned long)h.samples,
+             h.samples > 0 ? double(h.sumUs) / h.samples : 0.0, (unsigned long)h.maxUs);
+    Serial.print(line);
+    for (int b = 0; b < LOOP_HIST_BUCKETS; b++) {
+      Serial.print(h.counts[b]);
+      Serial.print(b < LOOP_HIST_BUCKETS - 1 ? "," : "\n");
+    }
+  }
+}
+
+// CSV: one line per stage (samples, mean, max, bucket counts) and a summary line
+bool loopStatsWriteSD(const char* filename) {
+  File file = SD.open(filename, FILE_WRITE);
+  if (!file) {
+    #ifdef DEBUG
+      Serial.println("SD: Failed to create loop statistics file");
+    #endif
+    return false;
+  }
+
+  String line = "stage,samples,meanUs,maxUs";
+  for (int b = 0; b < LOOP_HIST_BUCKETS - 1; b++) {
+    line += ",lt" + String(loopHistEdges[b]);
+  }
+  line += ",rest";
+  file.println(line);
+
+  for (int s = 0; s < STAGE_COUNT; s++) {
+    const LoopHistogram& h = loopStats.stages[s];
+    line = String(loopStageNames[s]) + "," + String(h.samples) + "," +
+           String(h.samples > 0 ? float(double(h.sumUs) / h.samples) : 0.0f) + "," + String(h.maxUs);
+    for (int b = 0; b < LOOP_HIST_BUCKETS; b++) {
+      line += "," + String(h.counts[b]);
+    }
+    file.println(line);
+  }
+
+  file.println("iterations," + String(loopStats.iterations) + ",overruns," + String(loopStats.overruns) +
+               ",controlSteps," + String(loopStats.controlSteps));
+  file.close();
+  return true;
+}
@@ -0,0 +1,339 @@
+// =======================
+// ===== LQR solver ======
+// =======================
+
+/*
+* Discretization of the hover model and the structured doubling algorithm, fixed size float arrays
+*/
+
+
+// =============================================================================================
+//  Preprocessor Definitions
+// =============================================================================================
+#include <Arduino.h>
+#include <math.h>
+#include <settings.h>
+#include "LqrSolver.h"
+
+#define N LQR_STATES
+#define M LQR_INPUTS
+#define GRAVITY 9.82f
+#define SERIES_TERMS 8          // Of exp(A T), exact for this model (A^3 = 0)
+
+// Slices of a recompute
+#define PHASE_IDLE 0
+#define PHASE_DISCRETIZE 1
+#define PHASE_DOUBLING 2
+#define PHASE_GAINS 3
+
+
+// =============================================================================================
+//  Definitions
+// =============================================================================================
+const LqrModel lqrModelDefault = {
+  2.5f, 0.215f, 0.226f, 0.455933f, 0.330933f,
+  // xDot  gamma1  gamma1Dot  yDot  gamma2  gamma2Dot  z     zDot
+  {6.0f,   8.0f,   1.0f,      6.0f, 8.0f,   1.0f,      8.0f, 4.0f},
+  // thrust  gimbal 1  gimbal 2
+  {1.0f,     0.1f,     0.1f},
+};
+
+static LqrModel model;
+static uint8_t phase = PHASE_IDLE;
+static uint8_t iteration = 0;
+static bool converged = false;
+
+// Discrete model and the doubling iterates (Ak -> 0, Gk, Hk -> P)
+static float Ad[N][N];
+static float Bd[N][M];
+static float Ak[N][N];
+static float Gk[N][N];
+static float Hk[N][N];
+
+// Double buffer of the gains, published = index of the front buffer (-1 before the first solution)
+static LqrSolution solutions[2];
+static volatile int8_t published = -1;
+static uint32_t generation = 0;
+
+
+// =============================================================================================
+//  Functions
+// =============================================================================================
+// c = a * b (n x n times n x cols)
+static void matMul(const float a[N][N], const float* b, int cols, float* c) {
+  for (int i = 0; i < N; i++) {
+    for (int j = 0; j < cols; j++) {
+      float sum = 0.0f;
+      for (int l = 0; l < N; l++) {
+        sum += a[i][l] * b[l * cols + j];
+      }
+      c[i * cols + j] = sum;
+    }
+  }
+}
+
+// Solve a x = b in place for cols right hand sides (LU with partial pivoting, a is overwritten)
+static bool luSolve(float a[N][N], float* b, int cols) {
+  for (int p = 0; p < N; p++) {
+    int pivot = p;
+    for (int i = p + 1; i < N; i++) {
+      if (fabsf(a[i][p]) > fabsf(a[pivot][p])) {
+        pivot = i;
+      }
+    }
+    if (a[pivot][p] == 0.0f) {
+      return false;
+    }
+    if (pivot != p) {
+      for (int j = 0; j < N; j++) {
+        float t = a[p][j]; a[p][j] = a[pivot][j]; a[pivot][j] = t;
+      }
+      for (int j = 0; j < cols; j++) {
+        float t = b[p * cols + j]; b[p * cols + j] = b[pivot * cols + j]; b[pivot * cols + j] = t;
+      }
+    }
+    float inv = 1.0f / a[p][p];
+    for (int i = p + 1; i < N; i++) {
+      float f = a[i][p] * inv;
+      if (f == 0.0f) {
+        continue;
+      }
+      for (int j = p + 1; j < N; j++) {
+        a[i][j] -= f * a[p][j];
+      }
+      for (int j = 0; j < cols; j++) {
+        b[i * cols + j] -= f * b[p * cols + j];
+      }
+    }
+  }
+  for (int i = N - 1; i >= 0; i--) {
+    float inv = 1.0f / a[i][i];
+    for (int j = 0; j < cols; j++) {
+      float sum = b[i * cols + j];
+      for (int l = i + 1; l < N; l++) {
+        sum -= a[i][l] * b[l * cols + j];
+      }
+      b[i * cols + j] = sum * inv;
+    }
+  }
+  return true;
+}
+
+// Continuous model, zero order hold at the controller period, and the start of the doubling
+static void discretize() {
+  float A[N][N] = {};
+  float B[N][M] = {};
+  A[0][1] = GRAVITY / 2;
+  A[1][2] = 1.0f;
+  A[3][4] = GRAVITY / 2;
+  A[4][5] = 1.0f;
+  A[6][7] = 1.0f;
+  B[0][1] = GRAVITY;
+  B[2][1] = model.mass * GRAVITY * model.h1 / (2 * model.Jy);
+  B[3][2] = GRAVITY;
+  B[5][2] = model.mass * GRAVITY * model.h2 / (2 * model.Jx);
+  B[7][0] = 2 / model.mass;
+
+  // Ad = sum (A T)^n / n!, Bd = sum A^n T^(n+1) / (n+1)! B
+  const float T = 1.0f / CONTROLLER_FREQUENCY;
+  float term[N][N];     // (A T)^n / n!
+  float sumB[N][N];     // sum (A T)^n T / (n+1)!
+  float next[N][N];
+  for (int i = 0; i < N; i++) {
+    for (int j = 0; j < N; j++) {
+      term[i][j] = i == j ? 1.0f : 0.0f;
+      Ad[i][j] = term[i][j];
+      sumB[i][j] = term[i][j] * T;
+    }
+  }
+  for (int n = 1; n < SERIES_TERMS; n++) {
+    matMul(term, &A[0][0], N, &next[0][0]);
+    for (int i = 0; i < N; i++) {
+      for (int j = 0; j < N; j++) {
+        term[i][j] = next[i][j] * T / n;
+        Ad[i][j] += term[i][j];
+        sumB[i][j] += term[i][j] * T / (n + 1);
+      }
+    }
+  }
+  matMul(sumB, &B[0][0], M, &Bd[0][0]);
+
+  // A0 = Ad, G0 = Bd R^-1 Bd', H0 = Q
+  for (int i = 0; i < N; i++) {
+    for (int j = 0; j < N; j++) {
+      float g = 0.0f;
+      for (int l = 0; l < M; l++) {
+        g += Bd[i][l] * Bd[j][l] / model.r[l];
+      }
+      Ak[i][j] = Ad[i][j];
+      Gk[i][j] = g;
+      Hk[i][j] = i == j ? model.q[i] : 0.0f;
+    }
+  }
+}
+
+// One doubling iteration, W = I + Gk Hk:
+//   Ak+1 = Ak W^-1 Ak,  Gk+1 = Gk + Ak W^-1 Gk Ak',  Hk+1 = Hk + Ak' Hk W^-1 Ak
+// Returns 1 once Hk has converged, 0 to continue, -1 on a singular W or a non finite iterate (a bad model)
+static int doublingStep() {
+  float W[N][N];
+  matMul(Gk, &Hk[0][0], N, &W[0][0]);
+  for (int i = 0; i < N; i++) {
+    W[i][i] += 1.0f;
+  }
+
+  // X = W^-1 [Ak | Gk]
+  float X[N][2 * N];
+  for (int i = 0; i < N; i++) {
+    for (int j = 0; j < N; j++) {
+      X[i][j] = Ak[i][j];
+      X[i][N + j] = Gk[i][j];
+    }
+  }
+  if (!luSolve(W, &X[0][0], 2 * N)) {
+    return -1;
+  }
+
+  float A1[N][N], G1[N][N], H1[N][N], T1[N][N], dH[N][N];
+  for (int i = 0; i < N; i++) {
+    for (int j = 0; j < N; j++) {
+      float a = 0.0f, g = 0.0f, h = 0.0f;
+      for (int l = 0; l < N; l++) {
+        a += Ak[i][l] * X[l][j];
+        g += Ak[i][l] * X[l][N + j];
+        h += Hk[i][l] * X[l][j];
+      }
+      A1[i][j] = a;
+      T1[i][j] = g;      // Ak W^-1 Gk
+      H1[i][j] = h;      // Hk W^-1 Ak
+    }
+  }
+
+  float change = 0.0f, size = 0.0f;
+  bool finite = true;
+  for (int i = 0; i < N; i++) {
+    for (int j = 0; j < N; j++) {
+      float g = 0.0f, h = 0.0f;
+      for (int l = 0; l < N; l++) {
+        g += T1[i][l] * Ak[j][l];
+        h += Ak[l][i] * H1[l][j];
+      }
+      G1[i][j] = g;
+      dH[i][j] = h;      // Ak' Hk W^-1 Ak
+    }
+  }
+
+  // Symmetric parts only, float rounding would otherwise make Gk and Hk drift apart from their transposes
+  for (int i = 0; i < N; i++) {
+    for (int j = 0; j <= i; j++) {
+      float g = Gk[i][j] + 0.5f * (G1[i][j] + G1[j][i]);
+      float dh = 0.5f * (dH[i][j] + dH[j][i]);
+      float h = Hk[i][j] + dh;
+      Gk[i][j] = Gk[j][i] = g;
+      Hk[i][j] = Hk[j][i] = h;
+      finite = finite && isfinite(h) && isfinite(g);
+      change = fmaxf(change, fabsf(dh));
+      size = fmaxf(size, fabsf(h));
+    }
+  }
+  memcpy(Ak, A1, sizeof(Ak));
+  if (!finite) {
+    return -1;
+  }
+  return change <= LQR_SOLVER_TOLERANCE * size ? 1 : 0;
+}
+
+// K = (R + Bd' P Bd)^-1 Bd' P Ad into the back buffer, then publish it. Returns false (nothing is published,
+// the previous gains stay in use) when the doubling has not converged or the system is singular
+static bool publishGains() {
+  if (!converged) {
+    return false;
+  }
+
+  float PA[N][N], PB[N][M];
+  matMul(Hk, &Ad[0][0], N, &PA[0][0]);
+  matMul(Hk, &Bd[0][0], M, &PB[0][0]);
+
+  // 3x3 system, solved in the top left corner of an 8x8 LU (identity below)
+  float S[N][N] = {};
+  float rhs[N][N] = {};
+  for (int i = 0; i < M; i++) {
+    for (int j = 0; j < M; j++) {
+      float s = i == j ? model.r[i] : 0.0f;
+      for (int l = 0; l < N; l++) {
+        s += Bd[l][i] * PB[l][j];
+      }
+      S[i][j] = s;
+    }
+    for (int j = 0; j < N; j++) {
+      float s = 0.0f;
+      for (int l = 0; l < N; l++) {
+        s += Bd[l][i] * PA[l][j];
+      }
+      rhs[i][j] = s;
+    }
+  }
+  for (int i = M; i < N; i++) {
+    S[i][i] = 1.0f;
+  }
+  if (!luSolve(S, &rhs[0][0], N)) {
+    return false;
+  }
+
+  LqrSolution& back = solutions[published == 0 ? 1 : 0];
+  memcpy(back.k, rhs, sizeof(back.k));
+  back.mass = model.mass;
+  back.iterations = iteration;
+  back.converged = true;
+  back.generation = ++generation;
+  published = published == 0 ? 1 : 0;
+  return true;
+}
+
+void lqrSolverRequest(const LqrModel& newModel) {
+  model = newModel;
+  iteration = 0;
+  converged = false;
+  phase = PHASE_DISCRETIZE;
+}
+
+bool lqrSolverStep() {
+  switch (phase) {
+    case PHASE_DISCRETIZE:
+      discretize();
+      phase = PHASE_DOUBLING;
+      return false;
+
+    case PHASE_DOUBLING: {
+      iteration++;
+      int result = doublingStep();
+      converged = result > 0;
+      if (result != 0 || iteration >= LQR_SOLVER_MAX_ITERATIONS) {
+        phase = PHASE_GAINS;
+      }
+      return false;
+    }
+
+    case PHASE_GAINS: {
+      bool ok = publishGains();
+      phase = PHASE_IDLE;
+      #ifdef DEBUG
+        if (!ok) {
+          Serial.println("LQR solver: no solution for the model, the previous gains are kept");
+        }
+      #endif
+      return ok;
+    }
+
+    default:
+      return false;
+  }
+}
+
+bool lqrSolverBusy() {
+  return phase != PHASE_IDLE;
+}
+
+const LqrSolution* lqrSolverSolution() {
+  return published < 0 ? nullptr : &solutions[published];
+}
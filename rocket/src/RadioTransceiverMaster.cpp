@@ -13,6 +13,7 @@
 
 #include "GlobalDecRocket.h"
 #include "RadioTransceiverMaster.h"
+#include "LoopStats.h"
 #include <Arduino.h>
 #include <settings.h>
 
@@ -50,9 +51,15 @@ unsigned long txIntervalMillis = 2500; */ // send once per every 250 millisecond
 enum DataType {
   FLIGHT_DATA = 1,
   STATE_DATA = 2,
-  ERROR_MSG = 3
+  ERROR_MSG = 3,
+  LOOP_STATS = 4
 };
 
+// Loop statistics packets: stage, first bucket and up to 7 bucket counts (uint32)
+// The summary packet (stage LOOP_STATS_SUMMARY) holds iterations, overruns and control steps
+#define LOOP_STATS_BUCKETS_PER_PACKET 7
+#define LOOP_STATS_SUMMARY 0xFF
+
 // Create a Packet structure to hold the data that will be received from the other node
 struct Packet {
   byte type;
@@ -64,6 +71,11 @@ struct Packet {
   Packet packets[];
 }; */
 
+// Flight data sent packet by packet without waiting for the radio (transmitFlightDataAsync)
+Packet flightPackets[2];
+uint8_t nextFlightPacket = 0;   // 0: the next call starts a new frame
+bool txPending = false;         // A packet is on air (the radio retransmits it until it is acknowledged)
+
 
 
 // =============================================================================================
@@ -323,10 +335,36 @@ void checkSignalLoss(){
   return true;
 } */
 
+// Collect the outcome of the packet on air: the ack payload, or drop the packet after the last retry.
+// Returns false while it is still on air
+bool collectPacket(ControlData& ackData)
+{
+  bool txOk, txFail, rxReady;
+  radio.whatHappened(txOk, txFail, rxReady);
+  if (!txOk && !txFail) {
+    return false;
+  }
+  if (txFail) {
+    // The payload stays in the TX FIFO after the last retry
+    radio.flush_tx();
+    #ifdef DEBUG
+      Serial.println("  Tx failed");
+    #endif
+  }
+  else if (radio.available()) {
+    radio.read(&ackData, sizeof(ackData));
+  }
+  txPending = false;
+  return true;
+}
+
 // Transmit the packets with data
 void transmitPacket(Packet& packet,
                     ControlData& ackData)
 {
+  // Let a packet of transmitFlightDataAsync finish first
+  while (txPending && !collectPacket(ackData)) {}
+
   if(radio.write( &packet, sizeof(packet) ))
   {
     if (radio.available()) {
@@ -341,17 +379,23 @@ void transmitPacket(Packet& packet,
   }
 }
 
-//Transmit flightdata
-void transmitFlightData(PacketData& dataToSend, ControlData& ackData)
+// Split the flight data into two packets
+void splitFlightData(PacketData& dataToSend, Packet& packet1, Packet& packet2)
 {
-  // Split the data into two packets
-  Packet packet1 = {FLIGHT_DATA, 1, {}};
+  packet1 = {FLIGHT_DATA, 1, {}};
   memcpy(packet1.data, &dataToSend, PACKET_SIZE - sizeof(byte) - sizeof(byte));
 
-  Packet packet2 = {FLIGHT_DATA, 2, {}};
+  packet2 = {FLIGHT_DATA, 2, {}};
   size_t packet2DataSize = sizeof(PacketData) - (PACKET_SIZE - sizeof(byte) - sizeof(byte));
   memcpy(packet2.data, ((byte*)&dataToSend) + (PACKET_SIZE - sizeof(byte) - sizeof(byte)), packet2DataSize);
-  
+}
+
+//Transmit flightdata
+void transmitFlightData(PacketData& dataToSend, ControlData& ackData)
+{
+  Packet packet1, packet2;
+  splitFlightData(dataToSend, packet1, packet2);
+
   // Send the first packet
   transmitPacket(packet1, ackData);
 
@@ -359,6 +403,45 @@ void transmitFlightData(PacketData& dataToSend, ControlData& ackData)
   transmitPacket(packet2, ackData);
 }
 
+//Transmit flightdata without waiting for the radio
+bool transmitFlightDataAsync(PacketData& dataToSend, ControlData& ackData)
+{
+  if (txPending && !collectPacket(ackData)) {
+    return false;
+  }
+
+  // Both packets of a frame are built from the same data
+  if (nextFlightPacket == 0) {
+    splitFlightData(dataToSend, flightPackets[0], flightPackets[1]);
+  }
+  radio.startWrite(&flightPackets[nextFlightPacket], sizeof(Packet), false);
+  txPending = true;
+  nextFlightPacket ^= 1;
+  return true;
+}
+
+//Transmit loop statistics (end of flight)
+void transmitLoopStats(ControlData& ackData)
+{
+  byte sequence = 1;
+  for (int s = 0; s < STAGE_COUNT; s++) {
+    for (int b = 0; b < LOOP_HIST_BUCKETS; b += LOOP_STATS_BUCKETS_PER_PACKET) {
+      Packet packet = {LOOP_STATS, sequence++, {}};
+      int n = min(LOOP_STATS_BUCKETS_PER_PACKET, LOOP_HIST_BUCKETS - b);
+      packet.data[0] = (byte)s;
+      packet.data[1] = (byte)b;
+      memcpy(&packet.data[2], &loopStats.stages[s].counts[b], n * sizeof(uint32_t));
+      transmitPacket(packet, ackData);
+    }
+  }
+
+  Packet summary = {LOOP_STATS, sequence, {}};
+  uint32_t values[3] = {loopStats.iterations, loopStats.overruns, loopStats.controlSteps};
+  summary.data[0] = LOOP_STATS_SUMMARY;
+  memcpy(&summary.data[2], values, sizeof(values));
+  transmitPacket(summary, ackData);
+}
+
 //Transmit state
 void transmitState(States state, ControlData& ackData)
 {
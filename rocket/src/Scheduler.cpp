@@ -0,0 +1,182 @@
+// =======================
+// === Task scheduler ====
+// =======================
+
+/*
+* Static task table, rate monotonic dispatch and per task overrun accounting of the main loop
+*/
+
+
+// =============================================================================================
+//  Preprocessor Definitions
+// =============================================================================================
+#include <Arduino.h>
+#include <SD.h>
+#include <settings.h>
+#include "Clock.h"
+#include "Scheduler.h"
+
+// =============================================================================================
+//  Definitions
+// =============================================================================================
+static Task* taskTable = nullptr;
+static uint8_t taskCount = 0;
+
+
+// =============================================================================================
+//  Functions
+// =============================================================================================
+
+// ====== Helpers ======
+// Wrap-around safe "a is at or after b"
+static inline bool reached(unsigned long a, unsigned long b) {
+  return (long)(a - b) >= 0;
+}
+
+// Earliest future release of a hard task (tNow + 1 s when there is none)
+static unsigned long nextHardRelease(unsigned long tNow) {
+  unsigned long tNext = tNow + 1000000;
+  for (uint8_t i = 0; i < taskCount; i++) {
+    const Task& task = taskTable[i];
+    if (!task.background && !reached(task.release, tNext)) {
+      tNext = task.release;
+    }
+  }
+  return tNext;
+}
+
+static void dispatch(Task& task, unsigned long tNow) {
+  uint32_t lateness = tNow - task.release;
+  task.run();
+  unsigned long tEnd = micros();
+  uint32_t response = tEnd - task.release;
+
+  task.runs++;
+  task.sumResponseUs += response;
+  if (lateness > task.maxLatenessUs) {
+    task.maxLatenessUs = lateness;
+  }
+  if (response > task.maxResponseUs) {
+    task.maxResponseUs = response;
+  }
+  if (response > task.deadlineUs) {
+    task.deadlineMisses++;
+  }
+
+  // Phase locked release, releases a whole period behind are dropped (not run back to back)
+  task.release += task.periodUs;
+  if (reached(tEnd, task.release + task.periodUs)) {
+    uint32_t behind = (tEnd - task.release) / task.periodUs;
+    task.release += behind * task.periodUs;
+    task.skipped += behind;
+  }
+}
+
+// ====== Scheduling ======
+void schedulerInit(Task* tasks, uint8_t count, unsigned long tStart) {
+  taskTable = tasks;
+  taskCount = count;
+
+  // Insertion sort by priority (stable, tasks of equal priority keep their table order)
+  for (uint8_t i = 1; i < count; i++) {
+    Task task = tasks[i];
+    int j = i - 1;
+    while (j >= 0 && tasks[j].priority > task.priority) {
+      tasks[j + 1] = tasks[j];
+      j--;
+    }
+    tasks[j + 1] = task;
+  }
+
+  for (uint8_t i = 0; i < count; i++) {
+    Task& task = tasks[i];
+    task.release = tStart + task.offsetUs;
+    task.runs = 0;
+    task.deadlineMisses = 0;
+    task.skipped = 0;
+    task.maxLatenessUs = 0;
+    task.maxResponseUs = 0;
+    task.sumResponseUs = 0;
+
+    #ifdef DEBUG
+      if (task.deadlineUs > task.periodUs) {
+        Serial.print("\nScheduler: deadline longer than the period for task ");
+        Serial.print(task.name);
+      }
+    #endif
+  }
+}
+
+Task* schedulerRun() {
+  unsigned long tNow = micros();
+  unsigned long tWake = tNow + 1000000;
+
+  for (uint8_t i = 0; i < taskCount; i++) {
+    Task& task = taskTable[i];
+
+    if (!reached(tNow, task.release)) {
+      if (!reached(task.release, tWake)) {
+        tWake = task.release;
+      }
+      continue;
+    }
+
+    // Background tasks wait for enough slack before the next hard release, unless they are already overdue
+    if (task.background && !reached(tNow, task.release + task.deadlineUs)) {
+      unsigned long tHard = nextHardRelease(tNow);
+      if (!reached(tHard, tNow + task.wcetUs)) {
+        unsigned long tForced = task.release + task.deadlineUs;
+        if (!reached(tForced, tWake)) {
+          tWake = tForced;
+        }
+        continue;
+      }
+    }
+
+    dispatch(task, tNow);
+    return &task;
+  }
+
+  // Nothing to run, idle until the next release
+  waitUntilMicros(tWake);
+  return nullptr;
+}
+
+// ====== Output ======
+void schedulerPrint() {
+  Serial.print("\n\n =================== Task statistics =================== \n");
+  Serial.print(" task        prio  period [us]    runs  skipped  misses  max late [us]  mean resp [us]  max resp [us]\n");
+
+  for (uint8_t i = 0; i < taskCount; i++) {
+    const Task& task = taskTable[i];
+    char line[112];
+    snprintf(line, sizeof(line), " %-10s %4u%s %11lu %7lu %8lu %7lu %14lu %15.1f %14lu\n", task.name,
+             task.priority, task.background ? "b" : " ", (unsigned long)task.periodUs, (unsigned long)task.runs,
+             (unsigned long)task.skipped, (unsigned long)task.deadlineMisses, (unsigned long)task.maxLatenessUs,
+             task.runs > 0 ? double(task.sumResponseUs) / task.runs : 0.0, (unsigned long)task.maxResponseUs);
+    Serial.print(line);
+  }
+}
+
+// CSV: one line per task, appended to the file (shared with the loop statistics)
+bool schedulerWriteSD(const char* filename) {
+  File file = SD.open(filename, FILE_WRITE);
+  if (!file) {
+    #ifdef DEBUG
+      Serial.println("SD: Failed to open the task statistics file");
+    #endif
+    return false;
+  }
+
+  file.println("task,priority,background,periodUs,deadlineUs,runs,skipped,deadlineMisses,maxLatenessUs,meanResponseUs,maxResponseUs");
+  for (uint8_t i = 0; i < taskCount; i++) {
+    const Task& task = taskTable[i];
+    file.println(String(task.name) + "," + String(task.priority) + "," + String(task.background ? 1 : 0) + "," +
+                 String(task.periodUs) + "," + String(task.deadlineUs) + "," + String(task.runs) + "," +
+                 String(task.skipped) + "," + String(task.deadlineMisses) + "," + String(task.maxLatenessUs) + "," +
+                 String(task.runs > 0 ? float(double(task.sumResponseUs) / task.runs) : 0.0f) + "," +
+                 String(task.maxResponseUs));
+  }
+  file.close();
+  return true;
+}
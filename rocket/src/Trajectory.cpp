@@ -0,0 +1,112 @@
+// =======================
+// ===== Trajectory ======
+// =======================
+
+/*
+* Minimum-jerk segments between the waypoints of the mission profiles
+*/
+
+
+// =============================================================================================
+//  Preprocessor Definitions
+// =============================================================================================
+#include <Arduino.h>
+#include <math.h>
+#include <settings.h>
+#include "Trajectory.h"
+
+// Peak speed and acceleration of a minimum-jerk move over dz in 1 s
+#define MIN_JERK_PEAK_SPEED 1.875f
+#define MIN_JERK_PEAK_ACCEL 5.7735f
+
+
+// =============================================================================================
+//  Definitions
+// =============================================================================================
+const MissionProfile missionProfiles[MISSION_COUNT] = {
+  // name      zStart  vMax   aMax   waypoints  {z [m], hold [s]}
+  {"hover",    0.0f,   0.5f,  0.25f, 1,         {{1.0f, 0.0f}}},
+  {"hop",      0.0f,   0.5f,  0.25f, 2,         {{0.5f, 1.0f}, {0.0f, 0.0f}}},
+  {"stairs",   0.0f,   0.5f,  0.25f, 3,         {{0.5f, 1.0f}, {1.0f, 1.0f}, {0.5f, 0.0f}}},
+};
+
+// Move (or hold, dz = 0) from z0 starting at tStart
+struct Segment {
+  float tStart;             // [s]
+  float invT;               // 1 / duration
+  float z0;                 // [m]
+  float dz;                 // [m]
+};
+
+static Segment segments[TRAJECTORY_MAX_SEGMENTS];
+static uint8_t segmentCount = 0;
+static uint8_t current = 0;      // Segment of the last evaluation
+static float tEnd = 0.0f;        // End of the last segment, the last altitude is held from there on
+static float zEnd = 0.0f;
+
+
+// =============================================================================================
+//  Functions
+// =============================================================================================
+bool trajectorySelect(uint8_t mission) {
+  if (mission >= MISSION_COUNT) {
+    return false;
+  }
+  const MissionProfile& profile = missionProfiles[mission];
+
+  segmentCount = 0;
+  current = 0;
+  float t = 0.0f;
+  float z = profile.zStart;
+  for (uint8_t w = 0; w < profile.waypointCount && w < TRAJECTORY_MAX_WAYPOINTS; w++) {
+    const TrajectoryWaypoint& wp = profile.waypoints[w];
+    float dz = wp.z - z;
+    if (dz != 0.0f) {
+      // The shortest move within both limits
+      float T = fmaxf(MIN_JERK_PEAK_SPEED * fabsf(dz) / profile.vMax, sqrtf(MIN_JERK_PEAK_ACCEL * fabsf(dz) / profile.aMax));
+      segments[segmentCount++] = {t, 1.0f / T, z, dz};
+      t += T;
+      z = wp.z;
+    }
+    // Holds are only needed in between, the last altitude is held after tEnd
+    if (wp.hold > 0.0f && w + 1 < profile.waypointCount) {
+      segments[segmentCount++] = {t, 1.0f / wp.hold, z, 0.0f};
+      t += wp.hold;
+    }
+  }
+  tEnd = t;
+  zEnd = z;
+  return true;
+}
+
+void trajectoryEval(float t, TrajectoryRef& ref) {
+  if (segmentCount == 0 || t >= tEnd) {
+    ref = {zEnd, 0.0f, 0.0f};
+    return;
+  }
+  if (!(t > 0.0f)) {
+    ref = {segments[0].z0, 0.0f, 0.0f};
+    return;
+  }
+
+  // Segment of t (the same or the next one in flight)
+  if (t < segments[current].tStart) {
+    current = 0;
+  }
+  while (current + 1 < segmentCount && t >= segments[current + 1].tStart) {
+    current++;
+  }
+  const Segment& s = segments[current];
+
+  // z0 + dz * (10 tau^3 - 15 tau^4 + 6 tau^5) and its derivatives
+  float tau = (t - s.tStart) * s.invT;
+  float tau2 = tau * tau;
+  float dzT = s.dz * s.invT;
+  ref.z = s.z0 + s.dz * tau2 * tau * (10.0f + tau * (-15.0f + 6.0f * tau));
+  ref.zDot = dzT * 30.0f * tau2 * (1.0f + tau * (-2.0f + tau));
+  ref.zDDot = dzT * s.invT * 60.0f * tau * (1.0f + tau * (-3.0f + 2.0f * tau));
+}
+
+float trajectoryDuration() {
+  return tEnd;
+}
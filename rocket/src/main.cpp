@@ -26,6 +26,18 @@
 #include "LQR.h"
 #include <SD.h>
 #include "RollControl.h"
+#include "Benchmark.h"
+#include "LoopStats.h"
+#include "Scheduler.h"
+#include "I2CAsync.h"
+#include "FlightLog.h"
+#include "Replay.h"
+#include "BlackBox.h"
+#include "LqrSolver.h"
+
+#if defined(FLIGHT_LOG_REPLAY) && !(defined(FLIGHT_LOG_IMU) && defined(IMU_DATA_READY))
+  #error "FLIGHT_LOG_REPLAY needs FLIGHT_LOG_IMU and IMU_DATA_READY (the replay is fed the logged samples)"
+#endif
 
 
 
@@ -33,9 +45,6 @@
 //  Variables/Objects
 // =============================================================================================
 
-// Store data on SD card
-File dataFile;
-
 // Indicateds if there is new data to be read from the radio
 bool newControllerData = false;
 
@@ -71,6 +80,11 @@ int16_t lidarZPRev = 0;
 // int16_t lidarFlux = 0;       // Signal strength or quality of return signal
 // int16_t lidarTemp = 0;       // Internal temperature of Lidar sensor chip
 float zPrev = 0;       // Distance to object in centimeters
+uint32_t lidarSamples = 0;  // Distances processed since t0
+
+// Async lidar read (format command + data frame)
+I2CTransaction lidarRead = {};
+uint8_t lidarFrame[TFMP_FRAME_SIZE];
 
 // Servo control variables
 float xGimb = 0;
@@ -84,18 +98,10 @@ float yawZero = 0;
 // Timing variables
 unsigned long t0;
 unsigned long tTerminate;
-unsigned long t0Lqr;
-unsigned long t1Lqr;
-unsigned long t0Lidar;
-unsigned long t1Lidar;
-unsigned long tCheck0 = 0;
-unsigned long tCheck1 = 0;
 unsigned long t0IMU = 0;
 unsigned long t1IMU = 0;
 
-// Inverse sampling frequencies
-unsigned long madgwickFrekvInv = 0;
-unsigned long controllerFrekvInv = 0;
+// Inverse IMU sampling frequency (filter warmup)
 unsigned long imuSampleInv = 0;
 
 // Delta-states
@@ -103,20 +109,21 @@ float xDot = 0;
 float yDot = 0;
 float zDot = 0;
 
+// IMU samples filtered since t0
+uint32_t imuFiltered = 0;
+
 // ======== SD Card =========
-// SD file
+// SD file (binary flight log, see FlightLog.h)
 String sdFile = "";
-// Buffer for storing data
-String dataBuffer = "";
-// Maximum size of the buffer
-unsigned int bufferSize = 56000;//500000; //1000;
-// Time interval for writing to the SD card (in milliseconds)
-const unsigned long WRITE_INTERVAL = TIME_LIMIT-1;
-// Time of the last write operation
-unsigned long lastWriteTime = 0;
+// SD file for the loop statistics of the flight
+String statsFile = "";
+// SD file for the black box dump at the end of the flight
+String blackBoxFile = "";
+// Number of the last flight on the card (uint32), so a new log name is found without scanning the card
+#define LOG_SEQUENCE_FILE "logSeq.bin"
 
-// Debug variables
-float maxDeltaT = 0; // Maximum recorded iteration step time [us]
+// Start time of the current loop stage [us]
+unsigned long tStage = 0;
 
 
 // =============================================================================================
@@ -148,15 +155,13 @@ void getBarometer() {
   }
 } */
 
-void getLidar() {
-  float dtLidar = 0.01;//;(t1Lidar - t0Lidar) / 1000000;
+// Altitude and vertical speed from a new lidar distance [cm]
+void lidarEstimate(int16_t distance) {
+  float dtLidar = 1.0 / LIDAR_FREQUENCY;    // Sampled by the lidar task
   zPrev = zMeter;
   lidarZPRev = lidarZ;
-  // tfmP.getData(lidarZ, lidarFlux, lidarTemp);    // Get a frame of data from the TFmini
-  tfmP.getData(lidarZ);    // Get a frame of data from the TFmini
-  if (tfmP.status == TFMP_CHECKSUM){
-    lidarZ = tfmP.frame[ 2] + ( tfmP.frame[ 3] << 8);
-  }
+  lidarZ = distance;
+  lidarSamples++;
 
   if (isnan(lidarZ)) {
     lidarZ = lidarZPRev;
@@ -187,6 +192,40 @@ void getLidar() {
   }
 }
 
+// Distance of a lidar frame (the raw frame bytes if its checksum failed)
+void lidarUpdate(int16_t distance) {
+  if (tfmP.status == TFMP_CHECKSUM){
+    distance = tfmP.frame[ 2] + ( tfmP.frame[ 3] << 8);
+  }
+  lidarEstimate(distance);
+}
+
+// Blocking lidar read
+void getLidar() {
+  int16_t distance = lidarZ;
+  // tfmP.getData(lidarZ, lidarFlux, lidarTemp);    // Get a frame of data from the TFmini
+  tfmP.getData(distance);    // Get a frame of data from the TFmini
+  lidarUpdate(distance);
+}
+
+// Frame requested by the lidar task (I2C_ASYNC), processed right before it is used by the controller
+void lidarCollect() {
+  int16_t distance = lidarZ;
+  if (lidarRead.status == I2C_DONE) {
+    int16_t flux, temp;
+    memcpy(tfmP.frame, lidarFrame, TFMP_FRAME_SIZE);
+    tfmP.parseFrame(distance, flux, temp);
+  }
+  else if (lidarRead.status == I2C_ERROR) {
+    tfmP.status = TFMP_I2CREAD;
+  }
+  else {
+    // Not read yet (bus overloaded), keep the last altitude
+    return;
+  }
+  lidarRead.status = I2C_IDLE;
+  lidarUpdate(distance);
+}
 
 // Print the data from the ackData object
 void printAckData(){
@@ -204,6 +243,34 @@ void printAckData(){
   }
 }
 
+// Number of the next flight log, taken from the sequence file and stored back incremented
+// A card without a valid sequence file (new card, older firmware) is scanned once for the first free number.
+// The name of the counter is still checked, so logs copied onto the card are not overwritten
+uint32_t nextLogNumber() {
+  uint32_t last = 0;
+  File seq = SD.open(LOG_SEQUENCE_FILE, FILE_READ);
+  bool valid = seq && seq.read(&last, sizeof(last)) == sizeof(last);
+  seq.close();
+
+  if (!valid) {
+    last = 0;
+  }
+  while (SD.exists(("rocketData" + String(last + 1) + ".bin").c_str())) {
+    last++;
+  }
+
+  // Stored before the log is created, a reset during the boot skips a number instead of reusing it
+  seq = SD.open(LOG_SEQUENCE_FILE, FILE_WRITE_BEGIN);
+  uint32_t next = last + 1;
+  if (!seq || seq.write((const uint8_t*)&next, sizeof(next)) != sizeof(next)) {
+    #ifdef DEBUG
+      Serial.println("SD: Failed to store the log sequence number");
+    #endif
+  }
+  seq.close();
+  return next;
+}
+
 // Initialize the SD card
 void initSD(){
   if (!SD.begin(BUILTIN_SDCARD)) {
@@ -213,72 +280,168 @@ void initSD(){
     // Don't do anything more
   }
 
-  // Find a unique filename
-  int counter = 0;
-  String filename;
-  do {
-    counter++;
-    filename = "rocketData" + String(counter) + ".csv";
-  } while (SD.exists(filename.c_str()));
-
-  // Create a new data file with a unique name
-  dataFile = SD.open(filename.c_str(), FILE_WRITE);
-  if (!dataFile) {
-    #ifdef DEBUG
-      Serial.println("SD: Failed to create data file");
-    #endif
-  }
+  // Unique filename
+  uint32_t counter = nextLogNumber();
+  String filename = "rocketData" + String(counter) + ".bin";
+
+  // Create a new log file with a unique name (the imu channel stores the raw counts of the BMI088 ranges)
+  flightLogOpen(filename.c_str(), imu.bmi088.getAccScale(), imu.bmi088.getGyroScale());
 
   sdFile = filename;
+  statsFile = "loopStats" + String(counter) + ".csv";
+  blackBoxFile = "blackBox" + String(counter) + ".bin";
 
-  bufferSize = sizeof(senderData) * TIME_LIMIT / 10;                                 //<<<<<<<<<<<<<<-----------------Uncomment!!!
-  Serial.println("Buffersize: " + String(bufferSize));
+  #ifdef DEBUG
+    Serial.println("Flight log: " + sdFile + ", " + String(FLIGHT_LOG_RING_SIZE) + " bytes ring");
+  #endif
 }
 
+// Log the current data point (copied into the flight log ring, written to the card by taskSdWrite)
 void write2SD(){
-  // Add the current data point to the buffer
-  dataBuffer += String(senderData.timeStamp) + "," +
-                // State variables (x)
-                String(senderData.xDot) + "," +
-                String(senderData.roll) + "," +
-                String(senderData.rollDot) + "," +
-                String(senderData.yDot) + "," +
-                String(senderData.pitch) + "," +
-                String(senderData.pitchDot) + "," +
-                String(senderData.z) + "," +
-                String(senderData.zDot) + "," +
-                // Control reference values
-                String(senderData.zRef) + "," +
-                String(senderData.zDotRef) + "," +
-                // Control output values
-                String(senderData.motorSpeed) + "," +
-                String(senderData.gimb1) + "," +
-                String(senderData.gimb2) + "\n";
-
-  // If the buffer is full or the write interval has passed, write the buffer to the SD card
-  if (dataBuffer.length() >= bufferSize) { // || (micros() - t0 >= TIME_LIMIT - 1)) {
-    // Open the file. Note that only one file can be open at a time,
-    // so you have to close this one before opening another.
-    dataFile = SD.open(sdFile.c_str(), FILE_WRITE);
-
-    // If the file is available, write to it:
-    if (dataFile) {
-      dataFile.print(dataBuffer);
-      dataFile.close();
-    }
-    // If the file isn't open, pop up an error:
-    else {
-      #ifdef DEBUG
-        Serial.println("error opening rocketData.csv");
-      #endif
-    }
+  flightLogAppend(senderData);
+}
 
-    // Clear the buffer
-    dataBuffer = "";
+#ifdef FLIGHT_LOG_IMU
+// Log a filtered IMU sample with the quaternion after its filter step (imu channel of the flight log)
+void logImuSample(const ImuSample& sample) {
+  FlightLogImuSample record;
+  record.timeStamp = sample.timeStamp - t0;
+  memcpy(record.acc, sample.acc, sizeof(record.acc));
+  memcpy(record.gyro, sample.gyro, sizeof(record.gyro));
+  record.q[0] = imu.q0;
+  record.q[1] = imu.q1;
+  record.q[2] = imu.q2;
+  record.q[3] = imu.q3;
+  record.newAcc = sample.newAcc;
+  flightLogAppendImu(record);
+}
+#endif
+
+#ifdef BLACK_BOX
+// Record the frame starting at tFrame: estimator state after the filter step, its inputs and the last commands
+void blackBoxSample(unsigned long tFrame) {
+  BlackBoxRecord record;
+  record.timeStamp = tFrame - t0;
+  record.acc[0] = imu.AccX;
+  record.acc[1] = imu.AccY;
+  record.acc[2] = imu.AccZ;
+  record.gyro[0] = imu.GyroX;
+  record.gyro[1] = imu.GyroY;
+  record.gyro[2] = imu.GyroZ;
+  record.roll = imu.roll_IMU;
+  record.pitch = imu.pitch_IMU;
+  record.yaw = imu.yaw_IMU;
+  record.z = zMeter;
+  record.zDot = zDot;
+  record.gimb1 = xGimb;
+  record.gimb2 = yGimb;
+  record.motor1 = lqrSignals.motor1Speed;
+  record.motor2 = lqrSignals.motor2Speed;
+  blackBoxAppend(record);
+}
+#endif
+
+// ====== Replay ======
+// The steps shared with the host log replay (Replay.h)
+void replaySaveState(ReplayState& state) {
+  imu.saveState(state.imu);
+  state.xDot = xDot;
+  state.yDot = yDot;
+  state.zMeter = zMeter;
+  state.zPrev = zPrev;
+  state.zDot = zDot;
+  state.zCalibration = zCalibration;
+  state.lidarZ = lidarZ;
+  state.lidarZPrev = lidarZPRev;
+  state.yawZero = yawZero;
+}
 
-    // Update the time of the last write operation
-    lastWriteTime = millis();
-  }
+void replayRestoreState(const ReplayState& state) {
+  lqrInit();
+  imu.restoreState(state.imu);
+  xDot = state.xDot;
+  yDot = state.yDot;
+  zMeter = state.zMeter;
+  zPrev = state.zPrev;
+  zDot = state.zDot;
+  zCalibration = state.zCalibration;
+  lidarZ = state.lidarZ;
+  lidarZPRev = state.lidarZPrev;
+  yawZero = state.yawZero;
+  imuFiltered = 0;
+  lidarSamples = 0;
+}
+
+// Preliminary, rough estimations of the missing states (xDot, yDot)
+// To-do (kalman estimator)
+void velocityEstimate() {
+  xDot = (imu.AccX + imu.AccX_prev) * imu.dt;
+  yDot = (imu.AccY + imu.AccY_prev) * imu.dt;
+}
+
+void controlCompute(unsigned long tControl) {
+  // Calculate current time (passed since t0)
+  float currentTime = tControl * 1e-6f;
+  senderData.timeStamp = tControl;
+
+  // // =============== PID =================
+  // // PID altitude
+  // motorSpeed = altitude_pid(zMeter*0.01, ALT_REF);
+  // // Serial.println(motorSpeed);
+
+  // // PID angle 
+  // yGimb = angleControlY(imu.pitch_IMU, imu.roll_IMU, -MAX_GIMBAL, MAX_GIMBAL);
+  // xGimb = angleControlX(imu.pitch_IMU, imu.roll_IMU, -MAX_GIMBAL, MAX_GIMBAL);
+
+  // // PID actuation
+  // motorsWrite(1, motorSpeed, ackData);
+  // motorsWrite(2, motorSpeed, ackData);
+
+  lqr(xDot, imu.roll_IMU, imu.GyroX, yDot, imu.pitch_IMU, imu.GyroY, zMeter, zDot, currentTime, lqrSignals);
+  xGimb = lqrSignals.gimb1;
+  yGimb = lqrSignals.gimb2;
+
+  // IF roll-control enabled, calculate RPM-diff for lower motor (motor1)
+  #ifdef ROLLCONTROLLER
+    lqrSignals.motor1Speed = roll_p_controller(yawZero, imu.yaw_IMU, lqrSignals.motor2Speed);
+  #endif
+
+  // IF roll-control disabled, set motor speeds equal
+  #ifndef ROLLCONTROLLER
+    lqrSignals.motor1Speed = lqrSignals.motor2Speed;
+  #endif
+
+  // Store new state values in senderData struct
+  senderData.xDot      = xDot;
+  senderData.roll      = imu.roll_IMU;
+  senderData.rollDot   = imu.GyroX;
+  senderData.yDot      = yDot;
+  senderData.pitch     = imu.pitch_IMU; 
+  senderData.pitchDot  = imu.GyroY; 
+  senderData.z         = zMeter;
+  senderData.zDot      = zDot;
+
+  // Store control inputs
+  senderData.zRef = lqrSignals.zRef;
+  senderData.zDotRef = lqrSignals.zDotRef;
+  
+  // Store control outputs in senderData struct
+  senderData.motorSpeed = lqrSignals.motor1Speed;
+  senderData.gimb1 = xGimb;
+  senderData.gimb2 = yGimb;
+}
+
+// Do nothing until the teensy is reset
+void haltUntilReset() {
+  #ifdef HOST_BUILD
+    // There is no reset on the host, end the simulated flight instead
+    hostExit(0);
+  #endif
+
+  delay(1000000);
+
+  // Infinite loop with do nothing (arduino can't do exit(0) since the loop() is infinite)
+  while(1) {}
 }
 
 void redLedWarning() {
@@ -330,6 +493,191 @@ void redLedWarningV2() {
 }
 
 
+// =============================================================================================
+//  Tasks
+// =============================================================================================
+
+// IMU sample (the I2C bus is too slow to allow for sampling each madgwick step)
+void taskImu() {
+  #ifdef I2C_ASYNC
+    // Ends a stuck transaction (its callback gets I2C_ERROR) before new ones are queued behind it
+    i2cAsyncWatchdog();
+  #endif
+
+  #ifdef IMU_DATA_READY
+    // Only touches the bus when the data-ready interrupt has fired
+    tStage = micros();
+    if (imu.sampleDataReady()) {
+      loopStatsRecord(STAGE_IMU, micros() - tStage);
+    }
+  #else
+    // Calculate delta t between samples (used when integrating the signals in the madgwick filter)
+    #ifndef MADGWICK_DELTA
+      imu.IMUSampleDeltaCalc();
+    #endif
+
+    tStage = micros();
+    imu.sample();
+    loopStatsRecord(STAGE_IMU, micros() - tStage);
+  #endif
+}
+
+// Attitude estimation, sets the frame of the main loop (MADGWICK_FREQUENCY)
+void taskMadgwick() {
+  tStage = micros();
+  loopStatsLoopStart(tStage);
+  #ifdef IMU_DATA_READY
+    imuFiltered += imu.madgwickDrain();
+  #else
+    imu.madgwickUpdate();
+  #endif
+  loopStatsRecord(STAGE_MADGWICK, micros() - tStage);
+
+  velocityEstimate();
+
+  #ifdef BLACK_BOX
+    blackBoxSample(tStage);
+  #endif
+}
+
+// Altitude
+void taskLidar() {
+  tStage = micros();
+  #ifdef I2C_ASYNC
+    // Only starts the read, the frame is collected by the controller
+    i2cSubmit(lidarRead);
+  #else
+    getLidar();
+  #endif
+  loopStatsRecord(STAGE_LIDAR, micros() - tStage);
+
+  // getBarometer();
+}
+
+// LQR control and actuation
+void taskControl() {
+  loopStatsControlStart(micros());
+
+  #ifdef I2C_ASYNC
+    lidarCollect();
+  #endif
+
+  #ifdef DEBUG
+    Serial.print("\n z = ");
+    Serial.print(zMeter);
+
+    Serial.print("\t");
+    Serial.print("(Xr, Yr): ");
+    Serial.print(imu.roll_IMU);
+    Serial.print("  ");
+    Serial.print(imu.pitch_IMU);
+    Serial.print("  ");
+  #endif
+
+  tStage = micros();
+  unsigned long tControl = tStage - t0;
+  controlCompute(tControl);
+  loopStatsRecord(STAGE_LQR, micros() - tStage);
+
+  // Inputs of the step that the imu channel doesn't have, for the log replay
+  #ifdef FLIGHT_LOG_REPLAY
+    FlightLogReplayStep step = {(uint32_t)tControl, imuFiltered, lidarSamples, lidarZ};
+    flightLogAppendReplay(step);
+  #endif
+  
+  #ifdef DEBUG
+    Serial.print("  g1: ");
+    Serial.print(xGimb);
+    Serial.print("  g2: ");
+    Serial.print(yGimb);
+
+    Serial.print("   PWM: ");
+    Serial.print(lqrSignals.motor1Speed);
+    Serial.print("\t ");
+    // Serial.print("t: ");
+    // Serial.print(currentTime);
+    Serial.print("   dt Madgwick: ");
+    Serial.print(imu.dt);
+    
+  #endif
+
+  // Set motor speeds to ESCs
+  tStage = micros();
+  motorsWrite(2, lqrSignals.motor2Speed, ackData);
+  motorsWrite(1, lqrSignals.motor1Speed, ackData);
+
+  // Set gimbal angles to servos
+  setServo1Pos(-xGimb);
+  setServo2Pos(-yGimb);
+  loopStatsRecord(STAGE_ACTUATORS, micros() - tStage);
+}
+
+// Log the latest control step (released with the controller, runs in its slack)
+void taskLog() {
+  write2SD();
+}
+
+// Write one sector of the flight log to the SD-card when one is pending (runs in the slack)
+void taskSdWrite() {
+  tStage = micros();
+  if (flightLogService()) {
+    loopStatsRecord(STAGE_SD, micros() - tStage);
+  }
+}
+
+// Next slice of a gain recompute, when one was requested (runs in the slack)
+#ifdef LQR_SOLVER
+void taskLqrSolver() {
+  lqrSolverStep();
+}
+#endif
+
+// Ground control
+// --------------
+// Send the data to the ground controller via radio, one of the two packets of a frame per call (the radio
+// sends it and waits for the acknowledgement while the other tasks run)
+void taskRadio() {
+  tStage = micros();
+  transmitFlightDataAsync(senderData, ackData);
+  loopStatsRecord(STAGE_RADIO, micros() - tStage);
+}
+
+// ========= Task table =========
+// Rate monotonic priorities (the shorter the period, the higher the priority). Tasks that share a period run
+// in data flow order: with data-ready sampling the IMU task checks the interrupt every frame and runs right
+// before the filter, the lidar runs before the controller so that it gets the fresh altitude (with I2C_ASYNC
+// the frame is read in the background between the lidar task and the controller).
+// The IMU FIFO batches keep the bus busy for up to ~2 ms, the lidar read is queued behind them, so the
+// controller starts later after the lidar request in that mode.
+#ifdef IMU_FIFO
+  #define CONTROL_OFFSET 2500
+#else
+  #define CONTROL_OFFSET 1000
+#endif
+
+Task tasks[] = {
+  // name       function       period [us]                     offset [us]  deadline [us]                  prio  background  wcet [us]
+  #ifdef IMU_DATA_READY
+  {"imu",       taskImu,       1000000 / MADGWICK_FREQUENCY,    0,           1000000 / MADGWICK_FREQUENCY,    0,    false,      0},
+  {"madgwick",  taskMadgwick,  1000000 / MADGWICK_FREQUENCY,    0,           1000000 / MADGWICK_FREQUENCY,    1,    false,      0},
+  #else
+  {"madgwick",  taskMadgwick,  1000000 / MADGWICK_FREQUENCY,    0,           1000000 / MADGWICK_FREQUENCY,    0,    false,      0},
+  {"imu",       taskImu,       1000000 / IMU_SAMPLE_FREQUENCY,  0,           1000000 / IMU_SAMPLE_FREQUENCY,  1,    false,      0},
+  #endif
+  {"lidar",     taskLidar,     1000000 / LIDAR_FREQUENCY,       0,           1000,                            2,    false,      0},
+  {"control",   taskControl,   1000000 / CONTROLLER_FREQUENCY,  CONTROL_OFFSET, 1000,                         3,    false,      0},
+  {"sdLog",     taskLog,       1000000 / CONTROLLER_FREQUENCY,  CONTROL_OFFSET, 1000000 / CONTROLLER_FREQUENCY, 4,    true,       20},
+  {"sdWrite",   taskSdWrite,   1000000 / SD_WRITE_FREQUENCY,    3000,        1000000 / SD_WRITE_FREQUENCY,    5,    true,       SD_WRITE_WCET},
+  #ifdef LQR_SOLVER
+  {"lqrSolver", taskLqrSolver, 1000000 / LQR_SOLVER_FREQUENCY,  500,         1000000 / CONTROLLER_FREQUENCY,  7,    true,       50},
+  #endif
+  #ifndef DISABLE_COM
+  {"radio",     taskRadio,     500000 / TELEMETRY_FREQUENCY,    1500,        500000 / TELEMETRY_FREQUENCY,    6,    true,       100},
+  #endif
+};
+#define TASK_COUNT (sizeof(tasks) / sizeof(tasks[0]))
+
+
 // =============================================================================================
 //  Main Program
 // =============================================================================================
@@ -375,6 +723,11 @@ void setup() {
       transmitState(ESC_CALIBRATION, ackData);  //Transmit ESC calibration phase message
     #endif
 
+    // There are no ESCs to calibrate on the host, don't wait for the calButton
+    #ifdef HOST_BUILD
+      escCalibrationStatus = true;
+    #endif
+
     // Calibrate the ESCs throttle range once calButton has been pressed for at least 2 seconds
     waitESCCalCommand(escCalibrationStatus);
     
@@ -392,21 +745,27 @@ void setup() {
 
   lqrInit();
 
-  // Initialize the SD card
-  initSD();
-
 
   // =============== Sensor setup ===============
-  // Inverse sampling frequencies for timing (in microseconds)
-  madgwickFrekvInv = (1 / MADGWICK_FREQUENCY) * 1000000;
-  controllerFrekvInv = (1 / CONTROLLER_FREQUENCY) * 1000000;
-  imuSampleInv = (1 / IMU_SAMPLE_FREQUENCY) * 1000000;
+  // Inverse IMU sampling frequency for the filter warmup (in microseconds)
+  imuSampleInv = 1000000 / IMU_SAMPLE_FREQUENCY;
 
   // Initialize I2C bus
   // Wire.setSpeed(I2C_CLOCKSPEED);
   Wire.begin();
   Wire.setClock(I2C_CLOCKSPEED);
 
+  // Async transactions for the flight (the setup below still uses the blocking drivers)
+  #ifdef I2C_ASYNC
+    i2cAsyncInit();
+
+    lidarRead.address = TFMP_DEFAULT_ADDRESS;
+    lidarRead.txLen = tfmP.prepareCommand(I2C_FORMAT_CM, 0, lidarRead.tx);
+    lidarRead.stopBeforeRead = true;
+    lidarRead.rx = lidarFrame;
+    lidarRead.rxLen = TFMP_FRAME_SIZE;
+  #endif
+
   // Lidar calibration (measure offset to ground at standstill)   <<<<--------------------------To do: Add calibration by avragin multiple samples
   tfmP.getData(lidarZ);    // Get a frame of data from the TFmini
   if(tfmP.status == TFMP_CHECKSUM){
@@ -418,6 +777,15 @@ void setup() {
   // Initialize IMU (needs to happend in the end, to allow for continous IMU sampling)
   imu.init();
 
+  // Initialize the SD card (the log header takes the IMU ranges)
+  initSD();
+
+  // Benchmark builds only measure the hot path functions
+  #ifdef BENCHMARK
+    runBenchmarks();
+    haltUntilReset();
+  #endif
+
   // IMU calibration phase
   #ifndef DISABLE_COM
     transmitState(IMU_CALIBRATION, ackData);    // Transmit IMU calibration phase message
@@ -480,20 +848,29 @@ void setup() {
   t0 = micros();
   tTerminate = micros();
 
-  t0IMU = micros();
-  t1IMU = micros();   // This forces IMU sample in the firs loop iteration
-
-  t0Lqr = micros();
-  t1Lqr = micros();
-
-  // t0Lidar = micros();
-  // t1Lidar = micros();
-
-  tCheck0 = micros();
-  tCheck1 = micros();
+  loopStatsInit();
+  #ifdef BLACK_BOX
+    blackBoxInit();
+  #endif
 
   imu.current_time = micros();
   imu.prev_time = micros();
+  imu.resetSamples();
+  #ifdef FLIGHT_LOG_IMU
+    imu.sampleHook = logImuSample;
+  #endif
+
+  // Starting point of the log replay
+  imuFiltered = 0;
+  lidarSamples = 0;
+  #ifdef FLIGHT_LOG_REPLAY
+    ReplayState replayState;
+    replaySaveState(replayState);
+    flightLogAppendState(&replayState, sizeof(replayState));
+  #endif
+
+  // First releases of all tasks (IMU sample in the first frame)
+  schedulerInit(tasks, TASK_COUNT, micros());
 
 }
 
@@ -504,9 +881,6 @@ void setup() {
 
 
 void loop() {
-  // =============== Time / frequency management =================
-  tCheck0 = micros();
-
   // =============== Safety checks =================
   // Termination timer
   if (tTerminate - t0 >= TIME_LIMIT * 1000) {
@@ -518,18 +892,44 @@ void loop() {
     ackData.armSwitch = false;
     digitalWrite(RED_LED_PIN, LOW);
 
-    write2SD();
-
-    // Print largest deltaT in main loop
-    Serial.print("\n\n\n =================================== \n Biggest delta T (bellow 10 ms): ");
-    Serial.print(maxDeltaT);
-    Serial.print(" [us] \n \n");
+    flightLogClose();
+    #ifdef BLACK_BOX
+      uint32_t blackBoxRecords = blackBoxDump(blackBoxFile.c_str());
+    #endif
 
-    // Do nothing until the teensy is reset
-    delay(1000000);
+    // Dump the loop timing and task statistics
+    loopStatsWriteSD(statsFile.c_str());
+    schedulerWriteSD(statsFile.c_str());
+    #ifndef DISABLE_COM
+      transmitLoopStats(ackData);
+    #endif
+    loopStatsPrint();
+    schedulerPrint();
+    Serial.printf("\n Flight log: %lu records, %lu imu samples (%.1f bytes each), %lu replay steps, %lu dropped chunks, %lu chunks (max %lu us, %lu busy skips), max %lu bytes pending, %lu write errors, %lu bytes preallocated\n",
+                  (unsigned long)flightLogStats.records, (unsigned long)flightLogStats.imuRecords,
+                  flightLogStats.imuRecords ? (float)flightLogStats.imuBytes / flightLogStats.imuRecords : 0.0f,
+                  (unsigned long)flightLogStats.replayRecords,
+                  (unsigned long)flightLogStats.droppedChunks,
+                  (unsigned long)flightLogStats.chunks, (unsigned long)flightLogStats.maxWriteUs,
+                  (unsigned long)flightLogStats.busySkips, (unsigned long)flightLogStats.maxPending,
+                  (unsigned long)flightLogStats.writeErrors, (unsigned long)flightLogStats.preallocated);
+    #ifdef BLACK_BOX
+      Serial.printf(" Black box: %lu records (%.2f s) written to %s\n", (unsigned long)blackBoxRecords,
+                    (float)blackBoxRecords / MADGWICK_FREQUENCY, blackBoxFile.c_str());
+    #endif
+    #ifdef IMU_DATA_READY
+      Serial.printf(" IMU samples: %lu read, %lu missed, %lu dropped, %lu read errors%s\n", (unsigned long)imu.samplesRead,
+                    (unsigned long)imu.samplesMissed, (unsigned long)imu.samplesDropped, (unsigned long)imu.readErrors,
+                    imu.readyPolling ? ", sampled on the clock (no data-ready interrupts)" : "");
+    #endif
+    #ifdef I2C_ASYNC
+      Serial.printf(" I2C transactions: %lu completed, %lu errors (%lu timed out), %lu queue full, max %u queued\n",
+                    (unsigned long)i2cAsyncStats.completed, (unsigned long)i2cAsyncStats.errors,
+                    (unsigned long)i2cAsyncStats.timeouts, (unsigned long)i2cAsyncStats.queueFull,
+                    (unsigned)i2cAsyncStats.maxQueued);
+    #endif
 
-    // Infinite loop with do nothing (arduino can't do exit(0) since the loop() is infinite)
-    while(1) {}    
+    haltUntilReset();
   }
   else {
     tTerminate = micros();
@@ -550,222 +950,19 @@ void loop() {
       motorsWrite(1, 1100, ackData);
       motorsWrite(2, 1100, ackData);
 
-      // Do nothing until the teensy is reset
-      delay(1000000);
+      // Keep what led up to the stop
+      flightLogClose();
+      #ifdef BLACK_BOX
+        blackBoxDump(blackBoxFile.c_str());
+      #endif
 
-      // Infinite loop with do nothing (arduino can't do exit(0) since the loop() is infinite)
-      while(1) {}    
+      haltUntilReset();
     }
   #endif
 
   // ======================================================
-  // ================ Sensors and filters =================
+  // ================ Tasks ===============================
   // ======================================================
-  
-  // Check inverse sample frequency (I2C bus is too slow to allow for sampling each madgwick step)
-  if (t1IMU - t0IMU >= imuSampleInv) {
-    // Calculate delta t between samples (uesd when integrating the signals in the madgwick filter)
-    #ifndef MADGWICK_DELTA
-      imu.IMUSampleDeltaCalc();
-    #endif
-
-    // Read IMU
-    // unsigned long t0Madg = micros();
-    imu.sample();
-    // unsigned long t1Madg = micros();
-
-    // Serial.print("\n IMU sample took: ");
-    // Serial.print(t1Madg - t0Madg);
-
-    t0IMU = micros();
-    t1IMU = micros();
-  }
-  else {
-    t1IMU = micros();
-  }
-
-  // ================ Attitude estimation ================
-  // Madgwick iteration
-  imu.madgwickStep();
-
-  // Preliminary, rough estimations of the missing states (xDot, yDot)
-  // To-do (kalman estimator)
-  xDot = (imu.AccX + imu.AccX_prev) * imu.dt;
-  yDot = (imu.AccY + imu.AccY_prev) * imu.dt;
-
-
-  // Get lidar data (100 Hz)
-  if (t1Lidar - t0Lidar >= 10000) {
-    // unsigned long t0Lid = micros();
-    getLidar();
-    // unsigned long t1Lid = micros();
-
-    // Serial.print("\n Lidar sample took: ");
-    // Serial.print(t1Lid - t0Lid);
-    t0Lidar = micros();
-    t1Lidar = micros();
-
-  }
-  else {
-    t1Lidar = micros();
-  }
-
-  // getBarometer();
-
-  // ===========================================
-  // ================ Control ==================
-  // ===========================================
-
-  // =============== LQR control =================
-  
-  // Run control-update at predefined frequency
-  if (t1Lqr - t0Lqr >= controllerFrekvInv) {
-    // Get lidar data at the same frequency as the controller
-    // getLidar();
-
-    #ifdef DEBUG
-      Serial.print("\n z = ");
-      Serial.print(zMeter);
-
-      Serial.print("\t");
-      Serial.print("(Xr, Yr): ");
-      Serial.print(imu.roll_IMU);
-      Serial.print("  ");
-      Serial.print(imu.pitch_IMU);
-      Serial.print("  ");
-    #endif
-
-
-    // Calculate current time (passed since t0)
-    float currentTime = (micros() - t0) / 1000000;
-    senderData.timeStamp = micros() - t0;
-
-    // // =============== PID =================
-    // // PID altitude
-    // motorSpeed = altitude_pid(zMeter*0.01, ALT_REF);
-    // // Serial.println(motorSpeed);
-
-    // // PID angle 
-    // yGimb = angleControlY(imu.pitch_IMU, imu.roll_IMU, -MAX_GIMBAL, MAX_GIMBAL);
-    // xGimb = angleControlX(imu.pitch_IMU, imu.roll_IMU, -MAX_GIMBAL, MAX_GIMBAL);
-
-    // // PID actuation
-    // motorsWrite(1, motorSpeed, ackData);
-    // motorsWrite(2, motorSpeed, ackData);
-
-    lqr(xDot, imu.roll_IMU, imu.GyroX, yDot, imu.pitch_IMU, imu.GyroY, zMeter, zDot, currentTime, lqrSignals);
-    xGimb = lqrSignals.gimb1;
-    yGimb = lqrSignals.gimb2;
-    
-    #ifdef DEBUG
-      Serial.print("  g1: ");
-      Serial.print(xGimb);
-      Serial.print("  g2: ");
-      Serial.print(yGimb);
-
-      Serial.print("   PWM: ");
-      Serial.print(lqrSignals.motor1Speed);
-      Serial.print("\t ");
-      // Serial.print("t: ");
-      // Serial.print(currentTime);
-      Serial.print("   dt: ");
-      Serial.print(t1Lqr - t0Lqr);
-      Serial.print("   dt Madgwick: ");
-      Serial.print(imu.dt);
-      
-    #endif
-
-    // IF roll-control enabled, calculate RPM-diff for lower motor (motor1)
-    #ifdef ROLLCONTROLLER
-      lqrSignals.motor1Speed = roll_p_controller(yawZero, imu.yaw_IMU, lqrSignals.motor2Speed);
-    #endif
-
-    // IF roll-control disabled, set motor speeds equal
-    #ifndef ROLLCONTROLLER
-      lqrSignals.motor1Speed = lqrSignals.motor2Speed;
-    #endif
-
-    // Set motor speeds to ESCs
-    motorsWrite(2, lqrSignals.motor2Speed, ackData);
-    motorsWrite(1, lqrSignals.motor1Speed, ackData);
-
-    // Set gimbal angles to servos
-    setServo1Pos(-xGimb);
-    setServo2Pos(-yGimb);
-
-    // Store new state values in senderData struct
-    senderData.xDot      = xDot;
-    senderData.roll      = imu.roll_IMU;
-    senderData.rollDot   = imu.GyroX;
-    senderData.yDot      = yDot;
-    senderData.pitch     = imu.pitch_IMU; 
-    senderData.pitchDot  = imu.GyroY; 
-    senderData.z         = zMeter;
-    senderData.zDot      = zDot;
-
-    // Store control inputs
-    senderData.zRef = lqrSignals.zRef;
-    senderData.zDotRef = lqrSignals.zDotRef;
-    
-    // Store control outputs in senderData struct
-    // senderData.motorSpeed = lqrSignals.motor1Speed;
-    // senderData.gimb1 = lqrSignals.gimb1;
-    // senderData.gimb2 = lqrSignals.gimb2;
-    senderData.motorSpeed = motorSpeed;
-    senderData.gimb1 = xGimb;
-    senderData.gimb2 = yGimb;
-
-    // Log to SD-card at CONTROLLER_FREQUENCY [Hz]
-    write2SD();
-
-    t0Lqr = micros();
-    t1Lqr = micros();
-  }
-  else {
-    t1Lqr = micros();
-  }
-
-
-  // Ground control
-  // --------------
-  // Send the data to the ground controller via radio
-  // currentMillis = millis();
-  // if (currentMillis - prevMillis >= txIntervalMillis) {
-  //   if (!transmitData(radio, senderData, ackData, newControllerData, prevMillis)) {
-  //     // Connection lost to the ground controller
-  //     // Set flag and try reconnecting in the next loop
-  //     // TODO: Initialize landing script and dearm the rocket
-  //     #ifdef DEBUG
-  //       Serial.println("Connection lost to the ground controller. Trying to reconnect...");
-  //     #endif
-  //   }
-  //   else {
-  //     //Print data from ackData
-  //     #ifdef DEBUG
-  //       printAckData();
-  //     #endif
-  //   }
-  //   prevMillis = currentMillis;
-  // }
-
-
-  #ifndef DISABLE_COM
-    transmitFlightData(senderData, ackData);
-  #endif
-
-  // Calculate loop iteration deltaT and record max value if too big
-  #ifdef DEBUG
-    tCheck1 = micros();
-    float bigDeltaT = tCheck1 - tCheck0;
-    if((bigDeltaT) > madgwickFrekvInv) {
-      if (bigDeltaT > maxDeltaT && bigDeltaT < 10000) {
-        maxDeltaT = bigDeltaT;
-      }
-      
-        // Serial.print("\n ****************************************** \n Loop too slow: ");
-        // Serial.print(bigDeltaT);
-        // Serial.print(" [us] \n \n");
-    }
-  #endif
+  // Sensors, filters and control run from the task table (one task per call, the safety checks run in between)
+  schedulerRun();
 }
-